@@ -0,0 +1,231 @@
+#include "AssetBake.h"
+
+#include "AssetRegistry.h"
+#include "Log.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+	void put(std::vector<unsigned char>& out, const void* data, size_t size) {
+		const unsigned char* bytes = (const unsigned char*)data;
+		out.insert(out.end(), bytes, bytes + size);
+	}
+
+	template<typename T>
+	void put(std::vector<unsigned char>& out, T value) {
+		put(out, &value, sizeof(T));
+	}
+
+	void putString(std::vector<unsigned char>& out, const std::string& value) {
+		put(out, (uint32_t)value.size());
+		put(out, value.data(), value.size());
+	}
+
+	void writeModel(std::vector<unsigned char>& out, const ModelAsset& asset) {
+		put(out, (uint32_t)asset.meshes.size());
+		for (const Mesh& mesh : asset.meshes) {
+			const VertexLayout& layout = mesh.getLayout();
+			put(out, (uint8_t)layout.texCoords);
+			put(out, (uint8_t)layout.halfTexCoords);
+			put(out, (uint32_t)mesh.m_vertices.size());
+			put(out, (uint32_t)mesh.m_indices.size());
+			put(out, (uint32_t)mesh.m_textures.size());
+			for (const TexMesh& texture : mesh.m_textures) {
+				putString(out, texture.type);
+				putString(out, texture.path);
+			}
+			const std::vector<unsigned char> vertices = mesh.packVertices();
+			put(out, vertices.data(), vertices.size());
+			put(out, mesh.m_indices.data(), mesh.m_indices.size() * sizeof(unsigned int));
+			const MeshLods lods = mesh.getLods();
+			put(out, (uint32_t)lods.counts.size());
+			put(out, lods.counts.data(), lods.counts.size() * sizeof(unsigned int));
+			put(out, lods.indices.data(), lods.indices.size() * sizeof(unsigned int));
+		}
+	}
+}
+
+AssetBake::~AssetBake() {
+	this->close();
+}
+
+bool AssetBake::run(const std::string& directory, const std::string& output) {
+	const auto start = std::chrono::steady_clock::now();
+
+	std::vector<std::string> paths;
+	for (const auto& entry : std::filesystem::recursive_directory_iterator(directory)) {
+		if (entry.is_regular_file() && entry.path().extension() == ".obj") paths.push_back(entry.path().generic_string());
+	}
+	std::sort(paths.begin(), paths.end());
+
+	// the baked meshes only keep their positions, so always bake from the sources
+	AssetRegistry::get().setUseBake(false);
+
+	std::vector<unsigned char> data;
+	put(data, MAGIC);
+	put(data, VERSION);
+	put(data, (uint32_t)paths.size());
+	put(data, (uint64_t)0); // table offset, patched below
+
+	std::vector<std::pair<std::string, Entry>> table;
+	for (const std::string& path : paths) {
+		const std::shared_ptr<ModelAsset> asset = AssetRegistry::get().loadModel(path, false);
+		Entry entry;
+		entry.stamp = sourceStamp(path);
+		entry.offset = data.size();
+		writeModel(data, *asset);
+		entry.size = data.size() - entry.offset;
+		table.emplace_back(path, entry);
+		Log::info("Baked {} ({:.1f} KB)", path, entry.size / 1024.0);
+	}
+
+	const uint64_t tableOffset = data.size();
+	std::memcpy(&data[3 * sizeof(uint32_t)], &tableOffset, sizeof(tableOffset));
+	for (const auto& [path, entry] : table) {
+		putString(data, path);
+		put(data, entry.stamp);
+		put(data, entry.offset);
+		put(data, entry.size);
+	}
+
+	AssetRegistry::get().setUseBake(true);
+
+	std::ofstream file(output, std::ios::binary);
+	file.write((const char*)data.data(), data.size());
+	if (!file) {
+		Log::error("Could not write {}", output);
+		return false;
+	}
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	Log::info("Baked {} models into {} ({:.1f} MB) in {:.1f} s", paths.size(), output, data.size() / (1024.0 * 1024.0), seconds);
+	return true;
+}
+
+bool AssetBake::open(const std::string& path) {
+	this->close();
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) return false;
+	LARGE_INTEGER size;
+	GetFileSizeEx(file, &size);
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (!mapping) {
+		CloseHandle(file);
+		return false;
+	}
+	this->m_file = file;
+	this->m_mapping = mapping;
+	this->m_data = (const unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	this->m_size = (size_t)size.QuadPart;
+#else
+	const int file = ::open(path.c_str(), O_RDONLY);
+	if (file < 0) return false;
+	struct stat info;
+	fstat(file, &info);
+	void* data = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+	::close(file);
+	if (data == MAP_FAILED) return false;
+	this->m_data = (const unsigned char*)data;
+	this->m_size = (size_t)info.st_size;
+#endif
+	if (!this->m_data) {
+		this->close();
+		return false;
+	}
+
+	// header and table, the model blobs are only touched when they are loaded
+	const size_t headerSize = 3 * sizeof(uint32_t) + sizeof(uint64_t);
+	uint32_t header[3] = {};
+	uint64_t tableOffset = 0;
+	if (this->m_size >= headerSize) {
+		std::memcpy(header, this->m_data, sizeof(header));
+		std::memcpy(&tableOffset, this->m_data + sizeof(header), sizeof(tableOffset));
+	}
+	if (header[0] != MAGIC || header[1] != VERSION || tableOffset > this->m_size) {
+		Log::warning("{} is not a bake this build can read, run with --bake to rebuild it", path);
+		this->close();
+		return false;
+	}
+
+	size_t cursor = (size_t)tableOffset;
+	for (uint32_t i = 0; i < header[2]; i++) {
+		uint32_t length = 0;
+		Entry entry;
+		if (cursor + sizeof(length) > this->m_size) break;
+		std::memcpy(&length, this->m_data + cursor, sizeof(length));
+		cursor += sizeof(length);
+		if (cursor + length + sizeof(int64_t) + 2 * sizeof(uint64_t) > this->m_size) break;
+		const std::string modelPath((const char*)this->m_data + cursor, length);
+		cursor += length;
+		std::memcpy(&entry.stamp, this->m_data + cursor, sizeof(entry.stamp));
+		std::memcpy(&entry.offset, this->m_data + cursor + sizeof(int64_t), sizeof(entry.offset));
+		std::memcpy(&entry.size, this->m_data + cursor + sizeof(int64_t) + sizeof(uint64_t), sizeof(entry.size));
+		cursor += sizeof(int64_t) + 2 * sizeof(uint64_t);
+		if (entry.offset + entry.size <= this->m_size) this->m_entries[modelPath] = entry;
+	}
+	Log::info("Mapped {} ({} models)", path, this->m_entries.size());
+	return true;
+}
+
+bool AssetBake::isOpen() const {
+	return this->m_data != nullptr;
+}
+
+const unsigned char* AssetBake::find(const std::string& modelPath, size_t& size) const {
+	auto it = this->m_entries.find(modelPath);
+	if (it == this->m_entries.end()) return nullptr;
+	if (it->second.stamp != sourceStamp(modelPath)) {
+		Log::warning("{} changed since it was baked, loading the source", modelPath);
+		return nullptr;
+	}
+	size = (size_t)it->second.size;
+	return this->m_data + it->second.offset;
+}
+
+int64_t AssetBake::sourceStamp(const std::string& modelPath) {
+	std::error_code error;
+	std::filesystem::path path(modelPath);
+	int64_t stamp = (int64_t)std::filesystem::last_write_time(path, error).time_since_epoch().count();
+	stamp ^= (int64_t)std::filesystem::file_size(path, error) << 1;
+	// assimp reads the material library from the .obj's folder, whatever its name
+	for (const auto& entry : std::filesystem::directory_iterator(path.parent_path(), error)) {
+		if (entry.path().extension() != ".mtl") continue;
+		stamp = stamp * 31 + (int64_t)std::filesystem::last_write_time(entry.path(), error).time_since_epoch().count();
+	}
+	return stamp;
+}
+
+void AssetBake::close() {
+#ifdef _WIN32
+	if (this->m_data) UnmapViewOfFile(this->m_data);
+	if (this->m_mapping) CloseHandle(this->m_mapping);
+	if (this->m_file) CloseHandle(this->m_file);
+	this->m_file = this->m_mapping = nullptr;
+#else
+	if (this->m_data) munmap((void*)this->m_data, this->m_size);
+#endif
+	this->m_data = nullptr;
+	this->m_size = 0;
+	this->m_entries.clear();
+}
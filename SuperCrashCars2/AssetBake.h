@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+// Packed container of every model under models/, written by --bake so startup doesn't have to run
+// assimp on the .obj/.mtl files. Holds each mesh's vertices already packed in its VertexLayout, its
+// indices, its coarser levels of detail and its material's texture paths; the runtime maps the file and
+// uploads straight from it without simplifying again. An entry is only used while its source files are
+// unchanged, anything else falls back to assimp. Rebake after changing MeshSimplifier.
+//
+// layout (little endian):
+//   header  magic, version, entry count, table offset
+//   models  per model: mesh count, then per mesh: layout, vertex/index/texture counts, texture
+//           type and path strings, vertex blob, index blob, level count, indices per level,
+//           level index blob
+//   table   per model: path, source stamp, blob offset and size
+class AssetBake {
+
+public:
+	static constexpr const char* DEFAULT_PATH = "models.bake";
+
+	AssetBake() {}
+	~AssetBake();
+	AssetBake(const AssetBake&) = delete;
+	AssetBake& operator=(const AssetBake&) = delete;
+
+	// loads every .obj under directory (needs a current GL context) and writes the container.
+	static bool run(const std::string& directory = "models", const std::string& output = DEFAULT_PATH);
+
+	// maps the container, false if there is none or it isn't one this build can read.
+	bool open(const std::string& path = DEFAULT_PATH);
+	bool isOpen() const;
+
+	// the blob of a model, null if it wasn't baked or its sources changed since.
+	const unsigned char* find(const std::string& modelPath, size_t& size) const;
+
+	// changes whenever the .obj or its .mtl is written
+	static int64_t sourceStamp(const std::string& modelPath);
+
+private:
+	static constexpr uint32_t MAGIC = 0x42434353; // "SCCB"
+	static constexpr uint32_t VERSION = 3;
+
+	struct Entry {
+		int64_t stamp = 0;
+		uint64_t offset = 0;
+		uint64_t size = 0;
+	};
+
+	void close();
+
+	const unsigned char* m_data = nullptr;
+	size_t m_size = 0;
+#ifdef _WIN32
+	void* m_file = nullptr;
+	void* m_mapping = nullptr;
+#endif
+	std::unordered_map<std::string, Entry> m_entries;
+};
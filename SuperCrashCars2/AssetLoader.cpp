@@ -0,0 +1,344 @@
+#include "AssetLoader.h"
+
+#include <stb_image.h>
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+
+namespace {
+	std::string imageKey(const std::string& path, bool flip) {
+		return path + (flip ? "|flip" : "");
+	}
+
+	std::string compressedKey(const std::string& path, bool flip) {
+		return imageKey(path, flip) + "|bc";
+	}
+
+	std::string fontKey(const std::string& path, unsigned int size) {
+		return path + '|' + std::to_string(size);
+	}
+}
+
+AssetLoader::~AssetLoader() {
+	// only reached at exit if finish() never ran, don't leave joinable threads behind
+	{
+		std::lock_guard<std::mutex> lock(this->m_mutex);
+		this->m_stopping = true;
+		this->m_jobs.clear();
+	}
+	this->m_jobAdded.notify_all();
+	for (std::thread& worker : this->m_workers) worker.join();
+}
+
+void AssetLoader::start(unsigned int numWorkers) {
+	std::lock_guard<std::mutex> lock(this->m_mutex);
+	if (!this->m_workers.empty()) return;
+	this->m_stopping = false;
+	for (unsigned int i = 0; i < std::max(numWorkers, 1u); i++) {
+		this->m_workers.emplace_back(&AssetLoader::work, this);
+	}
+}
+
+void AssetLoader::finish() {
+	{
+		std::unique_lock<std::mutex> lock(this->m_mutex);
+		this->m_resultReady.wait(lock, [this]() { return this->m_jobs.empty() && this->m_busyWorkers == 0; });
+		this->m_stopping = true;
+	}
+	this->m_jobAdded.notify_all();
+	for (std::thread& worker : this->m_workers) worker.join();
+
+	std::lock_guard<std::mutex> lock(this->m_mutex);
+	this->m_workers.clear();
+	this->m_models.clear();
+	this->m_images.clear();
+	this->m_fonts.clear();
+	this->m_uploaded.clear();
+}
+
+bool AssetLoader::isRunning() const {
+	std::lock_guard<std::mutex> lock(this->m_mutex);
+	return !this->m_workers.empty() && !this->m_stopping;
+}
+
+void AssetLoader::requestModel(const std::string& path, bool flipTexture) {
+	std::lock_guard<std::mutex> lock(this->m_mutex);
+	if (this->m_workers.empty() || this->m_stopping) return;
+	for (const ModelRequest& request : this->m_models) {
+		if (request.path == path) return;
+	}
+	this->m_models.emplace_back();
+	ModelRequest& request = this->m_models.back();
+	request.path = path;
+	request.flipTexture = flipTexture;
+
+	this->m_jobs.push_back([this, &request]() {
+		ParsedModel parsed;
+		AssetRegistry::get().parseModel(request.path, parsed);
+
+		// the model's textures are decoded in the same job unless someone else already has them
+		const std::string directory = request.path.substr(0, request.path.find_last_of('/'));
+		std::vector<std::string> textures;
+		for (const ParsedMesh& mesh : parsed.meshes) {
+			for (const TexMesh& texture : mesh.textures) textures.push_back(directory + '/' + texture.path);
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(this->m_mutex);
+			request.parsed = std::move(parsed);
+			request.ready = true;
+		}
+		this->m_resultReady.notify_all();
+
+		const bool compress = TextureCache::get().isEnabled();
+		for (const std::string& texture : textures) {
+			const std::string key = compress ? compressedKey(texture, request.flipTexture) : imageKey(texture, request.flipTexture);
+			if (!this->claimImage(key)) continue;
+			if (compress) this->compressInto(key, texture, request.flipTexture);
+			else this->decodeInto(key, texture, request.flipTexture);
+		}
+	});
+	this->m_jobAdded.notify_one();
+}
+
+void AssetLoader::requestImage(const std::string& path, bool flip) {
+	if (!this->isRunning()) return;
+	const std::string key = imageKey(path, flip);
+	if (!this->claimImage(key)) return;
+	this->push([this, key, path, flip]() { this->decodeInto(key, path, flip); });
+}
+
+void AssetLoader::requestFont(const std::string& path, unsigned int size) {
+	const std::string key = fontKey(path, size);
+	{
+		std::lock_guard<std::mutex> lock(this->m_mutex);
+		if (this->m_workers.empty() || this->m_stopping || this->m_fonts.count(key)) return;
+		this->m_fonts[key];
+	}
+	this->push([this, key, path, size]() {
+		std::vector<GlyphBitmap> glyphs = rasterize(path, size);
+		{
+			std::lock_guard<std::mutex> lock(this->m_mutex);
+			FontRequest& request = this->m_fonts[key];
+			request.glyphs = std::move(glyphs);
+			request.ready = true;
+		}
+		this->m_resultReady.notify_all();
+	});
+}
+
+void AssetLoader::upload(double budgetSeconds) {
+	const auto start = std::chrono::steady_clock::now();
+	while (true) {
+		size_t i = 0;
+		std::string path;
+		bool flipTexture = false;
+		{
+			std::lock_guard<std::mutex> lock(this->m_mutex);
+			// the oldest model that is parsed and not uploaded yet
+			while (i < this->m_models.size() && (this->m_models[i].taken || !this->m_models[i].ready)) i++;
+			if (i >= this->m_models.size()) return;
+			path = this->m_models[i].path;
+			flipTexture = this->m_models[i].flipTexture;
+		}
+
+		// the registry takes the parsed model back out through takeModel()
+		std::shared_ptr<ModelAsset> asset = AssetRegistry::get().loadModel(path, flipTexture);
+		{
+			std::lock_guard<std::mutex> lock(this->m_mutex);
+			ModelRequest& request = this->m_models[i];
+			if (!request.taken) request.parsed = ParsedModel(); // the registry already had it
+			request.taken = true;
+			this->m_uploaded.push_back(std::move(asset));
+		}
+
+		if (std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() >= budgetSeconds) return;
+	}
+}
+
+float AssetLoader::getProgress() const {
+	std::lock_guard<std::mutex> lock(this->m_mutex);
+	size_t total = this->m_models.size() + this->m_images.size() + this->m_fonts.size();
+	size_t done = 0;
+	for (const ModelRequest& request : this->m_models) done += request.taken;
+	for (const auto& [key, request] : this->m_images) done += request.ready;
+	for (const auto& [key, request] : this->m_fonts) done += request.ready;
+	return total > 0 ? (float)done / total : 1.f;
+}
+
+bool AssetLoader::isDone() const {
+	std::lock_guard<std::mutex> lock(this->m_mutex);
+	if (!this->m_jobs.empty() || this->m_busyWorkers > 0) return false;
+	for (const ModelRequest& request : this->m_models) {
+		if (!request.taken) return false;
+	}
+	return true;
+}
+
+bool AssetLoader::takeModel(const std::string& path, ParsedModel& model) {
+	std::unique_lock<std::mutex> lock(this->m_mutex);
+	auto it = std::find_if(this->m_models.begin(), this->m_models.end(), [&](const ModelRequest& request) { return request.path == path; });
+	if (it == this->m_models.end() || it->taken) return false;
+	ModelRequest& request = *it;
+	this->m_resultReady.wait(lock, [&]() { return request.ready; });
+	model = std::move(request.parsed);
+	request.taken = true;
+	return true;
+}
+
+const DecodedImage* AssetLoader::findImage(const std::string& path, bool flip) {
+	std::unique_lock<std::mutex> lock(this->m_mutex);
+	auto it = this->m_images.find(imageKey(path, flip));
+	if (it == this->m_images.end()) return nullptr;
+	ImageRequest& request = it->second;
+	this->m_resultReady.wait(lock, [&]() { return request.ready; });
+	return &request.image;
+}
+
+const CompressedImage* AssetLoader::findCompressed(const std::string& path, bool flip) {
+	std::unique_lock<std::mutex> lock(this->m_mutex);
+	auto it = this->m_images.find(compressedKey(path, flip));
+	if (it == this->m_images.end()) return nullptr;
+	ImageRequest& request = it->second;
+	this->m_resultReady.wait(lock, [&]() { return request.ready; });
+	return &request.compressed;
+}
+
+const std::vector<GlyphBitmap>* AssetLoader::findFont(const std::string& path, unsigned int size) {
+	std::unique_lock<std::mutex> lock(this->m_mutex);
+	auto it = this->m_fonts.find(fontKey(path, size));
+	if (it == this->m_fonts.end()) return nullptr;
+	FontRequest& request = it->second;
+	this->m_resultReady.wait(lock, [&]() { return request.ready; });
+	return &request.glyphs;
+}
+
+DecodedImage AssetLoader::decode(const std::string& path, bool flip) {
+	std::ifstream file(path, std::ios::binary | std::ios::ate);
+	if (!file) return DecodedImage();
+	std::vector<unsigned char> data((size_t)file.tellg());
+	file.seekg(0);
+	file.read((char*)data.data(), data.size());
+	return decode(data.data(), data.size(), flip);
+}
+
+DecodedImage AssetLoader::decode(const unsigned char* file, size_t size, bool flip) {
+	// stbi_set_flip_vertically_on_load is global, so flip here instead of racing other workers over it
+	DecodedImage image;
+	unsigned char* data = stbi_load_from_memory(file, (int)size, &image.width, &image.height, &image.components, 0);
+	if (!data) return image;
+
+	const size_t rowBytes = (size_t)image.width * image.components;
+	image.pixels.resize(rowBytes * image.height);
+	for (int row = 0; row < image.height; row++) {
+		const int source = flip ? image.height - 1 - row : row;
+		std::memcpy(&image.pixels[row * rowBytes], data + source * rowBytes, rowBytes);
+	}
+	stbi_image_free(data);
+	return image;
+}
+
+std::vector<GlyphBitmap> AssetLoader::rasterize(const std::string& font, unsigned int size) {
+	std::vector<GlyphBitmap> glyphs(128);
+
+	// a library per call, FreeType libraries can't be shared between threads
+	FT_Library ft;
+	if (FT_Init_FreeType(&ft)) {
+		Log::error("FREETYPE: Could not init FreeType Library");
+		return glyphs;
+	}
+	FT_Face face;
+	if (FT_New_Face(ft, font.c_str(), 0, &face)) {
+		Log::error("FREETYPE: Failed to load font {}", font);
+		FT_Done_FreeType(ft);
+		return glyphs;
+	}
+	FT_Set_Pixel_Sizes(face, 0, size);
+
+	for (unsigned int c = 0; c < glyphs.size(); c++) {
+		if (FT_Load_Char(face, c, FT_LOAD_RENDER)) {
+			Log::error("FREETYPE: Failed to load Glyph {}", c);
+			continue;
+		}
+		const FT_GlyphSlot slot = face->glyph;
+		GlyphBitmap& glyph = glyphs[c];
+		glyph.width = slot->bitmap.width;
+		glyph.rows = slot->bitmap.rows;
+		glyph.left = slot->bitmap_left;
+		glyph.top = slot->bitmap_top;
+		glyph.advance = slot->advance.x;
+		// rows are tightly packed for GL_UNPACK_ALIGNMENT 1, FreeType's pitch may pad them
+		glyph.pixels.resize((size_t)glyph.width * glyph.rows);
+		for (int row = 0; row < glyph.rows; row++) {
+			std::memcpy(&glyph.pixels[(size_t)row * glyph.width], slot->bitmap.buffer + row * slot->bitmap.pitch, glyph.width);
+		}
+	}
+
+	FT_Done_Face(face);
+	FT_Done_FreeType(ft);
+	return glyphs;
+}
+
+unsigned int AssetLoader::defaultNumWorkers() {
+	const unsigned int hardwareThreads = std::thread::hardware_concurrency();
+	return hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+}
+
+void AssetLoader::work() {
+	while (true) {
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> lock(this->m_mutex);
+			this->m_jobAdded.wait(lock, [this]() { return this->m_stopping || !this->m_jobs.empty(); });
+			if (this->m_jobs.empty()) return;
+			job = std::move(this->m_jobs.front());
+			this->m_jobs.pop_front();
+			this->m_busyWorkers++;
+		}
+		job();
+		{
+			std::lock_guard<std::mutex> lock(this->m_mutex);
+			this->m_busyWorkers--;
+		}
+		this->m_resultReady.notify_all();
+	}
+}
+
+void AssetLoader::push(std::function<void()> job) {
+	{
+		std::lock_guard<std::mutex> lock(this->m_mutex);
+		this->m_jobs.push_back(std::move(job));
+	}
+	this->m_jobAdded.notify_one();
+}
+
+bool AssetLoader::claimImage(const std::string& key) {
+	std::lock_guard<std::mutex> lock(this->m_mutex);
+	return this->m_images.try_emplace(key).second;
+}
+
+void AssetLoader::decodeInto(const std::string& key, const std::string& path, bool flip) {
+	DecodedImage image = decode(path, flip);
+	{
+		std::lock_guard<std::mutex> lock(this->m_mutex);
+		ImageRequest& request = this->m_images[key];
+		request.image = std::move(image);
+		request.ready = true;
+	}
+	this->m_resultReady.notify_all();
+}
+
+void AssetLoader::compressInto(const std::string& key, const std::string& path, bool flip) {
+	CompressedImage image = TextureCache::get().load(path, flip);
+	{
+		std::lock_guard<std::mutex> lock(this->m_mutex);
+		ImageRequest& request = this->m_images[key];
+		request.compressed = std::move(image);
+		request.ready = true;
+	}
+	this->m_resultReady.notify_all();
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "AssetRegistry.h"
+#include "TextureCache.h"
+
+// one rendered FreeType glyph, what TextRenderer packs into its atlas
+struct GlyphBitmap {
+	int width = 0;
+	int rows = 0;
+	int left = 0;
+	int top = 0;
+	unsigned int advance = 0;
+	std::vector<unsigned char> pixels;
+};
+
+// Loads the game's files on worker threads before the code that needs them asks for them. Workers
+// parse models (AssetRegistry::parseModel), decode or compress images (TextureCache) and rasterize
+// fonts, and never touch GL.
+// The GL thread uploads finished models a few at a time with upload() between loading screen frames;
+// textures and fonts are picked up when their Texture, Skybox or TextRenderer is constructed.
+// Anything that was never requested still loads on the spot, the way it always did.
+class AssetLoader {
+
+public:
+	static AssetLoader& get() { static AssetLoader shared; return shared; }
+
+	void start(unsigned int numWorkers = defaultNumWorkers());
+	// joins the workers and drops every result, including the models upload() was holding on to.
+	// GL thread, once whatever uses the models holds its own reference.
+	void finish();
+	bool isRunning() const;
+
+	// queue a file for the workers, ignored unless the loader is running
+	void requestModel(const std::string& path, bool flipTexture = false);
+	void requestImage(const std::string& path, bool flip);
+	void requestFont(const std::string& path, unsigned int size);
+
+	// GL thread. uploads parsed models through the AssetRegistry, oldest request first, until
+	// budgetSeconds is spent or none is ready. a model is never split, so one can overrun the budget.
+	void upload(double budgetSeconds);
+	// done requests (models once uploaded) over all requests so far, textures found in models included
+	float getProgress() const;
+	bool isDone() const;
+
+	// the results, waiting for a worker that is still at it. false/null if it was never requested.
+	// models move out to the caller, images and fonts stay until finish() for anyone else using them.
+	bool takeModel(const std::string& path, ParsedModel& model);
+	const DecodedImage* findImage(const std::string& path, bool flip);
+	// model textures, compressed instead of decoded while the TextureCache is enabled
+	const CompressedImage* findCompressed(const std::string& path, bool flip);
+	const std::vector<GlyphBitmap>* findFont(const std::string& path, unsigned int size);
+
+	// the work itself, on whichever thread calls them
+	static DecodedImage decode(const std::string& path, bool flip);
+	static DecodedImage decode(const unsigned char* file, size_t size, bool flip);
+	static std::vector<GlyphBitmap> rasterize(const std::string& font, unsigned int size); // ASCII 0-127
+
+	// hardware threads - 1, the GL thread keeps the last one
+	static unsigned int defaultNumWorkers();
+
+private:
+	// the registry is created first so it outlives the models held in m_uploaded
+	AssetLoader() { AssetRegistry::get(); }
+	~AssetLoader();
+
+	struct ModelRequest {
+		std::string path;
+		bool flipTexture = false;
+		ParsedModel parsed;
+		bool ready = false;
+		bool taken = false;
+	};
+
+	struct ImageRequest {
+		DecodedImage image;
+		CompressedImage compressed;
+		bool ready = false;
+	};
+
+	struct FontRequest {
+		std::vector<GlyphBitmap> glyphs;
+		bool ready = false;
+	};
+
+	void work();
+	void push(std::function<void()> job);
+	// the image entry for key, claimed (true) if this caller is the one that has to decode it
+	bool claimImage(const std::string& key);
+	void decodeInto(const std::string& key, const std::string& path, bool flip);
+	void compressInto(const std::string& key, const std::string& path, bool flip);
+
+	mutable std::mutex m_mutex;
+	std::condition_variable m_jobAdded;
+	std::condition_variable m_resultReady;
+	std::deque<std::function<void()>> m_jobs;
+	int m_busyWorkers = 0;
+	bool m_stopping = false;
+	std::vector<std::thread> m_workers;
+
+	std::deque<ModelRequest> m_models; // deque so workers can hold on to their entry while it grows
+	std::unordered_map<std::string, ImageRequest> m_images; // "path" or "path|flip", compressed ones end in "|bc"
+	std::unordered_map<std::string, FontRequest> m_fonts; // "path|size"
+	std::vector<std::shared_ptr<ModelAsset>> m_uploaded; // keeps uploaded models alive until finish()
+};
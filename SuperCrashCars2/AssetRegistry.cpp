@@ -0,0 +1,423 @@
+#include "AssetRegistry.h"
+
+#include "AssetLoader.h"
+#include "MeshSimplifier.h"
+
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+ModelAsset::~ModelAsset() {
+	// GL objects can only go from the thread that owns the context, anything else is left to the driver at exit
+	const bool canFree = !Utils::instance().headless && glfwGetCurrentContext() != nullptr;
+	if (canFree) {
+		for (Mesh& mesh : this->meshes) mesh.free();
+	}
+
+	AssetRegistry& registry = AssetRegistry::get();
+	std::lock_guard<std::mutex> lock(registry.m_mutex);
+	for (const std::string& key : this->textures) {
+		auto texture = registry.m_textures.find(key);
+		if (texture == registry.m_textures.end() || --texture->second.refs > 0) continue;
+		if (canFree) glDeleteTextures(1, &texture->second.id);
+		registry.m_bytes -= texture->second.bytes;
+		registry.m_textures.erase(texture);
+	}
+	registry.m_bytes -= this->geometryBytes;
+	// a load may already have replaced the entry while this was waiting for the lock
+	auto it = registry.m_models.find(this->path);
+	if (it != registry.m_models.end() && it->second.expired()) registry.m_models.erase(it);
+}
+
+std::shared_ptr<ModelAsset> AssetRegistry::loadModel(const std::string& path, bool flipTexture) {
+	const std::string key = path + (flipTexture ? "|flip" : "");
+
+	std::lock_guard<std::mutex> lock(this->m_mutex);
+	auto it = this->m_models.find(key);
+	if (it != this->m_models.end()) {
+		if (std::shared_ptr<ModelAsset> asset = it->second.lock()) {
+			this->m_modelHits++;
+			this->m_bytesSaved += asset->bytes;
+			return asset;
+		}
+	}
+
+	std::shared_ptr<ModelAsset> asset = std::make_shared<ModelAsset>();
+	asset->path = key;
+	ImportState state{ *asset, path.substr(0, path.find_last_of('/')), flipTexture };
+
+	// parsed on a loader worker if it was requested there, otherwise right here
+	ParsedModel parsed;
+	if (!AssetLoader::get().takeModel(path, parsed)) this->parseModel(path, parsed);
+	if (!parsed.ok) return asset; // empty, and not cached so the next load tries again
+
+	const auto start = std::chrono::steady_clock::now();
+	for (ParsedMesh& mesh : parsed.meshes) {
+		if (Utils::instance().headless) mesh.textures.clear(); // headless only needs the geometry
+		for (TexMesh& texture : mesh.textures) {
+			texture.id = this->acquireTexture(state, state.directory + '/' + texture.path);
+		}
+		if (mesh.packedVertices) asset->meshes.emplace_back(mesh.layout, mesh.packedVertices, mesh.numPackedVertices, mesh.indices, mesh.textures, mesh.lods);
+		else asset->meshes.emplace_back(mesh.vertices, mesh.indices, mesh.textures, mesh.lods);
+	}
+	this->m_uploadSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	if (!Utils::instance().headless) {
+		for (const Mesh& mesh : asset->meshes) {
+			asset->geometryBytes += mesh.getGPUBytes();
+		}
+	}
+	this->m_bytes += asset->geometryBytes;
+	asset->bytes = asset->geometryBytes;
+	for (const std::string& texture : asset->textures) asset->bytes += this->m_textures[texture].bytes;
+	this->m_models[key] = asset;
+	return asset;
+}
+
+bool AssetRegistry::parseModel(const std::string& path, ParsedModel& model) {
+	const auto start = std::chrono::steady_clock::now();
+
+	const AssetBake* bake = this->openBake();
+	size_t bakedSize = 0;
+	const unsigned char* baked = bake ? bake->find(path, bakedSize) : nullptr;
+	const bool fromBake = baked && this->parseBaked(path, baked, bakedSize, model);
+
+	if (!fromBake) {
+		Assimp::Importer importer;
+		const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs);
+
+		if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
+			Log::error("{}", importer.GetErrorString());
+			return false;
+		}
+
+		this->processNode(model, scene->mRootNode, scene);
+	}
+	model.ok = true;
+
+	// coarser levels for distant draws, headless never draws. a baked model brought its own
+	if (!Utils::instance().headless && !fromBake) {
+		std::vector<glm::vec3> positions;
+		for (ParsedMesh& mesh : model.meshes) {
+			positions.clear();
+			for (const Vertex& vertex : mesh.vertices) positions.push_back(vertex.Position);
+			mesh.lods = MeshSimplifier::generate(positions, mesh.indices, Mesh::MAX_LODS);
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(this->m_parseMutex);
+	if (fromBake) this->m_bakedModels++;
+	else this->m_importedModels++;
+	this->m_parseSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	return true;
+}
+
+const AssetBake* AssetRegistry::openBake() {
+	std::lock_guard<std::mutex> lock(this->m_parseMutex);
+	if (!this->m_useBake) return nullptr;
+	if (!this->m_bakeOpened) {
+		this->m_bake.open();
+		this->m_bakeOpened = true;
+	}
+	return this->m_bake.isOpen() ? &this->m_bake : nullptr;
+}
+
+void AssetRegistry::setUseBake(bool useBake) {
+	std::lock_guard<std::mutex> lock(this->m_parseMutex);
+	this->m_useBake = useBake;
+}
+
+size_t AssetRegistry::getBytes() const {
+	std::lock_guard<std::mutex> lock(this->m_mutex);
+	return this->m_bytes;
+}
+
+size_t AssetRegistry::getBytesSaved() const {
+	std::lock_guard<std::mutex> lock(this->m_mutex);
+	return this->m_bytesSaved;
+}
+
+void AssetRegistry::logStats() const {
+	std::lock_guard<std::mutex> lock(this->m_mutex);
+	Log::info("Assets: {} models, {} textures, {:.1f} MB on the GPU. Sharing saved {:.1f} MB ({} model and {} texture loads)",
+		this->m_models.size(), this->m_textures.size(), this->m_bytes / (1024.0 * 1024.0), this->m_bytesSaved / (1024.0 * 1024.0), this->m_modelHits, this->m_textureHits);
+	std::lock_guard<std::mutex> parseLock(this->m_parseMutex);
+	Log::info("Assets: parsing took {:.2f} s over all threads, {} models from the bake and {} imported with assimp. Uploading took {:.2f} s",
+		this->m_parseSeconds, this->m_bakedModels, this->m_importedModels, this->m_uploadSeconds);
+}
+
+namespace {
+	// bounds checked reads from a baked model blob
+	struct BlobReader {
+		const unsigned char* data;
+		size_t size;
+		size_t cursor = 0;
+		bool ok = true;
+
+		const unsigned char* take(size_t count) {
+			if (!ok || cursor + count > size) {
+				ok = false;
+				return nullptr;
+			}
+			const unsigned char* bytes = data + cursor;
+			cursor += count;
+			return bytes;
+		}
+
+		template<typename T>
+		T read() {
+			T value{};
+			if (const unsigned char* bytes = take(sizeof(T))) std::memcpy(&value, bytes, sizeof(T));
+			return value;
+		}
+
+		std::string readString() {
+			const uint32_t length = read<uint32_t>();
+			const unsigned char* bytes = take(length);
+			return bytes ? std::string((const char*)bytes, length) : std::string();
+		}
+	};
+
+	// the sizes only say the blob is long enough, an index past the vertices would be fetched by the GPU
+	bool indicesInRange(const std::vector<unsigned int>& indices, unsigned int numVertices) {
+		for (unsigned int index : indices) {
+			if (index >= numVertices) return false;
+		}
+		return true;
+	}
+}
+
+// see AssetBake for the layout. vertices stay in the mapping and go to GL straight from it
+bool AssetRegistry::parseBaked(const std::string& path, const unsigned char* data, size_t size, ParsedModel& model) {
+	BlobReader reader{ data, size };
+	const uint32_t numMeshes = reader.read<uint32_t>();
+	for (uint32_t m = 0; m < numMeshes && reader.ok; m++) {
+		ParsedMesh mesh;
+		mesh.layout.texCoords = reader.read<uint8_t>() != 0;
+		mesh.layout.halfTexCoords = reader.read<uint8_t>() != 0;
+		mesh.numPackedVertices = reader.read<uint32_t>();
+		const uint32_t numIndices = reader.read<uint32_t>();
+		const uint32_t numTextures = reader.read<uint32_t>();
+
+		for (uint32_t t = 0; t < numTextures && reader.ok; t++) {
+			TexMesh texture;
+			texture.id = 0;
+			texture.type = reader.readString();
+			texture.path = reader.readString();
+			mesh.textures.push_back(texture);
+		}
+
+		mesh.packedVertices = reader.take((size_t)mesh.numPackedVertices * mesh.layout.stride());
+		const unsigned char* indexBytes = reader.take((size_t)numIndices * sizeof(unsigned int));
+		if (!reader.ok) break;
+		mesh.indices.resize(numIndices);
+		std::memcpy(mesh.indices.data(), indexBytes, mesh.indices.size() * sizeof(unsigned int));
+		if (!indicesInRange(mesh.indices, mesh.numPackedVertices)) {
+			reader.ok = false;
+			break;
+		}
+
+		// the levels MeshSimplifier made when this was baked
+		const uint32_t numLods = reader.read<uint32_t>();
+		const unsigned char* countBytes = reader.take((size_t)numLods * sizeof(unsigned int));
+		if (!reader.ok) break;
+		mesh.lods.counts.resize(numLods);
+		std::memcpy(mesh.lods.counts.data(), countBytes, mesh.lods.counts.size() * sizeof(unsigned int));
+		size_t numLodIndices = 0;
+		for (unsigned int count : mesh.lods.counts) numLodIndices += count;
+		const unsigned char* lodIndexBytes = reader.take(numLodIndices * sizeof(unsigned int));
+		if (!reader.ok) break;
+		mesh.lods.indices.resize(numLodIndices);
+		std::memcpy(mesh.lods.indices.data(), lodIndexBytes, mesh.lods.indices.size() * sizeof(unsigned int));
+		if (!indicesInRange(mesh.lods.indices, mesh.numPackedVertices)) {
+			reader.ok = false;
+			break;
+		}
+		model.meshes.push_back(std::move(mesh));
+	}
+
+	if (!reader.ok) {
+		Log::error("Baked data for {} is corrupt, loading the source", path);
+		model.meshes.clear();
+		return false;
+	}
+	return true;
+}
+
+void AssetRegistry::processNode(ParsedModel& model, aiNode* node, const aiScene* scene) {
+	for (unsigned int i = 0; i < node->mNumMeshes; i++) {
+		aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
+		model.meshes.push_back(this->processMesh(mesh, scene));
+	}
+	for (unsigned int i = 0; i < node->mNumChildren; i++) {
+		this->processNode(model, node->mChildren[i], scene);
+	}
+}
+
+ParsedMesh AssetRegistry::processMesh(aiMesh* mesh, const aiScene* scene) {
+	ParsedMesh parsed;
+	std::vector<Vertex>& vertices = parsed.vertices;
+	std::vector<unsigned int>& indices = parsed.indices;
+	std::vector<TexMesh>& textures = parsed.textures;
+
+	for (unsigned int i = 0; i < mesh->mNumVertices; i++) {
+		Vertex vertex;
+
+		glm::vec3 vector;
+		vector.x = mesh->mVertices[i].x;
+		vector.y = mesh->mVertices[i].y;
+		vector.z = mesh->mVertices[i].z;
+		vertex.Position = vector;
+
+		if (mesh->HasNormals()) {
+			vector.x = mesh->mNormals[i].x;
+			vector.y = mesh->mNormals[i].y;
+			vector.z = mesh->mNormals[i].z;
+			vertex.Normal = vector;
+		}
+
+		if (mesh->mTextureCoords[0]) {
+			glm::vec2 vec;
+
+			vec.x = mesh->mTextureCoords[0][i].x;
+			vec.y = mesh->mTextureCoords[0][i].y;
+			vertex.TexCoords = vec;
+		} else vertex.TexCoords = glm::vec2(0.0f, 0.0f);
+
+
+		vertices.push_back(vertex);
+	}
+
+	for (unsigned int i = 0; i < mesh->mNumFaces; i++) {
+		aiFace face = mesh->mFaces[i];
+		for (unsigned int j = 0; j < face.mNumIndices; j++)
+			indices.push_back(face.mIndices[j]);
+	}
+
+	if (mesh->mMaterialIndex >= 0) {
+		aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
+
+		// Shaders
+		// diffuse: texture_diffuseN
+		// specular: texture_specularN
+		// normal: texture_normalN
+
+		// 1. diffuse maps
+		std::vector<TexMesh> diffuseMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse");
+		textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
+		// 2. specular maps
+		std::vector<TexMesh> specularMaps = loadMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular");
+		textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
+		// 3. normal maps
+		std::vector<TexMesh> normalMaps = loadMaterialTextures(material, aiTextureType_HEIGHT, "texture_normal");
+		textures.insert(textures.end(), normalMaps.begin(), normalMaps.end());
+		// 4. height maps
+		std::vector<TexMesh> heightMaps = loadMaterialTextures(material, aiTextureType_AMBIENT, "texture_height");
+		textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
+
+	}
+	return parsed;
+}
+
+std::vector<TexMesh> AssetRegistry::loadMaterialTextures(aiMaterial* mat, aiTextureType type, const std::string& typeName) {
+	std::vector<TexMesh> textures;
+	for (unsigned int i = 0; i < mat->GetTextureCount(type); i++) {
+		aiString str;
+		mat->GetTexture(type, i, &str);
+
+		TexMesh texture;
+		texture.id = 0;
+		texture.type = typeName;
+		texture.path = str.C_Str();
+		textures.push_back(texture);
+	}
+	return textures;
+}
+
+// one reference per asset, however many of its meshes use the texture
+unsigned int AssetRegistry::acquireTexture(ImportState& state, const std::string& filename) {
+	const std::string key = filename + (state.flipTexture ? "|flip" : "");
+	TextureEntry& entry = this->m_textures[key];
+
+	const bool ownedByAsset = std::find(state.asset.textures.begin(), state.asset.textures.end(), key) != state.asset.textures.end();
+	if (ownedByAsset) return entry.id;
+
+	state.asset.textures.push_back(key);
+	if (entry.refs++ > 0) {
+		this->m_textureHits++;
+		this->m_bytesSaved += entry.bytes;
+		return entry.id;
+	}
+
+	entry.id = this->textureFromFile(filename, state.flipTexture, entry.bytes);
+	this->m_bytes += entry.bytes;
+	return entry.id;
+}
+
+unsigned int AssetRegistry::textureFromFile(const std::string& filename, bool flipTexture, size_t& bytes) {
+	unsigned int textureID;
+	glGenTextures(1, &textureID);
+	glBindTexture(GL_TEXTURE_2D, textureID);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+	// block compressed with its mips, compressed on a loader worker if it was requested there
+	if (TextureCache::get().isEnabled()) {
+		CompressedImage loaded;
+		const CompressedImage* compressed = AssetLoader::get().findCompressed(filename, flipTexture);
+		if (!compressed) {
+			loaded = TextureCache::get().load(filename, flipTexture);
+			compressed = &loaded;
+		}
+		if (compressed->valid()) {
+			TextureCache::upload(*compressed);
+			bytes = compressed->bytes();
+			return textureID;
+		}
+		Log::error("Texture failed to load at path: {}", filename);
+		return textureID;
+	}
+
+	// decoded on a loader worker if it was requested there
+	DecodedImage decoded;
+	const DecodedImage* image = AssetLoader::get().findImage(filename, flipTexture);
+	if (!image) {
+		decoded = AssetLoader::decode(filename, flipTexture);
+		image = &decoded;
+	}
+
+	if (image->valid()) {
+
+		GLuint format = GL_RGB;
+		switch (image->components) {
+			case 4:
+				format = GL_RGBA;
+				break;
+			case 3:
+				format = GL_RGB;
+				break;
+			case 2:
+				format = GL_RG;
+				break;
+			case 1:
+				format = GL_RED;
+				break;
+			default:
+				Log::error("Invalid Texture Format");
+				break;
+		};
+
+		glTexImage2D(GL_TEXTURE_2D, 0, format, image->width, image->height, 0, format, GL_UNSIGNED_BYTE, image->pixels.data());
+		glGenerateMipmap(GL_TEXTURE_2D);
+		bytes = TextureCache::uncompressedBytes(*image, true);
+
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	} else {
+		Log::error("Texture failed to load at path: {}", filename);
+	}
+
+	return textureID;
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Mesh.h"
+#include "AssetBake.h"
+
+// geometry and textures of one model file, shared by every Model loaded from that file.
+// freed (GPU buffers included) when the last Model using it goes away.
+struct ModelAsset {
+	std::string path;
+	std::vector<Mesh> meshes;
+	std::vector<std::string> textures; // registry keys, released together with the asset
+	size_t geometryBytes = 0; // vertex and index buffers
+	size_t bytes = 0; // geometry plus textures, what another load of the same file would have cost
+
+	~ModelAsset();
+};
+
+// one mesh as read from disk, before anything touches GL
+struct ParsedMesh {
+	std::vector<Vertex> vertices; // imported with assimp
+	VertexLayout layout; // baked: vertices already packed in this layout
+	const unsigned char* packedVertices = nullptr; // into the mapped AssetBake
+	unsigned int numPackedVertices = 0;
+	std::vector<unsigned int> indices;
+	std::vector<TexMesh> textures; // type and path, ids are filled in on upload
+	MeshLods lods; // generated after importing or read from the bake, see MeshSimplifier
+};
+
+struct ParsedModel {
+	std::vector<ParsedMesh> meshes;
+	bool ok = false;
+};
+
+// reference counted cache of models and textures keyed by path, so loading the same file twice
+// doesn't import it or upload it again.
+class AssetRegistry {
+
+public:
+	static AssetRegistry& get() { static AssetRegistry shared; return shared; }
+
+	std::shared_ptr<ModelAsset> loadModel(const std::string& path, bool flipTexture);
+	// reads a model file (from the bake when it has it) without touching GL, safe on any thread.
+	// loadModel() uses what AssetLoader parsed ahead of time, or calls this itself.
+	bool parseModel(const std::string& path, ParsedModel& model);
+	// whether models come from the mapped AssetBake when it has them (the default) or always from assimp
+	void setUseBake(bool useBake);
+
+	// GPU memory the registry holds and what sharing saved so far
+	size_t getBytes() const;
+	size_t getBytesSaved() const;
+	void logStats() const;
+
+private:
+	AssetRegistry() {}
+
+	struct TextureEntry {
+		unsigned int id = 0;
+		int refs = 0;
+		size_t bytes = 0;
+	};
+
+	// what one upload needs to hand out its textures
+	struct ImportState {
+		ModelAsset& asset;
+		std::string directory;
+		bool flipTexture;
+	};
+
+	// null when bakes are off or there is none
+	const AssetBake* openBake();
+	bool parseBaked(const std::string& path, const unsigned char* data, size_t size, ParsedModel& model);
+	void processNode(ParsedModel& model, aiNode* node, const aiScene* scene);
+	ParsedMesh processMesh(aiMesh* mesh, const aiScene* scene);
+	std::vector<TexMesh> loadMaterialTextures(aiMaterial* mat, aiTextureType type, const std::string& typeName);
+
+	unsigned int acquireTexture(ImportState& state, const std::string& filename);
+	void releaseTexture(const std::string& key);
+	unsigned int textureFromFile(const std::string& filename, bool flipTexture, size_t& bytes);
+
+	friend struct ModelAsset;
+
+	mutable std::mutex m_mutex;
+	std::unordered_map<std::string, std::weak_ptr<ModelAsset>> m_models;
+	std::unordered_map<std::string, TextureEntry> m_textures;
+
+	size_t m_bytes = 0;
+	size_t m_bytesSaved = 0;
+	int m_modelHits = 0;
+	int m_textureHits = 0;
+
+	double m_uploadSeconds = 0.0; // in loadModel, on the GL thread
+
+	// parsing runs on loader workers too, so the bake and its stats have their own lock
+	mutable std::mutex m_parseMutex;
+	AssetBake m_bake;
+	bool m_useBake = true;
+	bool m_bakeOpened = false; // opened on the first parse
+	int m_bakedModels = 0;
+	int m_importedModels = 0;
+	double m_parseSeconds = 0.0; // summed over every thread that parsed
+};
@@ -399,6 +399,8 @@ void AudioManager::backToMainMenu() {
 
 
 void AudioManager::playSound(std::string soundName, float soundVolume) {
+	if (!this->system) return; // never initialised, e.g. headless runs
+
 	FMOD::Sound* sound = mSounds[soundName];
 
 	FMOD::Channel* channel;
@@ -413,6 +415,8 @@ void AudioManager::playSound(std::string soundName, float soundVolume) {
 }
 
 void AudioManager::playSound(std::string soundName, glm::vec3 position, float soundVolume) {
+	if (!this->system) return; // never initialised, e.g. headless runs
+
 	FMOD::Sound* sound = mSounds[soundName];
 
 	FMOD::Channel* channel;
@@ -114,7 +114,7 @@ public:
 	void setListenerPosition(glm::vec3 position, glm::vec3 forward, glm::vec3 up);
 	
 
-	FMOD::System* system;
+	FMOD::System* system = nullptr;
 	BGMState bgmState;
 
 	void startCarSounds();
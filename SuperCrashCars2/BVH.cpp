@@ -0,0 +1,85 @@
+#include "BVH.h"
+
+#include <algorithm>
+
+void BVH::build(const std::vector<AABB>& bounds) {
+	this->clear();
+	this->m_bounds = bounds;
+	for (int i = 0; i < (int)bounds.size(); i++) {
+		if (bounds[i].valid()) this->m_items.push_back(i);
+	}
+	if (this->m_items.empty()) return;
+	this->m_nodes.reserve(this->m_items.size() * 2);
+	this->m_nodes.emplace_back();
+	this->buildNode(0, 0, (int)this->m_items.size());
+}
+
+void BVH::clear() {
+	this->m_nodes.clear();
+	this->m_items.clear();
+	this->m_bounds.clear();
+}
+
+// top down, halving the items along the longest axis of their centers
+void BVH::buildNode(int index, int begin, int end) {
+	AABB bounds, centers;
+	for (int i = begin; i < end; i++) {
+		bounds.add(this->m_bounds[this->m_items[i]]);
+		centers.add(this->m_bounds[this->m_items[i]].center());
+	}
+	this->m_nodes[index].bounds = bounds;
+
+	if (end - begin <= MAX_LEAF_ITEMS) {
+		this->m_nodes[index].first = begin;
+		this->m_nodes[index].count = end - begin;
+		return;
+	}
+
+	const glm::vec3 size = centers.max - centers.min;
+	const int axis = size.x > size.y && size.x > size.z ? 0 : (size.y > size.z ? 1 : 2);
+	const int middle = (begin + end) / 2;
+	std::nth_element(this->m_items.begin() + begin, this->m_items.begin() + middle, this->m_items.begin() + end, [&](int a, int b) {
+		return this->m_bounds[a].center()[axis] < this->m_bounds[b].center()[axis];
+	});
+
+	// the children sit next to each other, so an inner node only keeps the left one's index
+	const int left = (int)this->m_nodes.size();
+	this->m_nodes.resize(left + 2);
+	this->m_nodes[index].first = left;
+	this->m_nodes[index].count = 0;
+	this->buildNode(left, begin, middle);
+	this->buildNode(left + 1, middle, end);
+}
+
+void BVH::query(const Frustum& frustum, std::vector<int>& visible) const {
+	if (this->m_nodes.empty()) return;
+	int stack[64];
+	int size = 0;
+	stack[size++] = 0;
+	while (size > 0) {
+		const Node& node = this->m_nodes[stack[--size]];
+		const Frustum::Result result = frustum.test(node.bounds);
+		if (result == Frustum::Result::eOUTSIDE) continue;
+		if (result == Frustum::Result::eINSIDE) {
+			this->addAll(node, visible);
+			continue;
+		}
+		if (node.count > 0) {
+			for (int i = node.first; i < node.first + node.count; i++) {
+				if (frustum.isVisible(this->m_bounds[this->m_items[i]])) visible.push_back(this->m_items[i]);
+			}
+			continue;
+		}
+		stack[size++] = node.first;
+		stack[size++] = node.first + 1;
+	}
+}
+
+void BVH::addAll(const Node& node, std::vector<int>& visible) const {
+	if (node.count > 0) {
+		for (int i = node.first; i < node.first + node.count; i++) visible.push_back(this->m_items[i]);
+		return;
+	}
+	this->addAll(this->m_nodes[node.first], visible);
+	this->addAll(this->m_nodes[node.first + 1], visible);
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <vector>
+
+#include "Bounds.h"
+
+// Bounding volume hierarchy over things that never move, built once from their world bounds.
+// Items are referred to by their index in the vector build() was given.
+class BVH {
+
+public:
+	static constexpr int MAX_LEAF_ITEMS = 2;
+
+	void build(const std::vector<AABB>& bounds);
+	void clear();
+	int getNumItems() const { return (int)this->m_items.size(); }
+
+	// indices of every item whose bounds the frustum touches, in no particular order. whole subtrees
+	// inside the frustum are taken without testing their items again.
+	void query(const Frustum& frustum, std::vector<int>& visible) const;
+
+private:
+	struct Node {
+		AABB bounds;
+		int first = 0; // leaf: first of m_items, inner: the left child (the right one is first + 1)
+		int count = 0; // items in a leaf, 0 for inner nodes
+	};
+
+	void buildNode(int index, int begin, int end);
+	void addAll(const Node& node, std::vector<int>& visible) const;
+
+	std::vector<Node> m_nodes; // root first
+	std::vector<int> m_items;
+	std::vector<AABB> m_bounds;
+};
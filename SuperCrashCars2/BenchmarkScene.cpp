@@ -0,0 +1,56 @@
+#include "BenchmarkScene.h"
+
+BenchmarkScene::BenchmarkScene() :
+	m_pm(1.3f / 60.0f)
+{
+	this->vehicles = {
+		new PVehicle(0, this->m_pm, VehicleType::eAVA_GREEN, PlayerOrAI::eAI, PxVec3(0.0f, 25.f, 200.0f)),
+		new PVehicle(1, this->m_pm, VehicleType::eAVA_BLUE, PlayerOrAI::eAI, PxVec3(0.0f, 25.f, -200.f)),
+		new PVehicle(2, this->m_pm, VehicleType::eAVA_RED, PlayerOrAI::eAI, PxVec3(200.0f, 25.0f, 0.0f)),
+		new PVehicle(3, this->m_pm, VehicleType::eAVA_YELLOW, PlayerOrAI::eAI, PxVec3(-200.0f, 25.0f, 0.0f))
+	};
+	this->snapshots.resize(this->vehicles.size());
+	glGenQueries(1, &this->m_query);
+}
+
+BenchmarkScene::~BenchmarkScene() {
+	glDeleteQueries(1, &this->m_query);
+	for (PVehicle* vehicle : this->vehicles) {
+		vehicle->free();
+		delete vehicle;
+	}
+	this->m_pm.free();
+}
+
+double BenchmarkScene::run(RenderManager& renderer, PxU32 frames, const std::function<void()>& render, const std::function<void()>& measured) {
+	double total = 0.0;
+	for (PxU32 frame = 0; frame < WARMUP_FRAMES + frames; frame++) {
+		for (PxU32 i = 0; i < this->vehicles.size(); i++) {
+			this->vehicles[i]->accelerate(1.0f);
+			if ((frame / 120 + i) % 2 == 0) this->vehicles[i]->turnLeft(0.5f);
+			else this->vehicles[i]->turnRight(0.5f);
+		}
+		this->m_pm.simulate();
+		for (PVehicle* vehicle : this->vehicles) vehicle->updateInputs();
+		this->m_pm.updateVehicles();
+		for (PVehicle* vehicle : this->vehicles) vehicle->updatePhysics();
+		for (size_t i = 0; i < this->vehicles.size(); i++) this->vehicles[i]->writeSnapshot(this->snapshots[i]);
+
+		renderer.startFrame(); // clears, or the last frame's depth would reject most of this one
+
+		glBeginQuery(GL_TIME_ELAPSED, this->m_query);
+		render();
+		glEndQuery(GL_TIME_ELAPSED);
+
+		GLuint64 elapsed = 0; // nanoseconds, waits for the GPU which is fine here
+		glGetQueryObjectui64v(this->m_query, GL_QUERY_RESULT, &elapsed);
+		if (frame < WARMUP_FRAMES) continue;
+		total += elapsed / 1000000.0;
+		if (measured) measured();
+	}
+	return total / frames;
+}
+
+void BenchmarkScene::followCar(std::vector<Camera*>& cameraList, int viewport) const {
+	cameraList.at(viewport)->updateCameraPosition(Utils::instance().pxToGlmVec3(this->snapshots[viewport].currPose.p), this->snapshots[viewport].frontVec);
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "RenderManager.h"
+
+#include <functional>
+#include <vector>
+
+// The scene the render benchmarks share: 4 cars driving circles that change direction every two
+// seconds, so the cameras see the map from everywhere and the shadow casters keep moving.
+// Needs a current GL context since the cars load their models.
+class BenchmarkScene {
+
+public:
+	BenchmarkScene();
+	~BenchmarkScene();
+
+	// steps the cars and renders warm-up frames, then frames measured ones. every frame starts with
+	// renderer.startFrame() and times render() with a GPU query; measured() runs after each measured
+	// frame for whatever else a benchmark counts. returns the average GPU time in milliseconds.
+	double run(RenderManager& renderer, PxU32 frames, const std::function<void()>& render, const std::function<void()>& measured = nullptr);
+
+	// points viewport's camera at its car
+	void followCar(std::vector<Camera*>& cameraList, int viewport) const;
+
+	std::vector<PVehicle*> vehicles;
+	std::vector<VehicleSnapshot> snapshots;
+	const std::vector<PowerUp*> powerUps; // none, the benchmarks measure the cars and the map
+	const std::vector<PowerUpSnapshot> powerUpStates;
+
+	static const PxU32 WARMUP_FRAMES = 30;
+
+private:
+	PhysicsManager m_pm;
+	GLuint m_query = 0;
+};
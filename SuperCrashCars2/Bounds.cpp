@@ -0,0 +1,56 @@
+#include "Bounds.h"
+
+#include <cmath>
+
+void AABB::add(const glm::vec3& point) {
+	this->min = glm::min(this->min, point);
+	this->max = glm::max(this->max, point);
+}
+
+void AABB::add(const AABB& box) {
+	if (!box.valid()) return;
+	this->min = glm::min(this->min, box.min);
+	this->max = glm::max(this->max, box.max);
+}
+
+AABB AABB::transformed(const glm::mat4& TM) const {
+	if (!this->valid()) return *this;
+	// center moves with the matrix, the extent grows by the absolute value of its rotation and scale
+	const glm::vec3 center = glm::vec3(TM * glm::vec4(this->center(), 1.0f));
+	const glm::vec3 extent = this->extent();
+	glm::vec3 newExtent(0.0f);
+	for (int axis = 0; axis < 3; axis++) newExtent += glm::abs(glm::vec3(TM[axis])) * extent[axis];
+
+	AABB box;
+	box.min = center - newExtent;
+	box.max = center + newExtent;
+	return box;
+}
+
+// Gribb & Hartmann: each plane is the last row of the matrix plus or minus one of the others
+Frustum::Frustum(const glm::mat4& viewProjection) {
+	glm::vec4 rows[4];
+	for (int i = 0; i < 4; i++) rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+	this->planes[0] = rows[3] + rows[0]; // left
+	this->planes[1] = rows[3] - rows[0]; // right
+	this->planes[2] = rows[3] + rows[1]; // bottom
+	this->planes[3] = rows[3] - rows[1]; // top
+	this->planes[4] = rows[3] + rows[2]; // near
+	this->planes[5] = rows[3] - rows[2]; // far
+	for (glm::vec4& plane : this->planes) plane /= glm::length(glm::vec3(plane));
+}
+
+Frustum::Result Frustum::test(const AABB& box) const {
+	if (!box.valid()) return Result::eOUTSIDE;
+	const glm::vec3 center = box.center();
+	const glm::vec3 extent = box.extent();
+	Result result = Result::eINSIDE;
+	for (const glm::vec4& plane : this->planes) {
+		const glm::vec3 normal(plane);
+		const float distance = glm::dot(normal, center) + plane.w;
+		const float radius = glm::dot(glm::abs(normal), extent);
+		if (distance < -radius) return Result::eOUTSIDE;
+		if (distance < radius) result = Result::eINTERSECTS;
+	}
+	return result;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "glm/glm.hpp"
+
+#include <limits>
+
+// axis aligned box, empty (min > max) until something is added to it
+struct AABB {
+	glm::vec3 min = glm::vec3(std::numeric_limits<float>::max());
+	glm::vec3 max = glm::vec3(-std::numeric_limits<float>::max());
+
+	bool valid() const { return min.x <= max.x && min.y <= max.y && min.z <= max.z; }
+	glm::vec3 center() const { return 0.5f * (min + max); }
+	glm::vec3 extent() const { return 0.5f * (max - min); }
+
+	void add(const glm::vec3& point);
+	void add(const AABB& box);
+	// the box around this one after TM, which is a little looser than the transformed shape
+	AABB transformed(const glm::mat4& TM) const;
+};
+
+// the six clip planes of a view-projection matrix, in world space, normals pointing inwards
+struct Frustum {
+	enum class Result { eOUTSIDE, eINTERSECTS, eINSIDE };
+
+	glm::vec4 planes[6];
+
+	// culls nothing until it is given a matrix
+	Frustum() { for (glm::vec4& plane : this->planes) plane = glm::vec4(0.0f); }
+	explicit Frustum(const glm::mat4& viewProjection);
+
+	Result test(const AABB& box) const;
+	// conservative, a box in none of the planes' outsides counts as visible
+	bool isVisible(const AABB& box) const { return test(box) != Result::eOUTSIDE; }
+};
+
+// objects a pass tested against its frustum and how many it skipped, summed over a frame
+struct CullStats {
+	int tested = 0;
+	int culled = 0;
+};
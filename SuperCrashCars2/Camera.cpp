@@ -158,10 +158,8 @@ void Camera::updateCameraPosition(glm::vec3 carPosition, glm::vec3 frontVector)
 }
 
 void Camera::sendMatricesToShader() {
-	GLint viewLoc = glGetUniformLocation(*Utils::instance().shader, "V");
-	GLint projectionLoc = glGetUniformLocation(*Utils::instance().shader, "P");
-	glUniformMatrix4fv(viewLoc, 1, GL_FALSE, &this->V[0][0]);
-	glUniformMatrix4fv(projectionLoc, 1, GL_FALSE, &this->P[0][0]);
+	Utils::instance().shader->setMat4("V", this->V);
+	Utils::instance().shader->setMat4("P", this->P);
 }
 
 void Camera::UpdateVP() {
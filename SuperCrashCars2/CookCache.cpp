@@ -0,0 +1,171 @@
+#include "CookCache.h"
+
+#include "Log.h"
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+
+namespace {
+	// FNV-1a, good enough to tell cooking inputs apart
+	uint64_t hashBytes(const void* data, size_t size, uint64_t hash) {
+		const unsigned char* bytes = (const unsigned char*)data;
+		for (size_t i = 0; i < size; i++) {
+			hash ^= bytes[i];
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	template<typename T>
+	uint64_t hashValue(T value, uint64_t hash) {
+		return hashBytes(&value, sizeof(T), hash);
+	}
+
+	const uint64_t HASH_SEED = 14695981039346656037ull;
+}
+
+PxTriangleMesh* CookCache::createTriangleMesh(PxPhysics& physics, PxCooking& cooking, const PxVec3* verts, PxU32 numVerts, const PxU32* indices, PxU32 numIndices) {
+	const auto start = std::chrono::steady_clock::now();
+
+	uint64_t hash = hashValue((PxU32)PX_PHYSICS_VERSION, HASH_SEED);
+	hash = hashParams(cooking.getParams(), hash);
+	hash = hashBytes(verts, numVerts * sizeof(PxVec3), hash);
+	hash = hashBytes(indices, numIndices * sizeof(PxU32), hash);
+	const std::string path = this->pathFor("tri", hash);
+
+	std::vector<PxU8> data;
+	if (this->read(path, data)) {
+		PxDefaultMemoryInputData input(data.data(), (PxU32)data.size());
+		if (PxTriangleMesh* mesh = physics.createTriangleMesh(input)) {
+			this->addTime(true, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+			return mesh;
+		}
+		Log::warning("Cooked mesh {} didn't load, cooking it again", path);
+	}
+
+	PxTriangleMeshDesc meshDesc;
+	meshDesc.points.count = numVerts;
+	meshDesc.points.stride = sizeof(PxVec3);
+	meshDesc.points.data = verts;
+
+	meshDesc.triangles.count = numIndices / 3;
+	meshDesc.triangles.stride = 3 * sizeof(PxU32);
+	meshDesc.triangles.data = indices;
+
+	PxDefaultMemoryOutputStream writeBuffer;
+	PxTriangleMeshCookingResult::Enum result;
+	if (!cooking.cookTriangleMesh(meshDesc, writeBuffer, &result)) return NULL;
+	this->write(path, writeBuffer);
+
+	PxDefaultMemoryInputData readBuffer(writeBuffer.getData(), writeBuffer.getSize());
+	PxTriangleMesh* mesh = physics.createTriangleMesh(readBuffer);
+	this->addTime(false, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+	return mesh;
+}
+
+PxConvexMesh* CookCache::createConvexMesh(PxPhysics& physics, PxCooking& cooking, const PxVec3* verts, PxU32 numVerts) {
+	const auto start = std::chrono::steady_clock::now();
+
+	uint64_t hash = hashValue((PxU32)PX_PHYSICS_VERSION, HASH_SEED);
+	hash = hashParams(cooking.getParams(), hash);
+	hash = hashBytes(verts, numVerts * sizeof(PxVec3), hash);
+	const std::string path = this->pathFor("convex", hash);
+
+	std::vector<PxU8> data;
+	if (this->read(path, data)) {
+		PxDefaultMemoryInputData input(data.data(), (PxU32)data.size());
+		if (PxConvexMesh* mesh = physics.createConvexMesh(input)) {
+			this->addTime(true, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+			return mesh;
+		}
+		Log::warning("Cooked mesh {} didn't load, cooking it again", path);
+	}
+
+	PxConvexMeshDesc convexDesc;
+	convexDesc.points.count = numVerts;
+	convexDesc.points.stride = sizeof(PxVec3);
+	convexDesc.points.data = verts;
+	convexDesc.flags = PxConvexFlag::eCOMPUTE_CONVEX;
+
+	PxDefaultMemoryOutputStream buf;
+	if (!cooking.cookConvexMesh(convexDesc, buf)) return NULL;
+	this->write(path, buf);
+
+	PxDefaultMemoryInputData input(buf.getData(), buf.getSize());
+	PxConvexMesh* mesh = physics.createConvexMesh(input);
+	this->addTime(false, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+	return mesh;
+}
+
+void CookCache::logStats() const {
+	std::lock_guard<std::mutex> lock(this->m_mutex);
+	Log::info("PhysX cook cache: {} meshes loaded in {:.1f} ms, {} cooked in {:.1f} ms", this->m_hits, this->m_hitSeconds * 1000.0, this->m_misses, this->m_missSeconds * 1000.0);
+}
+
+uint64_t CookCache::hashParams(const PxCookingParams& params, uint64_t hash) {
+	// field by field, the struct has padding
+	hash = hashValue(params.areaTestEpsilon, hash);
+	hash = hashValue(params.planeTolerance, hash);
+	hash = hashValue((PxU32)params.convexMeshCookingType, hash);
+	hash = hashValue(params.suppressTriangleMeshRemapTable, hash);
+	hash = hashValue(params.buildTriangleAdjacencies, hash);
+	hash = hashValue(params.buildGPUData, hash);
+	hash = hashValue(params.scale.length, hash);
+	hash = hashValue(params.scale.speed, hash);
+	hash = hashValue((PxU32)params.meshPreprocessParams, hash);
+	hash = hashValue(params.meshWeldTolerance, hash);
+	hash = hashValue((PxU32)params.midphaseDesc.getType(), hash);
+	if (params.midphaseDesc.getType() == PxMeshMidPhase::eBVH33) {
+		hash = hashValue(params.midphaseDesc.mBVH33Desc.meshSizePerformanceTradeOff, hash);
+		hash = hashValue((PxU32)params.midphaseDesc.mBVH33Desc.meshCookingHint, hash);
+	} else {
+		hash = hashValue(params.midphaseDesc.mBVH34Desc.numPrimsPerLeaf, hash);
+	}
+	hash = hashValue(params.gaussMapLimit, hash);
+	return hash;
+}
+
+std::string CookCache::pathFor(const char* kind, uint64_t hash) const {
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx", (unsigned long long)hash);
+	return std::string(DIRECTORY) + "/" + kind + "_" + name + ".bin";
+}
+
+bool CookCache::read(const std::string& path, std::vector<PxU8>& data) const {
+	std::ifstream file(path, std::ios::binary | std::ios::ate);
+	if (!file) return false;
+	data.resize((size_t)file.tellg());
+	file.seekg(0);
+	file.read((char*)data.data(), data.size());
+	return (bool)file && !data.empty();
+}
+
+void CookCache::write(const std::string& path, const PxDefaultMemoryOutputStream& stream) const {
+	std::error_code error;
+	std::filesystem::create_directories(DIRECTORY, error);
+	// write then rename, so a crash never leaves half a stream under the real name
+	const std::string temporary = path + ".tmp";
+	{
+		std::ofstream file(temporary, std::ios::binary);
+		file.write((const char*)stream.getData(), stream.getSize());
+		if (!file) {
+			Log::warning("Could not write cooked mesh {}", path);
+			return;
+		}
+	}
+	std::filesystem::rename(temporary, path, error);
+	if (error) std::filesystem::remove(temporary, error);
+}
+
+void CookCache::addTime(bool hit, double seconds) {
+	std::lock_guard<std::mutex> lock(this->m_mutex);
+	if (hit) {
+		this->m_hits++;
+		this->m_hitSeconds += seconds;
+	} else {
+		this->m_misses++;
+		this->m_missSeconds += seconds;
+	}
+}
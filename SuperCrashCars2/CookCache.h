@@ -0,0 +1,43 @@
+#pragma once
+
+#include "PxPhysicsAPI.h"
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace physx;
+
+// Cooked PhysX meshes kept on disk, so the ground's triangle mesh and the convex hulls of the cars,
+// wheels and power ups are only cooked once. A cooked stream is keyed by a hash of its source
+// geometry, the cooking params and the PhysX version, so any change to those cooks it again.
+// Streams that don't load (truncated, other PhysX build) are cooked again and overwritten.
+class CookCache {
+
+public:
+	static CookCache& get() { static CookCache shared; return shared; }
+
+	static constexpr const char* DIRECTORY = "cache/physx";
+
+	PxTriangleMesh* createTriangleMesh(PxPhysics& physics, PxCooking& cooking, const PxVec3* verts, PxU32 numVerts, const PxU32* indices, PxU32 numIndices);
+	PxConvexMesh* createConvexMesh(PxPhysics& physics, PxCooking& cooking, const PxVec3* verts, PxU32 numVerts);
+
+	// hits, misses and the time spent getting meshes either way
+	void logStats() const;
+
+private:
+	CookCache() {}
+
+	static uint64_t hashParams(const PxCookingParams& params, uint64_t hash);
+	std::string pathFor(const char* kind, uint64_t hash) const;
+	bool read(const std::string& path, std::vector<PxU8>& data) const;
+	void write(const std::string& path, const PxDefaultMemoryOutputStream& stream) const;
+	void addTime(bool hit, double seconds);
+
+	mutable std::mutex m_mutex;
+	int m_hits = 0;
+	int m_misses = 0;
+	double m_hitSeconds = 0.0;
+	double m_missSeconds = 0.0;
+};
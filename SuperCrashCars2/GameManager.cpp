@@ -22,7 +22,7 @@ void GameManager::changeSelection(int plus) {
 			// do nothing, only one button 
 			break;
 		case MainMenuScreen::eOPTIONS_SCREEN: // in option screen
-			this->optionsButton = (OptionsButton)(((int)this->optionsButton + plus + 4) % 4);
+			this->optionsButton = (OptionsButton)(((int)this->optionsButton + plus + 5) % 5);
 			break;
 
 		}
@@ -63,6 +63,10 @@ void GameManager::incrementSlider(int right) {
 				else multiplayer60FPS = false;
 				AudioManager::get().playSound(SFX_INCREMENT, 0.4f);
 				break;
+			case OptionsButton::eSHADOWS:
+				shadowQuality = (ShadowQuality)(((int)shadowQuality + right + 4) % 4);
+				AudioManager::get().playSound(SFX_INCREMENT, 0.4f);
+				break;
 			case OptionsButton::eBACK: // nothing
 				break;
 			}
@@ -207,6 +211,15 @@ std::string GameManager::getMultiplayerFPS() {
 	else return std::string("30");
 }
 
+std::string GameManager::getShadowQuality() {
+	switch (shadowQuality) {
+	case ShadowQuality::eLEGACY: return std::string("Legacy");
+	case ShadowQuality::eLOW: return std::string("Low");
+	case ShadowQuality::eMEDIUM: return std::string("Medium");
+	default: return std::string("High");
+	}
+}
+
 std::string GameManager::printMenu() {
 	std::string str = "Current State:\n";
 
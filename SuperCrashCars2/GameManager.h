@@ -34,8 +34,17 @@ enum class OptionsButton {
 	eBGM,
 	eSFX,
 	eFPS,
+	eSHADOWS,
 	eBACK
 };
+
+// shadow map layout, see RenderManager::setShadowQuality
+enum class ShadowQuality {
+	eLEGACY,	// one 8192x8192 map over the whole arena, shared by every viewport
+	eLOW,		// 3 cascades of 1024x1024 fit to each camera
+	eMEDIUM,	// 4 cascades of 2048x2048
+	eHIGH		// 4 cascades of 4096x4096
+};
 enum class PlayerSelectButton {
 	eSELECTING,
 	eSTART
@@ -70,6 +79,7 @@ public:
 	bool quitGame = false;
 
 	bool multiplayer60FPS = false;
+	ShadowQuality shadowQuality = ShadowQuality::eMEDIUM;
 
 	int winner;
 	int playerNumber;
@@ -80,6 +90,7 @@ public:
 	void initMenu();
 	void togglePause();
 	std::string getMultiplayerFPS();
+	std::string getShadowQuality();
 	std::string printMenu();
 
 private:
@@ -0,0 +1,59 @@
+#include "GpuTimer.h"
+
+GpuTimer::GpuTimer() {
+	for (int f = 0; f < NUM_FRAMES; f++) {
+		for (int i = 0; i < MAX_QUERIES; i++) glGenQueries(1, &this->m_queries[f][i].id);
+	}
+	this->m_track = Profiler::get().addTrack("gpu");
+}
+
+void GpuTimer::beginFrame() {
+	this->m_frame = (this->m_frame + 1) % NUM_FRAMES;
+
+	// this set was issued NUM_FRAMES - 1 frames ago, anything still in flight is dropped rather than waited for.
+	for (int i = 0; i < this->m_count[this->m_frame]; i++) {
+		const Query& query = this->m_queries[this->m_frame][i];
+		GLint available = 0;
+		glGetQueryObjectiv(query.id, GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available) continue;
+
+		GLuint64 elapsed = 0; // nanoseconds
+		glGetQueryObjectui64v(query.id, GL_QUERY_RESULT, &elapsed);
+
+		ProfileEvent event;
+		event.name = query.name;
+		event.start = query.start;
+		event.duration = (int32_t)(elapsed / 1000);
+		event.depth = 0;
+		Profiler::get().record(this->m_track, event);
+	}
+	this->m_count[this->m_frame] = 0;
+	this->m_depth = 0;
+}
+
+void GpuTimer::begin(const char* name) {
+	if (this->m_depth++ > 0) return;
+	int& count = this->m_count[this->m_frame];
+	if (count >= MAX_QUERIES) return;
+
+	Query& query = this->m_queries[this->m_frame][count];
+	query.name = name;
+	query.start = Profiler::get().now();
+	glBeginQuery(GL_TIME_ELAPSED, query.id);
+}
+
+void GpuTimer::end() {
+	if (--this->m_depth > 0) return;
+	int& count = this->m_count[this->m_frame];
+	if (count >= MAX_QUERIES) return;
+
+	glEndQuery(GL_TIME_ELAPSED);
+	count++;
+}
+
+void GpuTimer::free() {
+	for (int f = 0; f < NUM_FRAMES; f++) {
+		for (int i = 0; i < MAX_QUERIES; i++) glDeleteQueries(1, &this->m_queries[f][i].id);
+		this->m_count[f] = 0;
+	}
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include "Profiler.h"
+
+// GL_TIME_ELAPSED queries around render passes, reported to the Profiler on a "gpu" track so they
+// show up in the overlay and the exported trace next to the CPU scopes. Queries are double
+// buffered: results are collected one frame late, so reading them never waits on the GPU.
+// Elapsed queries cannot nest, so a scope opened inside another one is not timed.
+// Usage (render thread only):
+//		gpuTimer.beginFrame();
+//		{ GPU_SCOPE(gpuTimer, "shadows"); renderer.renderShadows(...); }
+class GpuTimer {
+
+public:
+	GpuTimer(); // needs a current GL context
+	~GpuTimer() {};
+
+	// collects the previous frame's results, call once at the top of every frame.
+	void beginFrame();
+	void begin(const char* name);
+	void end();
+
+	void free();
+
+private:
+	static constexpr int MAX_QUERIES = 64; // per frame, scopes past this are not timed
+	static constexpr int NUM_FRAMES = 2;
+
+	struct Query {
+		GLuint id;
+		const char* name;
+		int64_t start; // CPU time the pass was issued, the GPU only tells us how long it took
+	};
+
+	Query m_queries[NUM_FRAMES][MAX_QUERIES];
+	int m_count[NUM_FRAMES] = {};
+	int m_frame = 0;
+	int m_depth = 0;
+	int m_track = -1;
+};
+
+class GpuScope {
+
+public:
+	GpuScope(GpuTimer& timer, const char* name) : m_timer(timer) { m_timer.begin(name); }
+	~GpuScope() { m_timer.end(); }
+	GpuScope(GpuScope const&) = delete;
+	void operator=(GpuScope const&) = delete;
+
+private:
+	GpuTimer& m_timer;
+};
+
+#define GPU_SCOPE(timer, name) GpuScope PROFILE_CONCAT(gpuScope, __LINE__)(timer, name)
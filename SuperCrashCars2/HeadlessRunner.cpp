@@ -0,0 +1,94 @@
+#include "HeadlessRunner.h"
+
+#include "Match.h"
+#include "PStatic.h"
+#include "Replay.h"
+#include "Time.h"
+#include "Log.h"
+
+#include <array>
+
+void HeadlessRunner::run(PxU32 numMatches, PxU32 maxTicks, PxU32 numWorkers, const std::string& recordPath, const std::string& replayPath) {
+	Time time = Time();
+	PhysicsManager pm = PhysicsManager(1.3f / 60.0f, numWorkers);
+
+	// same arena as the game, every car driven by the AI.
+	PVehicle car0 = PVehicle(0, pm, VehicleType::eAVA_GREEN, PlayerOrAI::eAI, PxVec3(0.0f, 25.f, 200.0f));
+	PVehicle car1 = PVehicle(1, pm, VehicleType::eAVA_BLUE, PlayerOrAI::eAI, PxVec3(0.0f, 25.f, -200.f));
+	PVehicle car2 = PVehicle(2, pm, VehicleType::eAVA_RED, PlayerOrAI::eAI, PxVec3(200.0f, 25.0f, 0.0f));
+	PVehicle car3 = PVehicle(3, pm, VehicleType::eAVA_YELLOW, PlayerOrAI::eAI, PxVec3(-200.0f, 25.0f, 0.0f));
+
+	PowerUp powerUp1 = PowerUp(pm, Model("models/powerups/jump_star/star.obj"), PowerUpType::eJUMP, PxVec3(70.f, 20.f, 110.f));
+	PowerUp powerUp2 = PowerUp(pm, Model("models/powerups/health_star/heart.obj"), PowerUpType::eHEALTH, PxVec3(115.f, 10.f, 20.f));
+	PowerUp powerUp3 = PowerUp(pm, Model("models/powerups/health_star/heart.obj"), PowerUpType::eHEALTH, PxVec3(-120.f, 25.f, -111.f));
+	PowerUp powerUp4 = PowerUp(pm, Model("models/powerups/jump_star/star.obj"), PowerUpType::eJUMP, PxVec3(77.f, 20.f, -113.f));
+	PowerUp powerUp5 = PowerUp(pm, Model("models/powerups/shield/shieldman.obj"), PowerUpType::eSHIELD, PxVec3(0.f, 20.f, 0.f));
+	PowerUp powerUp6 = PowerUp(pm, Model("models/powerups/shield/shieldman.obj"), PowerUpType::eSHIELD, PxVec3(-169.f, 32.f, 33.f));
+	PowerUp powerUp7 = PowerUp(pm, Model("models/powerups/shield/shieldman.obj"), PowerUpType::eSHIELD, PxVec3(0.f, 90.f, 0.f));
+
+	PStatic sphere = PStatic(pm, Model("models/sphere/sphere.obj"), PxVec3(0.f, 80.f, 0.f));
+
+	std::vector<PVehicle*> vehicleList = { &car0, &car1, &car2, &car3 };
+	std::vector<PowerUp*> powerUps = { &powerUp1, &powerUp2, &powerUp3, &powerUp4, &powerUp5, &powerUp6, &powerUp7 };
+	Match match(pm, vehicleList, powerUps, time.SIM_STEP);
+
+	Replay replay;
+	if (!replayPath.empty()) {
+		if (!replay.load(replayPath)) {
+			for (PVehicle* carPtr : vehicleList) carPtr->free();
+			pm.free();
+			return;
+		}
+		numMatches = 1;
+	}
+	else if (!recordPath.empty()) replay.record();
+	match.setReplay(&replay);
+
+	std::array<PxU32, 4> wins = {};
+	PxU32 draws = 0;
+	double totalTicks = 0.0;
+	double totalWallTime = 0.0;
+
+	Log::info("Headless: {} matches, {} ticks max each, {} physics workers.", numMatches, maxTicks, numWorkers);
+	for (PxU32 i = 0; i < numMatches; i++) {
+		time_point<steady_clock> start = steady_clock::now();
+		match.start(false, 0);
+		while (!match.isOver() && !replay.isFinished() && (PxU32)match.getTicks() < maxTicks) match.step(true);
+		const double wallTime = duration<double, std::milli>(steady_clock::now() - start).count();
+		const double gameTime = duration<double>(time.SIM_STEP * match.getTicks()).count();
+
+		if (match.isOver()) {
+			wins[match.getWinner()]++;
+			Log::info("Match {}: player {} wins after {} ticks ({:.1f}s game time) in {:.1f} ms", i + 1, match.getWinner() + 1, match.getTicks(), gameTime, wallTime);
+		}
+		else {
+			draws++;
+			Log::info("Match {}: draw after {} ticks ({:.1f}s game time) in {:.1f} ms", i + 1, match.getTicks(), gameTime, wallTime);
+		}
+		totalTicks += match.getTicks();
+		totalWallTime += wallTime;
+
+		const int winner = match.isOver() ? match.getWinner() : -1;
+		if (replay.isRecording()) {
+			replay.setResult(winner, match.getTicks()); // covers draws too
+			replay.save(recordPath);
+			replay.stop();
+		}
+		else if (replay.isPlaying()) {
+			if (winner == replay.getRecordedWinner() && (PxU32)match.getTicks() == replay.getRecordedTicks()) {
+				Log::info("Replay matches the recording.");
+			}
+			else {
+				Log::warning("Replay diverged: recorded winner {} after {} ticks, got winner {} after {} ticks", replay.getRecordedWinner() + 1, replay.getRecordedTicks(), winner + 1, match.getTicks());
+			}
+		}
+	}
+
+	if (numMatches > 0) {
+		Log::info("Wins: P1 {}  P2 {}  P3 {}  P4 {}  draws {}", wins[0], wins[1], wins[2], wins[3], draws);
+		Log::info("Average {:.0f} ticks and {:.1f} ms per match, {:.0f} ticks/s", totalTicks / numMatches, totalWallTime / numMatches, totalTicks / (totalWallTime / 1000.0));
+	}
+
+	for (PVehicle* carPtr : vehicleList) carPtr->free();
+	pm.free();
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include "PhysicsManager.h"
+
+#include <string>
+
+// Plays AI-only matches back to back with no window, GL context or audio, as fast as the CPU
+// allows, and logs each result plus a summary. Meant for balance tuning and for catching physics
+// regressions on machines without a GPU.
+class HeadlessRunner {
+
+public:
+	// maxTicks ends a round as a draw if nobody has won by then.
+	// recordPath saves the first match as a replay, replayPath plays one back instead of running the AI
+	// and reports whether it still ends the way it was recorded.
+	static void run(PxU32 numMatches, PxU32 maxTicks, PxU32 numWorkers, const std::string& recordPath = "", const std::string& replayPath = "");
+};
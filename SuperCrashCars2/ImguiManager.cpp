@@ -10,11 +10,26 @@ ImguiManager::ImguiManager(Window& window) {
 	ImGui_ImplOpenGL3_Init("#version 330");
 };
 
+ImguiManager::ImguiManager() {
+	IMGUI_CHECKVERSION();
+	ImGui::CreateContext();
+	ImGui::StyleColorsDark();
+	ImGui_ImplOpenGL3_Init("#version 330");
+	this->m_hasPlatform = false;
+};
+
 void ImguiManager::initFrame() {
 	ImGui_ImplOpenGL3_NewFrame();
 	ImGui_ImplGlfw_NewFrame();
 	ImGui::NewFrame();
 };
+void ImguiManager::initOverlayFrame(float deltaSeconds) {
+	ImGui_ImplOpenGL3_NewFrame();
+	ImGuiIO& io = ImGui::GetIO();
+	io.DisplaySize = ImVec2((float)Utils::instance().SCREEN_WIDTH, (float)Utils::instance().SCREEN_HEIGHT);
+	io.DeltaTime = deltaSeconds > 0.0f ? deltaSeconds : 1.0f / 60.0f;
+	ImGui::NewFrame();
+};
 void ImguiManager::endFrame() {
 	ImGui::Render();
 	ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
@@ -112,9 +127,53 @@ void ImguiManager::renderDamageHUD(const std::vector<PVehicle*>& carList) {
 	ImGui::End();
 };
 
+void ImguiManager::renderProfiler(const std::vector<PhaseStats>& stats, const CullStats& cameraCull, const CullStats& shadowCull, const RenderQueue::Stats& queue, const LodSelector::Stats& lod) {
+	ImGui::SetNextWindowPos(ImVec2(10.0f, 10.0f), ImGuiCond_FirstUseEver);
+	ImGui::SetNextWindowBgAlpha(0.7f);
+	ImGui::Begin("Profiler (F3 hide, F4 export)");
+
+	if (ImGui::BeginTable("phases", 5, ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingFixedFit)) {
+		ImGui::TableSetupColumn("phase");
+		ImGui::TableSetupColumn("calls");
+		ImGui::TableSetupColumn("p50 ms");
+		ImGui::TableSetupColumn("p99 ms");
+		ImGui::TableSetupColumn("max ms");
+		ImGui::TableHeadersRow();
+
+		const char* thread = nullptr;
+		for (const PhaseStats& phase : stats) {
+			if (phase.thread != thread) { // one header row per thread
+				thread = phase.thread;
+				ImGui::TableNextRow();
+				ImGui::TableSetColumnIndex(0);
+				ImGui::TextDisabled("[%s]", thread);
+			}
+			ImGui::TableNextRow();
+			ImGui::TableSetColumnIndex(0);
+			ImGui::Text("%*s%s", phase.depth * 2, "", phase.name);
+			ImGui::TableSetColumnIndex(1);
+			ImGui::Text("%d", phase.count);
+			ImGui::TableSetColumnIndex(2);
+			ImGui::Text("%.2f", phase.p50);
+			ImGui::TableSetColumnIndex(3);
+			ImGui::Text("%.2f", phase.p99);
+			ImGui::TableSetColumnIndex(4);
+			ImGui::Text("%.2f", phase.max);
+		}
+		ImGui::EndTable();
+	}
+
+	// last frame, every viewport and cascade added up
+	ImGui::Text("culled: %d / %d camera, %d / %d shadow", cameraCull.culled, cameraCull.tested, shadowCull.culled, shadowCull.tested);
+	ImGui::Text("draws: %d, state changes: %d (%d skipped)", queue.draws, queue.stateChanges, queue.redundant);
+	ImGui::Text("triangles: %zu (full detail %zu)", lod.triangles, lod.fullDetail);
+
+	ImGui::End();
+};
+
 void ImguiManager::freeImgui() {
 	ImGui_ImplOpenGL3_Shutdown();
-	ImGui_ImplGlfw_Shutdown();
+	if (this->m_hasPlatform) ImGui_ImplGlfw_Shutdown();
 	ImGui::DestroyContext();
 };
 
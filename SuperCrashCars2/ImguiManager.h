@@ -13,6 +13,10 @@
 #include "PVehicle.h"
 
 #include "GameManager.h"
+#include "Profiler.h"
+#include "Bounds.h"
+#include "RenderQueue.h"
+#include "LodSelector.h"
 
 
 
@@ -20,15 +24,22 @@ class ImguiManager {
 
 public:
 	ImguiManager(Window &window);
+	// display only, no GLFW backend: safe to create and use on the render thread.
+	ImguiManager();
 
 	void initFrame();
+	void initOverlayFrame(float deltaSeconds); // for the display-only constructor
 	void endFrame();
 	void renderStats(const PVehicle& player, int avgSimTime, int avgRenderTime);
 	void renderSliders(const PVehicle& player, const PVehicle& enemy);
 	void renderMenu(bool &AIToggle);
 	void renderPlayerHUD(const PVehicle& player);
 	void renderDamageHUD(const std::vector<PVehicle*>& carList);
+	void renderProfiler(const std::vector<PhaseStats>& stats, const CullStats& cameraCull, const CullStats& shadowCull, const RenderQueue::Stats& queue, const LodSelector::Stats& lod);
 
 	void freeImgui();
 
+private:
+	bool m_hasPlatform = true; // GLFW backend initialised
+
 };
\ No newline at end of file
@@ -101,7 +101,7 @@ void InputController::XboxInputInGame(PVehicle& p1) {
 		if (abs(axis[1]) > 0.25f) {
 			p1.rotateYAxis(axis[1]);
 		}
-		if (GLFW_PRESS == buttons[2]) p1.getRigidDynamic()->setAngularVelocity(p1.getRigidDynamic()->getAngularVelocity() * 0.7f);
+		if (GLFW_PRESS == buttons[2]) p1.airBrake(0.7f);
 		
 	}
 	else {
@@ -120,11 +120,11 @@ void InputController::XboxInputInGame(PVehicle& p1) {
 	if (GLFW_PRESS == buttons[3]) {
 		// the first time boost trigger is registered is different from the rest
 		p1.boost();
-		if (!p1.vehicleParams.boosting) p1.vehicleParams.boosting = true;
+		if (!p1.vehicleParams.boosting) p1.holdBoost(true);
 	}
-	else if (p1.vehicleParams.boosting) p1.vehicleParams.boosting = false;
+	else if (p1.vehicleParams.boosting) p1.holdBoost(false);
 
-	if (GLFW_PRESS == buttons[6]) p1.reset();
+	if (GLFW_PRESS == buttons[6]) p1.manualReset();
 
 	if (GLFW_PRESS == buttons[7]) { // pause - XBOX START button
 		if (!startHeld) {
@@ -154,7 +154,7 @@ void InputController::PS4InputInGame(PVehicle& p1) {
 		if (abs(axis[1]) > 0.25f) {
 			p1.rotateYAxis(axis[1]);
 		}
-		if (GLFW_PRESS == buttons[0]) p1.getRigidDynamic()->setAngularVelocity(p1.getRigidDynamic()->getAngularVelocity() * 0.97f);
+		if (GLFW_PRESS == buttons[0]) p1.airBrake(0.97f);
 
 	}
 	else { // if vehicle is on ground
@@ -171,11 +171,11 @@ void InputController::PS4InputInGame(PVehicle& p1) {
 	if (GLFW_PRESS == buttons[3]) {
 		// the first time boost trigger is registered is different from the rest
 		p1.boost();
-		if (!p1.vehicleParams.boosting) p1.vehicleParams.boosting = true;
+		if (!p1.vehicleParams.boosting) p1.holdBoost(true);
 	} 
-	else if (p1.vehicleParams.boosting) p1.vehicleParams.boosting = false;
+	else if (p1.vehicleParams.boosting) p1.holdBoost(false);
 
-	if (GLFW_PRESS == buttons[8]) p1.reset();
+	if (GLFW_PRESS == buttons[8]) p1.manualReset();
 
 	if (GLFW_PRESS == buttons[9]) { // pause - PS4 OPT button (start)
 		if (!startHeld) {
@@ -341,11 +341,11 @@ void InputController::NSInputInGame(PVehicle& p1) {
 	if (GLFW_PRESS == buttons[3]) {
 		// the first time boost trigger is registered is different from the rest
 		p1.boost();
-		if (!p1.vehicleParams.boosting) p1.vehicleParams.boosting = true;
+		if (!p1.vehicleParams.boosting) p1.holdBoost(true);
 	}
-	else if (p1.vehicleParams.boosting) p1.vehicleParams.boosting = false;
+	else if (p1.vehicleParams.boosting) p1.holdBoost(false);
 
-	if (GLFW_PRESS == buttons[8]) p1.reset();
+	if (GLFW_PRESS == buttons[8]) p1.manualReset();
 
 	if (GLFW_PRESS == buttons[9]) { // pause - PS4 OPT button (start)
 		if (!startHeld) {
@@ -0,0 +1,57 @@
+#include "LoadingScreen.h"
+
+#include "AssetLoader.h"
+
+#include <algorithm>
+#include <thread>
+
+LoadingScreen::LoadingScreen(Window& window) :
+	m_window(window),
+	m_shader("shaders/fullscreen.vert", "shaders/loading.frag"),
+	m_start(std::chrono::steady_clock::now())
+{
+	glGenVertexArrays(1, &this->m_VAO);
+	this->draw();
+}
+
+LoadingScreen::~LoadingScreen() {
+	glDeleteVertexArrays(1, &this->m_VAO);
+}
+
+void LoadingScreen::update() {
+	if (AssetLoader::get().isRunning()) AssetLoader::get().upload(UPLOAD_BUDGET);
+
+	const std::chrono::duration<double> sinceFrame = std::chrono::steady_clock::now() - this->m_lastFrame;
+	if (sinceFrame.count() < FRAME_TIME) return;
+	glfwPollEvents(); // keeps the OS from calling the window unresponsive
+	this->draw();
+}
+
+void LoadingScreen::waitForAssets() {
+	while (!AssetLoader::get().isDone()) {
+		this->update();
+		std::this_thread::yield();
+	}
+	this->m_progress = 1.f;
+	this->draw();
+}
+
+void LoadingScreen::draw() {
+	this->m_progress = std::max(this->m_progress, AssetLoader::get().getProgress());
+	const float seconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - this->m_start).count();
+
+	glViewport(0, 0, this->m_window.getWidth(), this->m_window.getHeight());
+	glDisable(GL_DEPTH_TEST);
+	glClear(GL_COLOR_BUFFER_BIT);
+
+	this->m_shader.use();
+	this->m_shader.setFloat("time", seconds);
+	this->m_shader.setFloat("progress", this->m_progress);
+	this->m_shader.setVector2("resolution", glm::vec2(this->m_window.getWidth(), this->m_window.getHeight()));
+	glBindVertexArray(this->m_VAO);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	glBindVertexArray(0);
+
+	this->m_window.swapBuffers();
+	this->m_lastFrame = std::chrono::steady_clock::now();
+}
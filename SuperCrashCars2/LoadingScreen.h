@@ -0,0 +1,37 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <chrono>
+
+#include "ShaderProgram.h"
+#include "Window.h"
+
+// What the window shows while the game starts up. It is a single fullscreen shader (a spinner and a
+// progress bar), so it needs no files besides its own two shaders and comes up right after the window.
+// Startup calls update() between its loading steps: that uploads what AssetLoader has ready for
+// up to UPLOAD_BUDGET, then draws a frame if one is due.
+class LoadingScreen {
+
+public:
+	static constexpr double UPLOAD_BUDGET = 0.008; // seconds of uploads per update
+	static constexpr double FRAME_TIME = 1.0 / 60.0;
+
+	// draws the first frame straight away
+	LoadingScreen(Window& window);
+	~LoadingScreen();
+
+	void update();
+	// updates until the loader has uploaded everything that was requested
+	void waitForAssets();
+
+private:
+	void draw();
+
+	Window& m_window;
+	ShaderProgram m_shader;
+	GLuint m_VAO = 0; // empty, core profile won't draw without one
+	std::chrono::steady_clock::time_point m_start;
+	std::chrono::steady_clock::time_point m_lastFrame;
+	float m_progress = 0.f; // only moves forward, the loader finds textures as it parses models
+};
@@ -0,0 +1,48 @@
+#include "LodBenchmark.h"
+
+#include "BenchmarkScene.h"
+#include "LodSelector.h"
+#include "Log.h"
+
+void LodBenchmark::run(RenderManager& renderer, std::vector<Camera*>& cameraList, PxU32 frames) {
+	const bool previous = LodSelector::get().isEnabled();
+	const int playerNumber = 4;
+
+	Log::info("LOD benchmark: {} frames per case, {} viewports, cars driving, cars and static world only.", frames, playerNumber);
+	Log::info("{:>11} | {:>15} | {:>15} | {:>9}", "levels", "triangles/frame", "full detail", "GPU ms");
+	for (int enabled = 0; enabled < 2; enabled++) {
+		LodSelector::get().setEnabled(enabled == 1);
+		const Result result = runCase(renderer, cameraList, frames);
+		Log::info("{:>11} | {:>15.0f} | {:>15.0f} | {:>9.2f}", enabled ? "selected" : "full detail", result.triangles, result.fullDetail, result.gpuMs);
+	}
+
+	LodSelector::get().setEnabled(previous);
+}
+
+LodBenchmark::Result LodBenchmark::runCase(RenderManager& renderer, std::vector<Camera*>& cameraList, PxU32 frames) {
+	BenchmarkScene scene;
+	const int playerNumber = (int)scene.vehicles.size();
+	Result result;
+	result.gpuMs = scene.run(renderer, frames, [&]() {
+		renderer.renderShadows(scene.vehicles, scene.snapshots, scene.powerUps, scene.powerUpStates, 1.0f);
+		for (int viewport = 0; viewport < playerNumber; viewport++) {
+			renderer.switchViewport(playerNumber, viewport);
+			scene.followCar(cameraList, viewport);
+			renderer.renderCascades(scene.vehicles, scene.snapshots, scene.powerUps, scene.powerUpStates, 1.0f);
+
+			renderer.beginQueue();
+			renderer.renderCars(scene.vehicles, scene.snapshots, 1.0f);
+			renderer.flushQueue();
+			renderer.renderStaticObjects(0.5);
+		}
+	}, [&]() {
+		// this frame's, before the next startFrame moves them to the renderer
+		const LodSelector::Stats stats = LodSelector::get().takeStats();
+		result.triangles += stats.triangles;
+		result.fullDetail += stats.fullDetail;
+	});
+
+	result.triangles /= frames;
+	result.fullDetail /= frames;
+	return result;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "RenderManager.h"
+
+#include <vector>
+
+// Renders the cars and the static world of a 4 player match, every camera following its car, once at
+// full detail and once with LodSelector picking levels, and logs the triangles submitted and the GPU
+// time per frame. Needs a current GL context and the renderer's static objects set.
+class LodBenchmark {
+
+public:
+	static void run(RenderManager& renderer, std::vector<Camera*>& cameraList, PxU32 frames = 300);
+
+private:
+	struct Result {
+		double triangles = 0.0; // per frame
+		double fullDetail = 0.0;
+		double gpuMs = 0.0;
+	};
+	static Result runCase(RenderManager& renderer, std::vector<Camera*>& cameraList, PxU32 frames);
+};
@@ -0,0 +1,59 @@
+#include "LodSelector.h"
+
+#include <algorithm>
+
+void LodSelector::setView(const glm::vec3& cameraPosition, float pixelsPerUnit, int view) {
+	this->m_numViews = 0;
+	this->addView(cameraPosition, pixelsPerUnit, view);
+}
+
+void LodSelector::addView(const glm::vec3& cameraPosition, float pixelsPerUnit, int view) {
+	if (this->m_numViews == MAX_VIEWS) return;
+	this->m_views[this->m_numViews++] = { cameraPosition, pixelsPerUnit, std::clamp(view, 0, MAX_VIEWS - 1) };
+}
+
+void LodSelector::clearView() {
+	this->m_numViews = 0;
+}
+
+void LodSelector::setEnabled(bool enabled) {
+	this->m_enabled = enabled;
+}
+
+bool LodSelector::isEnabled() const {
+	return this->m_enabled;
+}
+
+int LodSelector::select(const AABB& worldBounds, State& state) const {
+	if (!this->m_enabled || this->m_numViews == 0 || !worldBounds.valid()) return 0;
+
+	// every view keeps its own history even when they share the draw
+	int level = Mesh::MAX_LODS - 1;
+	for (int v = 0; v < this->m_numViews; v++) level = std::min(level, this->select(this->m_views[v], worldBounds, state));
+	return level;
+}
+
+int LodSelector::select(const View& view, const AABB& worldBounds, State& state) const {
+	const float radius = glm::length(worldBounds.extent());
+	const float distance = glm::length(worldBounds.center() - view.cameraPosition) - radius;
+	if (distance <= 0.0f) return state[view.index] = 0; // the camera is inside it
+	const float pixels = 2.0f * radius * view.pixelsPerUnit / distance;
+
+	// step from the last level, coarser only well below a threshold and finer only well above it
+	int level = state[view.index];
+	while (level + 1 < Mesh::MAX_LODS && pixels < THRESHOLDS[level + 1] * (1.0f - HYSTERESIS)) level++;
+	while (level > 0 && pixels > THRESHOLDS[level] * (1.0f + HYSTERESIS)) level--;
+	state[view.index] = (unsigned char)level;
+	return level;
+}
+
+void LodSelector::countTriangles(size_t triangles, size_t fullDetail) {
+	this->m_stats.triangles += triangles;
+	this->m_stats.fullDetail += fullDetail;
+}
+
+LodSelector::Stats LodSelector::takeStats() {
+	const Stats stats = this->m_stats;
+	this->m_stats = Stats();
+	return stats;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "glm/glm.hpp"
+
+#include <array>
+#include <cstddef>
+
+#include "Bounds.h"
+#include "Mesh.h"
+
+// Picks a mesh's level of detail (see MeshSimplifier) from how many pixels tall its bounding sphere is
+// in the current view. Every view has its own last choice per model, and a level only changes once
+// the size is HYSTERESIS past the threshold, so something hovering at a threshold doesn't pop.
+// Also counts the triangles draws submit, against what full detail would have been. Render thread only.
+class LodSelector {
+
+public:
+	static LodSelector& get() { static LodSelector shared; return shared; }
+
+	static constexpr int MAX_VIEWS = 5; // four viewports and the menu camera
+	// projected diameter in pixels below which level 1, 2 and 3 are drawn
+	static constexpr float THRESHOLDS[Mesh::MAX_LODS] = { 0.0f, 160.0f, 64.0f, 24.0f };
+	static constexpr float HYSTERESIS = 0.2f;
+
+	// per model, the level last picked in every view
+	using State = std::array<unsigned char, MAX_VIEWS>;
+
+	// the camera the next draws are seen from. pixelsPerUnit is the projection's P[1][1] times half
+	// the viewport's height, view is the viewport (4 for the menu camera)
+	void setView(const glm::vec3& cameraPosition, float pixelsPerUnit, int view);
+	// another camera the same draws are seen from (a single split-screen pass), they get the finest
+	// level any of the views picks
+	void addView(const glm::vec3& cameraPosition, float pixelsPerUnit, int view);
+	// full detail until the next setView, for what doesn't belong to one camera (the legacy shadow map)
+	void clearView();
+	void setEnabled(bool enabled);
+	bool isEnabled() const;
+
+	int select(const AABB& worldBounds, State& state) const;
+
+	struct Stats {
+		size_t triangles = 0;
+		size_t fullDetail = 0; // the same draws at level 0
+	};
+	void countTriangles(size_t triangles, size_t fullDetail);
+	Stats takeStats();
+
+private:
+	LodSelector() {}
+
+	struct View {
+		glm::vec3 cameraPosition;
+		float pixelsPerUnit;
+		int index;
+	};
+	// the level one view would pick, moving state on
+	int select(const View& view, const AABB& worldBounds, State& state) const;
+
+	View m_views[MAX_VIEWS] = {};
+	int m_numViews = 0; // 0: no view, full detail
+	bool m_enabled = true;
+	Stats m_stats;
+};
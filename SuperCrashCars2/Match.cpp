@@ -0,0 +1,192 @@
+#include "Match.h"
+
+#include "AudioManager.h"
+#include "SimClock.h"
+#include "Profiler.h"
+
+#include <climits>
+
+Match::Match(PhysicsManager& pm, std::vector<PVehicle*>& vehicleList, std::vector<PowerUp*>& powerUps, microseconds step) :
+	m_pm(pm),
+	m_vehicleList(vehicleList),
+	m_powerUps(powerUps),
+	m_step(step)
+{}
+
+void Match::start(bool singlePlayer, int playerNumber) {
+	SimClock::reset();
+
+	unsigned int seed = Utils::instance().random(0u, UINT_MAX);
+	if (this->m_replay && this->m_replay->isPlaying()) {
+		this->m_replay->rewind();
+		seed = this->m_replay->getSeed();
+		singlePlayer = this->m_replay->getSinglePlayer();
+	}
+	else if (this->m_replay && this->m_replay->isRecording()) {
+		this->m_replay->begin(seed, playerNumber, singlePlayer);
+	}
+	Utils::instance().seed(seed);
+
+	for (PVehicle* carPtr : this->m_vehicleList) {
+		carPtr->restart();
+	}
+	for (PowerUp* powerUpPtr : this->m_powerUps) {
+		powerUpPtr->forceRespawn();
+	}
+	this->m_singlePlayer = singlePlayer;
+	this->m_winner = -1;
+	this->m_ticks = 0;
+}
+
+void Match::step(bool aiEnabled) {
+	PROFILE_SCOPE("match step");
+	// the log drives every car during playback, the AI would only fight it.
+	const bool playingBack = this->m_replay && this->m_replay->isPlaying();
+	this->syncReplay(); // inputs from the controllers
+
+	this->handleCollisions();
+
+	int deadCounter = 0;
+	for (PVehicle* carPtr : this->m_vehicleList) {
+		if (carPtr->m_carType == PlayerOrAI::eAI && !playingBack) this->retargetAI(carPtr);
+		this->syncReplay();
+
+		carPtr->updateState(); // to check for car death
+		if (carPtr->m_state == VehicleState::eOUTOFLIVES) deadCounter++;
+	}
+
+	if (this->m_winner < 0) {
+		if (deadCounter == (this->m_vehicleList.size() - 1)) {
+			for (PVehicle* carPtr : this->m_vehicleList) {
+				if (carPtr->m_state != VehicleState::eOUTOFLIVES) this->m_winner = carPtr->carid;
+			}
+		}
+		// single player died first, set winner to 3 but not actually 3 because we are ending the game early
+		else if (this->m_singlePlayer && this->m_vehicleList[0]->m_state == VehicleState::eOUTOFLIVES) this->m_winner = 3;
+	}
+
+	this->updatePowerUps();
+	if (aiEnabled && !playingBack) this->driveAI();
+	this->syncReplay();
+
+	{
+		PROFILE_SCOPE("physics");
+		this->m_pm.simulate();
+	}
+
+	{
+		PROFILE_SCOPE("vehicle update");
+		for (PVehicle* vehicle : this->m_vehicleList) vehicle->updateInputs();
+		this->m_pm.updateVehicles(); // one batched raycast + update for every car
+		for (PVehicle* vehicle : this->m_vehicleList) vehicle->updatePhysics();
+	}
+	for (PowerUp* powerUpPtr : this->m_powerUps) powerUpPtr->update();
+
+	SimClock::advance(this->m_step);
+	this->m_ticks++;
+
+	if (this->isOver() && this->m_replay) this->m_replay->setResult(this->m_winner, this->m_ticks);
+}
+
+bool Match::isOver() const {
+	return this->m_winner >= 0;
+}
+
+int Match::getWinner() const {
+	return this->m_winner;
+}
+
+int Match::getTicks() const {
+	return this->m_ticks;
+}
+
+void Match::setReplay(Replay* replay) {
+	this->m_replay = replay;
+	for (PVehicle* carPtr : this->m_vehicleList) carPtr->setReplay(replay);
+}
+
+void Match::syncReplay() {
+	if (this->m_replay) this->m_replay->sync(this->m_vehicleList);
+}
+
+void Match::handleCollisions() {
+	for (PVehicle* carPtr : this->m_vehicleList) {
+		if (!carPtr->vehicleAttr.collided) continue;
+		carPtr->getRigidDynamic()->addForce((carPtr->vehicleAttr.forceToAdd), PxForceMode::eIMPULSE);
+		carPtr->getRigidDynamic()->addForce(PxVec3(0.f, 10.f + 5.f * carPtr->vehicleAttr.collisionCoefficient, 0.f), PxForceMode::eVELOCITY_CHANGE);
+		carPtr->flashWhite();
+		carPtr->vehicleAttr.collided = false;
+		AudioManager::get().playSound(SFX_CAR_HIT, Utils::instance().pxToGlmVec3(carPtr->vehicleAttr.collisionMidpoint), 0.3f);
+	}
+}
+
+void Match::retargetAI(PVehicle* carPtr) {
+	const time_point<steady_clock> now = SimClock::now();
+	if (!carPtr->vehicleAttr.reachedTarget && duration_cast<seconds>(now - carPtr->vehicleAttr.targetTimestamp) <= seconds(15)) return;
+
+	carPtr->vehicleAttr.targetTimestamp = now;
+	int halfChance = Utils::instance().random(0, 2);
+	if (halfChance == 0 || halfChance == 1) {
+		int rndIndex = Utils::instance().random(0, (int)this->m_vehicleList.size() - 1);
+		if (this->m_vehicleList[rndIndex] != carPtr && this->m_vehicleList[rndIndex]->m_state == VehicleState::ePLAYING) {
+			carPtr->vehicleAttr.reachedTarget = false;
+			carPtr->driveTo(this->m_vehicleList[rndIndex]->getPosition(), this->m_vehicleList[rndIndex], nullptr);
+		}
+	}
+	else {
+		int rndIndex = Utils::instance().random(0, (int)this->m_powerUps.size() - 1);
+		if (this->m_powerUps[rndIndex]->active) {
+			carPtr->vehicleAttr.reachedTarget = false;
+			carPtr->driveTo(this->m_powerUps[rndIndex]->getPosition(), nullptr, this->m_powerUps[rndIndex]);
+		}
+		else {
+			int rndIndex = Utils::instance().random(0, (int)this->m_vehicleList.size() - 1);
+			if (this->m_vehicleList[rndIndex] != carPtr && this->m_vehicleList[rndIndex]->m_state == VehicleState::ePLAYING) {
+				carPtr->vehicleAttr.reachedTarget = false;
+				carPtr->driveTo(this->m_vehicleList[rndIndex]->getPosition(), this->m_vehicleList[rndIndex], nullptr);
+			}
+		}
+	}
+}
+
+void Match::driveAI() {
+	PROFILE_SCOPE("ai");
+	for (PVehicle* carPtr : this->m_vehicleList) {
+		if (carPtr->m_carType == PlayerOrAI::ePLAYER) continue;
+		PVehicle* targetVehicle = (PVehicle*)carPtr->vehicleAttr.targetVehicle;
+		PowerUp* targetPowerUp = (PowerUp*)carPtr->vehicleAttr.targetPowerup;
+		if (targetVehicle) carPtr->driveTo(targetVehicle->getPosition(), targetVehicle, nullptr);
+		else if (targetPowerUp) carPtr->driveTo(targetPowerUp->getPosition(), nullptr, targetPowerUp);
+		else {
+			int halfChance = Utils::instance().random(0, 2);
+			if (halfChance == 0 || halfChance == 1) {
+				int rndIndex = Utils::instance().random(0, (int)this->m_vehicleList.size() - 1);
+				if (this->m_vehicleList[rndIndex] != carPtr && this->m_vehicleList[rndIndex]->m_state == VehicleState::ePLAYING) {
+					carPtr->driveTo(this->m_vehicleList[rndIndex]->getPosition(), this->m_vehicleList[rndIndex], nullptr);
+				}
+			}
+			else {
+				int rndIndex = Utils::instance().random(0, (int)this->m_powerUps.size() - 1);
+				if (this->m_powerUps[rndIndex]->active) carPtr->driveTo(this->m_powerUps[rndIndex]->getPosition(), nullptr, this->m_powerUps[rndIndex]);
+				else {
+					int rndIndex = Utils::instance().random(0, (int)this->m_vehicleList.size() - 1);
+					if (this->m_vehicleList[rndIndex] != carPtr && this->m_vehicleList[rndIndex]->m_state == VehicleState::ePLAYING) {
+						carPtr->driveTo(this->m_vehicleList[rndIndex]->getPosition(), this->m_vehicleList[rndIndex], nullptr);
+					}
+				}
+			}
+		}
+	}
+}
+
+void Match::updatePowerUps() {
+	for (PowerUp* powerUpPtr : this->m_powerUps) {
+		if (!powerUpPtr->active) {
+			powerUpPtr->tryRespawn();
+		}
+		else if (powerUpPtr->triggered) {
+			AudioManager::get().playSound(SFX_ITEM_COLLECT, Utils::instance().pxToGlmVec3(powerUpPtr->getPosition()), 0.3f);
+			powerUpPtr->collect();
+		}
+	}
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "PhysicsManager.h"
+#include "PVehicle.h"
+#include "PowerUp.h"
+#include "Replay.h"
+
+#include <chrono>
+#include <vector>
+
+using namespace std::chrono;
+
+// The gameplay side of a round: collisions, AI targeting, lives, power-ups and the physics step.
+// Shared by the windowed game and headless runs so both play exactly the same match.
+class Match {
+
+public:
+	Match(PhysicsManager& pm, std::vector<PVehicle*>& vehicleList, std::vector<PowerUp*>& powerUps, microseconds step);
+
+	// lives, damage, pockets, power-ups, positions, the game clock and the random seed back to the
+	// start of a round. singlePlayer ends the round as soon as car 0 is out of lives.
+	void start(bool singlePlayer, int playerNumber);
+	// advance the round by one fixed step.
+	void step(bool aiEnabled);
+
+	bool isOver() const;
+	int getWinner() const; // carid of the last car standing, -1 while the round is still going
+	int getTicks() const;
+
+	// record into or play back from this replay (nullptr for neither). While playing back the AI is
+	// switched off and every car is driven by the log.
+	void setReplay(Replay* replay);
+
+private:
+	PhysicsManager& m_pm;
+	std::vector<PVehicle*>& m_vehicleList;
+	std::vector<PowerUp*>& m_powerUps;
+	const microseconds m_step;
+	Replay* m_replay = nullptr;
+	bool m_singlePlayer = false;
+
+	int m_winner = -1;
+	int m_ticks = 0;
+
+	void handleCollisions();
+	void retargetAI(PVehicle* carPtr);
+	void driveAI();
+	void updatePowerUps();
+	void syncReplay();
+};
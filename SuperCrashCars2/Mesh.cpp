@@ -1,23 +1,134 @@
 #include "Mesh.h"
 
-Mesh::Mesh(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices, const std::vector<TexMesh>& textures) {
+#include "RenderQueue.h"
+#include "LodSelector.h"
+
+#include <glm/gtc/packing.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+Mesh::Mesh(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices, const std::vector<TexMesh>& textures, const MeshLods& lods) {
     this->m_vertices = vertices;
     this->m_indices = indices;
     this->m_textures = textures;
-    this->setupMesh();
+    this->nameSamplers();
+    this->chooseLayout();
+    this->computeBounds();
+    this->setLods(lods);
+    if (!Utils::instance().headless) this->setupMesh(this->packVertices().data());
+}
+
+Mesh::Mesh(const VertexLayout& layout, const unsigned char* packedVertices, unsigned int numVertices, const std::vector<unsigned int>& indices, const std::vector<TexMesh>& textures, const MeshLods& lods) {
+    // only the positions come back, they are the first thing in every packed vertex
+    this->m_vertices.resize(numVertices);
+    const unsigned int stride = layout.stride();
+    for (unsigned int i = 0; i < numVertices; i++) {
+        std::memcpy(&this->m_vertices[i].Position, packedVertices + (size_t)i * stride, 3 * sizeof(float));
+    }
+    this->m_indices = indices;
+    this->m_textures = textures;
+    this->m_layout = layout;
+    this->nameSamplers();
+    this->computeBounds();
+    this->setLods(lods);
+    if (!Utils::instance().headless) this->setupMesh(packedVertices);
+}
+
+void Mesh::draw(const glm::mat4& TM, int renderMode, int lod) {
+    const Lod& level = this->getLod(lod);
+    LodSelector::get().countTriangles(level.count / 3, this->m_indices.size() / 3);
+    if (Utils::instance().queue != nullptr) {
+        Utils::instance().queue->submit(*this, TM, renderMode, lod);
+        return;
+    }
+
+    const ShaderProgram& shader = *Utils::instance().shader;
+    this->bindTextures(shader);
+
+    glBindVertexArray(this->VAO);
+    glUniformMatrix4fv(shader.getModelLocation(), 1, GL_FALSE, &TM[0][0]);
+    glPolygonMode(GL_FRONT_AND_BACK, renderMode);
+    glDrawElementsInstanced(GL_TRIANGLES, level.count, GL_UNSIGNED_INT, (void*)(level.firstIndex * sizeof(unsigned int)), Utils::instance().numViews);
+    glBindVertexArray(0);
+
+    glActiveTexture(GL_TEXTURE0);
+}
+
+void Mesh::drawInstanced(const glm::mat4& TM, int renderMode, unsigned int instanceVBO, int count) {
+    if (count <= 0) return;
+    LodSelector::get().countTriangles(this->m_indices.size() / 3 * count, this->m_indices.size() / 3 * count);
+    if (Utils::instance().queue != nullptr) {
+        Utils::instance().queue->submit(*this, TM, renderMode, 0, instanceVBO, count);
+        return;
+    }
+
+    glBindVertexArray(this->instanceVAO(instanceVBO));
+
+    const ShaderProgram& shader = *Utils::instance().shader;
+    this->bindTextures(shader);
+
+    glUniformMatrix4fv(shader.getModelLocation(), 1, GL_FALSE, &TM[0][0]);
+    glPolygonMode(GL_FRONT_AND_BACK, renderMode);
+    glDrawElementsInstanced(GL_TRIANGLES, static_cast<unsigned int>(this->m_indices.size()), GL_UNSIGNED_INT, 0, count * Utils::instance().numViews);
+    glBindVertexArray(0);
+
+    glActiveTexture(GL_TEXTURE0);
 }
 
-void Mesh::draw(const glm::mat4& TM, int renderMode) {
+unsigned int Mesh::instanceVAO(unsigned int instanceVBO) {
+    if (this->m_instanceVAO == 0) {
+        glGenVertexArrays(1, &this->m_instanceVAO);
+        glBindVertexArray(this->m_instanceVAO);
+        this->setupAttributes();
+    }
+
+    // every instance is drawn once per view in a row, see Utils::numViews
+    const unsigned int divisor = (unsigned int)Utils::instance().numViews;
+    if (this->m_instanceVBO != instanceVBO || this->m_instanceDivisor != divisor) {
+        // a mat4 attribute is four vec4 columns, advanced once per instance
+        glBindVertexArray(this->m_instanceVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+        for (unsigned int c = 0; c < 4; c++) {
+            glEnableVertexAttribArray(INSTANCE_LOCATION + c);
+            glVertexAttribPointer(INSTANCE_LOCATION + c, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(c * sizeof(glm::vec4)));
+            glVertexAttribDivisor(INSTANCE_LOCATION + c, divisor);
+        }
+        this->m_instanceVBO = instanceVBO;
+        this->m_instanceDivisor = divisor;
+    }
+    return this->m_instanceVAO;
+}
+
+void Mesh::free() {
+    glDeleteVertexArrays(1, &this->VAO);
+    glDeleteBuffers(1, &this->VBO);
+    glDeleteBuffers(1, &this->EBO);
+    if (this->m_instanceVAO != 0) glDeleteVertexArrays(1, &this->m_instanceVAO);
+    this->VAO = this->VBO = this->EBO = this->m_instanceVAO = this->m_instanceVBO = 0;
+}
+
+void Mesh::bindTextures(const ShaderProgram& shader) {
+    for (unsigned int i = 0; i < this->m_textures.size(); i++) {
+        glActiveTexture(GL_TEXTURE0 + i);
+        glUniform1i(shader.getUniformLocation(this->m_samplerNames[i]), i);
+        glBindTexture(GL_TEXTURE_2D, this->m_textures[i].id);
+    }
+    glActiveTexture(GL_TEXTURE0);
+}
+
+void Mesh::nameSamplers() {
     unsigned int diffuseNr = 1;
     unsigned int specularNr = 1;
     unsigned int normalNr = 1;
     unsigned int heightNr = 1;
 
-    for (unsigned int i = 0; i < this->m_textures.size(); i++) {
-        glActiveTexture(GL_TEXTURE0 + i);
-
+    this->m_samplerNames.clear();
+    for (const TexMesh& texture : this->m_textures) {
         std::string number;
-        const std::string& name = this->m_textures[i].type;
+        const std::string& name = texture.type;
 
         if (name == "texture_diffuse")
             number = std::to_string(diffuseNr++);
@@ -28,22 +139,11 @@ void Mesh::draw(const glm::mat4& TM, int renderMode) {
         else if (name == "texture_height")
             number = std::to_string(heightNr++);
 
-        glUniform1i(glGetUniformLocation(*Utils::instance().shader, (name + number).c_str()), i);
-        glBindTexture(GL_TEXTURE_2D, this->m_textures[i].id);
+        this->m_samplerNames.push_back(name + number);
     }
-    glActiveTexture(GL_TEXTURE0);
-
-    glBindVertexArray(this->VAO);
-    GLint modelLoc = glGetUniformLocation(*Utils::instance().shader, "TM");
-    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, &TM[0][0]);
-    glPolygonMode(GL_FRONT_AND_BACK, renderMode);
-    glDrawElements(GL_TRIANGLES, static_cast<unsigned int>(this->m_indices.size()), GL_UNSIGNED_INT, 0);
-    glBindVertexArray(0);
-
-    glActiveTexture(GL_TEXTURE0);
 }
 
-void Mesh::setupMesh() {
+void Mesh::setupMesh(const unsigned char* packedVertices) {
 
     glGenVertexArrays(1, &this->VAO);
     glGenBuffers(1, &this->VBO);
@@ -52,32 +152,142 @@ void Mesh::setupMesh() {
     glBindVertexArray(VAO);
 
     glBindBuffer(GL_ARRAY_BUFFER, this->VBO);
-    glBufferData(GL_ARRAY_BUFFER, this->m_vertices.size() * sizeof(Vertex), &this->m_vertices[0], GL_STATIC_DRAW);
+    glBufferData(GL_ARRAY_BUFFER, this->m_vertices.size() * this->m_layout.stride(), packedVertices, GL_STATIC_DRAW);
 
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, this->m_indices.size() * sizeof(unsigned int), &this->m_indices[0], GL_STATIC_DRAW);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, (this->m_indices.size() + this->m_lodIndices.size()) * sizeof(unsigned int), NULL, GL_STATIC_DRAW);
+    glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, this->m_indices.size() * sizeof(unsigned int), this->m_indices.data());
+    glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, this->m_indices.size() * sizeof(unsigned int), this->m_lodIndices.size() * sizeof(unsigned int), this->m_lodIndices.data());
+
+    this->setupAttributes();
+    glBindVertexArray(0);
+}
+
+// vertex layout for whichever VAO is bound, shared by the plain and the instanced VAO
+void Mesh::setupAttributes() {
+    glBindBuffer(GL_ARRAY_BUFFER, this->VBO);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->EBO);
+    setVertexAttributes(this->m_layout);
+}
+
+void Mesh::setVertexAttributes(const VertexLayout& layout) {
+    const GLsizei stride = layout.stride();
+    size_t offset = 0;
 
     // vertex Positions
     glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)offset);
+    offset += 3 * sizeof(float);
     // vertex normals
     glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
+    glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, stride, (void*)offset);
+    offset += sizeof(uint32_t);
     // vertex texture coords
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
-    // vertex tangent
-    glEnableVertexAttribArray(3);
-    glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Tangent));
-    // vertex bitangent
-    glEnableVertexAttribArray(4);
-    glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
-    // ids
-    glEnableVertexAttribArray(5);
-    glVertexAttribIPointer(5, 4, GL_INT, sizeof(Vertex), (void*)offsetof(Vertex, m_BoneIDs));
-
-    // weights
-    glEnableVertexAttribArray(6);
-    glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, m_Weights));
-    glBindVertexArray(0);
-}
\ No newline at end of file
+    if (layout.texCoords) {
+        glEnableVertexAttribArray(2);
+        if (layout.halfTexCoords) glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, stride, (void*)offset);
+        else glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void*)offset);
+        offset += layout.halfTexCoords ? sizeof(uint32_t) : 2 * sizeof(float);
+    }
+}
+
+unsigned int VertexLayout::stride() const {
+    unsigned int stride = 3 * sizeof(float) + sizeof(uint32_t); // position, normal
+    if (this->texCoords) stride += this->halfTexCoords ? sizeof(uint32_t) : 2 * sizeof(float);
+    return stride;
+}
+
+bool VertexLayout::operator==(const VertexLayout& other) const {
+    return this->texCoords == other.texCoords && this->halfTexCoords == other.halfTexCoords;
+}
+
+void Mesh::chooseLayout() {
+    // half floats have 10 mantissa bits, up to 2 that is still under a texel of a 1024 texture
+    const float halfRange = 2.0f;
+
+    float maxUV = 0.0f;
+    for (const Vertex& vertex : this->m_vertices) {
+        maxUV = std::max(maxUV, std::max(std::abs(vertex.TexCoords.x), std::abs(vertex.TexCoords.y)));
+    }
+    this->m_layout.texCoords = maxUV > 0.0f;
+    this->m_layout.halfTexCoords = maxUV <= halfRange;
+}
+
+std::vector<unsigned char> Mesh::packVertices() const {
+    const unsigned int stride = this->m_layout.stride();
+    std::vector<unsigned char> packed(this->m_vertices.size() * stride);
+
+    unsigned char* out = packed.data();
+    for (const Vertex& vertex : this->m_vertices) {
+        std::memcpy(out, &vertex.Position, 3 * sizeof(float));
+        size_t offset = 3 * sizeof(float);
+
+        const glm::vec3 normal = glm::length(vertex.Normal) > 0.0f ? glm::normalize(vertex.Normal) : glm::vec3(0.0f, 1.0f, 0.0f);
+        const uint32_t packedNormal = glm::packSnorm3x10_1x2(glm::vec4(normal, 0.0f));
+        std::memcpy(out + offset, &packedNormal, sizeof(uint32_t));
+        offset += sizeof(uint32_t);
+
+        if (this->m_layout.texCoords && this->m_layout.halfTexCoords) {
+            const uint32_t uv = glm::packHalf2x16(vertex.TexCoords);
+            std::memcpy(out + offset, &uv, sizeof(uint32_t));
+            offset += sizeof(uint32_t);
+        } else if (this->m_layout.texCoords) {
+            std::memcpy(out + offset, &vertex.TexCoords, 2 * sizeof(float));
+        }
+        out += stride;
+    }
+    return packed;
+}
+
+void Mesh::computeBounds() {
+    for (const Vertex& vertex : this->m_vertices) this->m_bounds.add(vertex.Position);
+}
+
+const AABB& Mesh::getBounds() const {
+    return this->m_bounds;
+}
+
+void Mesh::setLods(const MeshLods& lods) {
+    this->m_lodIndices = lods.indices;
+    this->m_lods.clear();
+    this->m_lods.push_back({ 0, (unsigned int)this->m_indices.size() });
+    unsigned int first = (unsigned int)this->m_indices.size();
+    for (unsigned int count : lods.counts) {
+        if ((int)this->m_lods.size() == MAX_LODS) break;
+        this->m_lods.push_back({ first, count });
+        first += count;
+    }
+}
+
+int Mesh::getNumLods() const {
+    return (int)this->m_lods.size();
+}
+
+const Mesh::Lod& Mesh::getLod(int level) const {
+    return this->m_lods[std::clamp(level, 0, (int)this->m_lods.size() - 1)];
+}
+
+const unsigned int* Mesh::getLodIndices(int level) const {
+    const Lod& lod = this->getLod(level);
+    if (lod.firstIndex == 0) return this->m_indices.data();
+    return this->m_lodIndices.data() + (lod.firstIndex - this->m_indices.size());
+}
+
+MeshLods Mesh::getLods() const {
+    MeshLods lods;
+    lods.indices = this->m_lodIndices;
+    for (size_t i = 1; i < this->m_lods.size(); i++) lods.counts.push_back(this->m_lods[i].count);
+    return lods;
+}
+
+const VertexLayout& Mesh::getLayout() const {
+    return this->m_layout;
+}
+
+size_t Mesh::getGPUBytes() const {
+    return this->m_vertices.size() * this->m_layout.stride() + (this->m_indices.size() + this->m_lodIndices.size()) * sizeof(unsigned int);
+}
+
+size_t Mesh::getUnpackedBytes() const {
+    return this->m_vertices.size() * sizeof(Vertex) + (this->m_indices.size() + this->m_lodIndices.size()) * sizeof(unsigned int);
+}
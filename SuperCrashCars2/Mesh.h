@@ -10,9 +10,11 @@
 
 #include "Utils.h"
 #include "Log.h"
+#include "Bounds.h"
 
 #define MAX_BONE_INFLUENCE 4
 
+// what the importer fills in, the GPU gets the packed form described by VertexLayout
 struct Vertex {
     glm::vec3 Position;
     glm::vec3 Normal;
@@ -24,6 +26,24 @@ struct Vertex {
     float m_Weights[MAX_BONE_INFLUENCE];
 };
 
+// attribute streams a mesh uploads, picked per mesh from its data. positions (location 0, float3) and
+// normals (location 1, 10-10-10-2 snorm) are always there. no shader does normal mapping, so tangents and
+// bitangents (locations 3 and 4) are never uploaded, and no model is skinned, so neither are bone ids and
+// weights (locations 5 and 6). dropped streams read the constant attribute value instead.
+struct VertexLayout {
+    bool texCoords = false; // location 2
+    bool halfTexCoords = false; // half floats, only when every UV is small enough to stay sub-texel accurate
+
+    unsigned int stride() const;
+    bool operator==(const VertexLayout& other) const;
+};
+
+// coarser versions of a mesh's triangles over the same vertices, see MeshSimplifier
+struct MeshLods {
+    std::vector<unsigned int> indices; // every level after the full one, one after the other
+    std::vector<unsigned int> counts; // indices per level
+};
+
 struct TexMesh {
     unsigned int id;
     std::string type;
@@ -33,16 +53,77 @@ struct TexMesh {
 class Mesh {
 
 public:
-    Mesh(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices, const std::vector<TexMesh>& textures);
+    Mesh(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices, const std::vector<TexMesh>& textures, const MeshLods& lods = MeshLods());
+    // from vertices already packed in layout (see AssetBake), uploaded as they are. only the positions
+    // are kept in m_vertices, that's all physics and the landscape read.
+    Mesh(const VertexLayout& layout, const unsigned char* packedVertices, unsigned int numVertices, const std::vector<unsigned int>& indices, const std::vector<TexMesh>& textures, const MeshLods& lods = MeshLods());
+
+    // both submit to Utils::instance().queue instead of drawing while there is one.
+    // lod 0 is full detail, past the last level the mesh has it draws its coarsest (see LodSelector)
+    void draw(const glm::mat4& TM, int renderMode, int lod = 0);
+    // one draw call for count instances, each placed by a mat4 from instanceVBO (instance * TM).
+    // uses a second VAO so the plain draw() of this mesh is left alone.
+    void drawInstanced(const glm::mat4& TM, int renderMode, unsigned int instanceVBO, int count);
 
-    void draw(const glm::mat4& TM, int renderMode);
+    // first of the four attribute locations the per-instance mat4 takes up in the lit vertex shaders.
+    // non-instanced draws read the constant identity set up by RenderManager.
+    static constexpr unsigned int INSTANCE_LOCATION = 7;
+
+    // full detail and up to three coarser levels, all ranges of the one index buffer
+    static constexpr int MAX_LODS = 4;
+    struct Lod {
+        unsigned int firstIndex;
+        unsigned int count;
+    };
+    int getNumLods() const;
+    const Lod& getLod(int level) const; // clamped to the levels there are
+    // the indices of a level as they are in the index buffer, level 0 is m_indices
+    const unsigned int* getLodIndices(int level) const;
+    // levels 1.. as they were handed in, for AssetBake
+    MeshLods getLods() const;
+
+    // attribute pointers (locations 0-3) for vertices in layout, read from the bound GL_ARRAY_BUFFER
+    // into the bound VAO
+    static void setVertexAttributes(const VertexLayout& layout);
+
+    // deletes the GL objects, copies of this mesh share them (see AssetRegistry)
+    void free();
+
+    const VertexLayout& getLayout() const;
+    // around every vertex position, in model space
+    const AABB& getBounds() const;
+    // the vertex buffer as uploaded, interleaved in getLayout()
+    std::vector<unsigned char> packVertices() const;
+    // vertex and index buffer sizes as uploaded
+    size_t getGPUBytes() const;
+    // what the same buffers took before vertices were packed (sizeof(Vertex) each)
+    size_t getUnpackedBytes() const;
 
     std::vector<Vertex> m_vertices;
     std::vector<unsigned int> m_indices;
     std::vector<TexMesh> m_textures;
 
 private:
+    friend class RenderQueue;
+    friend class StaticBatch;
+
     unsigned int VAO, VBO, EBO;
-    void setupMesh();
+    unsigned int m_instanceVAO = 0;
+    unsigned int m_instanceVBO = 0; // the buffer m_instanceVAO currently reads from
+    unsigned int m_instanceDivisor = 0; // and how often it advances
+    std::vector<std::string> m_samplerNames; // "texture_diffuse1" etc, one per texture
+    std::vector<unsigned int> m_lodIndices; // levels 1.., after m_indices in the EBO
+    std::vector<Lod> m_lods;
+    VertexLayout m_layout;
+    AABB m_bounds;
+    void chooseLayout();
+    void computeBounds();
+    void setLods(const MeshLods& lods);
+    void setupMesh(const unsigned char* packedVertices);
+    void setupAttributes();
+    // m_instanceVAO reading its per-instance mat4 from instanceVBO, created the first time
+    unsigned int instanceVAO(unsigned int instanceVBO);
+    void bindTextures(const ShaderProgram& shader);
+    void nameSamplers();
 
 };
\ No newline at end of file
@@ -0,0 +1,124 @@
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+
+MeshLods MeshSimplifier::generate(const std::vector<glm::vec3>& positions, const std::vector<unsigned int>& indices, int maxLevels) {
+	MeshLods lods;
+	AABB bounds;
+	for (unsigned int index : indices) bounds.add(positions[index]);
+	if (!bounds.valid()) return lods;
+
+	const glm::vec3 size = bounds.max - bounds.min;
+	const float longest = std::max(size.x, std::max(size.y, size.z));
+	if (longest <= 0.0f) return lods;
+
+	size_t previous = indices.size() / 3;
+	float finest = longest / 1024.0f;
+	for (int level = 1; level < maxLevels && previous >= MIN_TRIANGLES; level++) {
+		const size_t target = (size_t)(previous * LEVEL_RATIO);
+
+		// the smallest cell that gets down to the target. bigger cells merge more, so bisect
+		// (geometrically, cell sizes span three orders of magnitude) between the last level's and one cell
+		std::vector<unsigned int> best;
+		float low = finest, high = longest;
+		for (int step = 0; step < 10; step++) {
+			const float cellSize = std::sqrt(low * high);
+			std::vector<unsigned int> clustered = cluster(positions, indices, bounds, cellSize);
+			if (!clustered.empty() && clustered.size() / 3 <= target) {
+				best.swap(clustered);
+				high = cellSize;
+			} else if (clustered.empty()) high = cellSize; // everything collapsed, too coarse
+			else low = cellSize;
+		}
+		// nothing usable, or not enough fewer triangles to be worth a level
+		if (best.empty() || best.size() / 3 > previous * 0.8f) break;
+
+		lods.indices.insert(lods.indices.end(), best.begin(), best.end());
+		lods.counts.push_back((unsigned int)best.size());
+		previous = best.size() / 3;
+		finest = high;
+	}
+	return lods;
+}
+
+std::vector<unsigned int> MeshSimplifier::cluster(const std::vector<glm::vec3>& positions, const std::vector<unsigned int>& indices, const AABB& bounds, float cellSize) {
+	struct Cell {
+		glm::vec3 sum = glm::vec3(0.0f);
+		int count = 0;
+		unsigned int vertex = 0;
+		float distance = std::numeric_limits<float>::max();
+	};
+
+	// 21 bits per axis, plenty for the 1024 cells a side generate() goes down to
+	const float scale = 1.0f / cellSize;
+	auto cellOf = [&](const glm::vec3& position) {
+		const glm::vec3 cell = glm::floor((position - bounds.min) * scale);
+		const uint64_t x = (uint64_t)std::clamp((int)cell.x, 0, 0x1fffff);
+		const uint64_t y = (uint64_t)std::clamp((int)cell.y, 0, 0x1fffff);
+		const uint64_t z = (uint64_t)std::clamp((int)cell.z, 0, 0x1fffff);
+		return x | (y << 21) | (z << 42);
+	};
+
+	// only the vertices triangles use, each once
+	std::vector<char> used(positions.size(), 0);
+	for (unsigned int index : indices) used[index] = 1;
+
+	std::unordered_map<uint64_t, Cell> cells;
+	std::vector<uint64_t> vertexCells(positions.size());
+	for (size_t v = 0; v < positions.size(); v++) {
+		if (!used[v]) continue;
+		vertexCells[v] = cellOf(positions[v]);
+		Cell& cell = cells[vertexCells[v]];
+		cell.sum += positions[v];
+		cell.count++;
+	}
+	for (size_t v = 0; v < positions.size(); v++) {
+		if (!used[v]) continue;
+		Cell& cell = cells[vertexCells[v]];
+		const glm::vec3 offset = positions[v] - cell.sum / (float)cell.count;
+		const float distance = glm::dot(offset, offset);
+		if (distance < cell.distance) {
+			cell.vertex = (unsigned int)v;
+			cell.distance = distance;
+		}
+	}
+	std::vector<unsigned int> remap(positions.size(), 0);
+	for (size_t v = 0; v < positions.size(); v++) {
+		if (used[v]) remap[v] = cells[vertexCells[v]].vertex;
+	}
+
+	// remapped triangles, the collapsed ones dropped
+	std::vector<std::array<unsigned int, 3>> triangles;
+	triangles.reserve(indices.size() / 3);
+	for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+		const unsigned int a = remap[indices[i]];
+		const unsigned int b = remap[indices[i + 1]];
+		const unsigned int c = remap[indices[i + 2]];
+		if (a == b || b == c || a == c) continue;
+		triangles.push_back({ a, b, c });
+	}
+
+	// the same triangle twice is one too many. rotated to start at its lowest corner so the winding is
+	// kept, the two sides of something thin stay
+	std::vector<std::array<unsigned int, 4>> keys(triangles.size()); // corners, triangle
+	for (size_t t = 0; t < triangles.size(); t++) {
+		std::array<unsigned int, 3> corners = triangles[t];
+		std::rotate(corners.begin(), std::min_element(corners.begin(), corners.end()), corners.end());
+		keys[t] = { corners[0], corners[1], corners[2], (unsigned int)t };
+	}
+	std::sort(keys.begin(), keys.end());
+
+	std::vector<unsigned int> result;
+	result.reserve(keys.size() * 3);
+	for (size_t k = 0; k < keys.size(); k++) {
+		if (k > 0 && keys[k][0] == keys[k - 1][0] && keys[k][1] == keys[k - 1][1] && keys[k][2] == keys[k - 1][2]) continue;
+		const std::array<unsigned int, 3>& triangle = triangles[keys[k][3]];
+		result.insert(result.end(), triangle.begin(), triangle.end());
+	}
+	return result;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "glm/glm.hpp"
+
+#include <vector>
+
+#include "Bounds.h"
+#include "Mesh.h"
+
+// Coarser levels of detail for a mesh by vertex clustering: positions are snapped to a grid, every cell
+// keeps the one vertex nearest to the average of the vertices in it, and triangles that collapse or end
+// up doubled are dropped. Only the indices change, every level reads the mesh's own vertices.
+// Pure CPU work, AssetRegistry::parseModel runs it on the loader workers for imported models, baked ones
+// bring the levels from the bake.
+class MeshSimplifier {
+
+public:
+	// meshes with fewer triangles keep only their full detail
+	static constexpr size_t MIN_TRIANGLES = 64;
+	// each level aims for this share of the triangles of the level before it
+	static constexpr float LEVEL_RATIO = 0.5f;
+
+	// up to maxLevels - 1 levels after the full one, fewer when clustering stops paying off
+	static MeshLods generate(const std::vector<glm::vec3>& positions, const std::vector<unsigned int>& indices, int maxLevels);
+
+	// one clustering pass with cubic cells of cellSize, starting at bounds.min
+	static std::vector<unsigned int> cluster(const std::vector<glm::vec3>& positions, const std::vector<unsigned int>& indices, const AABB& bounds, float cellSize);
+};
@@ -29,29 +29,29 @@ void MiniMap::updateMap(PVehicle& player, const std::vector<PVehicle*>& vehicleL
 }
 
 
-void MiniMap::displayMap(PVehicle& player, const std::vector<PVehicle*>* vehicleList, std::vector<Image*> *imageList, int currentPlayer) {
+void MiniMap::displayMap(const std::vector<VehicleSnapshot>& vehicles, int currentPlayer) {
 	float startPosX = Utils::instance().SCREEN_WIDTH - 140;
 	float startPosY = Utils::instance().SCREEN_HEIGHT - 950.f;
 
 
 	//Single player
-	for (size_t i = 0; i < 4; i++){
-		float mapposX = Utils::instance().pxToGlmVec3(vehicleList->at(i)->getPosition()).x / 5;
-		float mapposY = Utils::instance().pxToGlmVec3(vehicleList->at(i)->getPosition()).z / 5;
+	for (size_t i = 0; i < 4 && i < vehicles.size(); i++){
+		float mapposX = vehicles.at(i).currPose.p.x / 5;
+		float mapposY = vehicles.at(i).currPose.p.z / 5;
 		glm::vec2 mappos = { startPosX + mapposX, startPosY + mapposY };
 		//Check boundary
 		if (mappos.x < (Utils::instance().SCREEN_WIDTH - 270) || mappos.y > Utils::instance().SCREEN_HEIGHT - 810.f)
 		{
 			continue;
 		}
-		if ((vehicleList->at(i)->getFrontVec().x) > 0)
+		if ((vehicles.at(i).frontVec.x) > 0)
 		{
-			imageList->at(i)->draw(*(textureList.at(i)), mappos, glm::vec2(10.f, 10.f), 90 * (vehicleList->at(i)->getFrontVec().z + 1.f), glm::vec3(1.f, 1.f, 1.f));
+			SpriteBatch::get().draw(*(textureList.at(i)), mappos, glm::vec2(10.f, 10.f), 90 * (vehicles.at(i).frontVec.z + 1.f), glm::vec3(1.f, 1.f, 1.f));
 
 		}
-		else imageList->at(i)->draw(*(textureList.at(i)), mappos, glm::vec2(10.f, 10.f), 360 - 90 * (vehicleList->at(i)->getFrontVec().z + 1.f), glm::vec3(1.f, 1.f, 1.f));
+		else SpriteBatch::get().draw(*(textureList.at(i)), mappos, glm::vec2(10.f, 10.f), 360 - 90 * (vehicles.at(i).frontVec.z + 1.f), glm::vec3(1.f, 1.f, 1.f));
 
 	}
-	imageList->at(4)->draw(maptex, glm::vec2(startPosX - 130, 0), glm::vec2(270.f, 270.f), 0.f, glm::vec3(1.f, 1.f, 1.f));
+	SpriteBatch::get().draw(maptex, glm::vec2(startPosX - 130, 0), glm::vec2(270.f, 270.f), 0.f, glm::vec3(1.f, 1.f, 1.f));
 	return;
 }
\ No newline at end of file
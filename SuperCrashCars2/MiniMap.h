@@ -3,8 +3,9 @@
 #include "Log.h"
 #include "PVehicle.h"
 #include "Texture.h"
-#include "Image.h"
+#include "SpriteBatch.h"
 #include "GameManager.h"
+#include "SceneSnapshot.h"
 #include <string>
 #include <math.h>
 #include <string>
@@ -15,7 +16,7 @@ public:
 	MiniMap();
 	MiniMap(int playerId, PVehicle& player);
 
-	void displayMap(PVehicle& player, const std::vector<PVehicle*>* vehicleList, std::vector<Image*> *imageList, int currentplayer);
+	void displayMap(const std::vector<VehicleSnapshot>& vehicles, int currentplayer);
 
 private:
 	Texture green = Texture("textures/green.png", GL_LINEAR);
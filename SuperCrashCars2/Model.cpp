@@ -19,15 +19,13 @@ Model::Model(const char* path, bool flipTexture, int renderMode) :
 	m_angle(0.0f),
 	m_theta(0.0f)
 {
-	this->loadModel(path);
+	this->m_asset = AssetRegistry::get().loadModel(path, flipTexture);
 }
 
 Model::Model(const Model& model) :
 	m_flipTexture(model.m_flipTexture),
 	m_renderMode(model.m_renderMode),
-	m_textures_loaded(model.m_textures_loaded),
-	m_meshes(model.m_meshes),
-	m_directory(model.m_directory),
+	m_asset(model.m_asset),
 	m_TM(model.m_TM),
 	m_position(model.m_position),
 	m_scale(model.m_scale),
@@ -36,14 +34,48 @@ Model::Model(const Model& model) :
 {}
 
 Model& Model::operator=(const Model& model) {
-	this->m_textures_loaded = model.m_textures_loaded;
-	this->m_meshes = model.m_meshes;
-	this->m_directory = model.m_directory;
+	this->m_asset = model.m_asset;
 	this->m_flipTexture = model.m_flipTexture;
 	this->m_renderMode = model.m_renderMode;
 	return *this;
 }
 
+Model::Model(Model&& model) noexcept :
+	m_asset(std::move(model.m_asset)),
+	m_flipTexture(model.m_flipTexture),
+	m_renderMode(model.m_renderMode),
+	m_TM(model.m_TM),
+	m_position(model.m_position),
+	m_scale(model.m_scale),
+	m_angle(model.m_angle),
+	m_theta(model.m_theta),
+	m_instanceVBO(model.m_instanceVBO),
+	m_lods(model.m_lods),
+	m_instanceCount(model.m_instanceCount)
+{
+	model.m_instanceVBO = 0;
+	model.m_instanceCount = 0;
+}
+
+Model& Model::operator=(Model&& model) noexcept {
+	if (this == &model) return *this;
+	this->free();
+	this->m_asset = std::move(model.m_asset);
+	this->m_flipTexture = model.m_flipTexture;
+	this->m_renderMode = model.m_renderMode;
+	this->m_TM = model.m_TM;
+	this->m_position = model.m_position;
+	this->m_scale = model.m_scale;
+	this->m_angle = model.m_angle;
+	this->m_theta = model.m_theta;
+	this->m_instanceVBO = model.m_instanceVBO;
+	this->m_lods = model.m_lods;
+	this->m_instanceCount = model.m_instanceCount;
+	model.m_instanceVBO = 0;
+	model.m_instanceCount = 0;
+	return *this;
+}
+
 void Model::translate(const glm::vec3& offset) {
 	glm::mat4 T = glm::translate(glm::mat4(1.0f), offset);
 	this->m_TM = T * this->m_TM;
@@ -90,6 +122,14 @@ float Model::getAngle() const {
 	return this->m_angle;
 }
 
+const glm::mat4& Model::getTM() const {
+	return this->m_TM;
+}
+
+int Model::getRenderMode() const {
+	return this->m_renderMode;
+}
+
 void Model::reset() {
 	this->m_position = glm::vec3(0.0f);
 	this->m_angle = 0.0f;
@@ -98,193 +138,68 @@ void Model::reset() {
 }
 
 const std::vector<Mesh>& Model::getMeshData() const {
-	return this->m_meshes;
+	static const std::vector<Mesh> empty;
+	return this->m_asset ? this->m_asset->meshes : empty;
 }
 
-void Model::draw(glm::mat4& TM) {
-	TM = TM * this->m_TM;
-	for (unsigned int i = 0; i < this->m_meshes.size(); i++)
-		this->m_meshes[i].draw(TM, this->m_renderMode);
+AABB Model::getBounds() const {
+	AABB bounds;
+	for (const Mesh& mesh : this->getMeshData()) bounds.add(mesh.getBounds());
+	return bounds;
 }
 
-void Model::draw() {
-	for (unsigned int i = 0; i < this->m_meshes.size(); i++)
-		this->m_meshes[i].draw(this->m_TM, this->m_renderMode);
+AABB Model::getWorldBounds() const {
+	return this->getBounds().transformed(this->m_TM);
 }
 
-void Model::loadModel(const std::string& path) {
-	Assimp::Importer importer;
-	const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
-
-	if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
-		Log::error("{}", importer.GetErrorString());
-		return;
-	}
-	this->m_directory = path.substr(0, path.find_last_of('/'));
-
-	this->processNode(scene->mRootNode, scene);
+void Model::draw(glm::mat4& TM) {
+	TM = TM * this->m_TM;
+	if (!this->m_asset) return;
+	const int lod = this->selectLod(this->getBounds().transformed(TM));
+	for (Mesh& mesh : this->m_asset->meshes)
+		mesh.draw(TM, this->m_renderMode, lod);
 }
 
-void Model::processNode(aiNode* node, const aiScene* scene) {
-	for (unsigned int i = 0; i < node->mNumMeshes; i++) {
-		aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-		this->m_meshes.push_back(processMesh(mesh, scene));
-	}
-	for (unsigned int i = 0; i < node->mNumChildren; i++) {
-		this->processNode(node->mChildren[i], scene);
+void Model::draw() {
+	if (!this->m_asset) return;
+	const int lod = this->selectLod(this->getWorldBounds());
+	for (Mesh& mesh : this->m_asset->meshes)
+		mesh.draw(this->m_TM, this->m_renderMode, lod);
+}
+
+void Model::draw(const Frustum& frustum) {
+	if (!this->m_asset) return;
+	const int lod = this->selectLod(this->getWorldBounds());
+	const bool single = this->m_asset->meshes.size() == 1; // already tested as a whole by the caller
+	for (Mesh& mesh : this->m_asset->meshes) {
+		if (single || frustum.isVisible(mesh.getBounds().transformed(this->m_TM))) mesh.draw(this->m_TM, this->m_renderMode, lod);
 	}
 }
 
-Mesh Model::processMesh(aiMesh* mesh, const aiScene* scene) {
-	std::vector<Vertex> vertices;
-	std::vector<unsigned int> indices;
-	std::vector<TexMesh> textures;
-
-	for (unsigned int i = 0; i < mesh->mNumVertices; i++) {
-		Vertex vertex;
-
-		glm::vec3 vector;
-		vector.x = mesh->mVertices[i].x;
-		vector.y = mesh->mVertices[i].y;
-		vector.z = mesh->mVertices[i].z;
-		vertex.Position = vector;
-
-		if (mesh->HasNormals()) {
-			vector.x = mesh->mNormals[i].x;
-			vector.y = mesh->mNormals[i].y;
-			vector.z = mesh->mNormals[i].z;
-			vertex.Normal = vector;
-		}
-
-		if (mesh->mTextureCoords[0]) {
-			glm::vec2 vec;
-
-			vec.x = mesh->mTextureCoords[0][i].x;
-			vec.y = mesh->mTextureCoords[0][i].y;
-			vertex.TexCoords = vec;
-
-			vector.x = mesh->mTangents[i].x;
-			vector.y = mesh->mTangents[i].y;
-			vector.z = mesh->mTangents[i].z;
-			vertex.Tangent = vector;
-
-			vector.x = mesh->mBitangents[i].x;
-			vector.y = mesh->mBitangents[i].y;
-			vector.z = mesh->mBitangents[i].z;
-			vertex.Bitangent = vector;
-		} else vertex.TexCoords = glm::vec2(0.0f, 0.0f);
-		
-
-		vertices.push_back(vertex);
-	}
-
-	for (unsigned int i = 0; i < mesh->mNumFaces; i++) {
-		aiFace face = mesh->mFaces[i];
-		for (unsigned int j = 0; j < face.mNumIndices; j++)
-			indices.push_back(face.mIndices[j]);
-	}
-
-	if (mesh->mMaterialIndex >= 0) {
-		aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
-		
-		// Shaders
-		// diffuse: texture_diffuseN
-		// specular: texture_specularN
-		// normal: texture_normalN
-
-		// 1. diffuse maps
-		std::vector<TexMesh> diffuseMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse");
-		textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
-		// 2. specular maps
-		std::vector<TexMesh> specularMaps = loadMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular");
-		textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
-		// 3. normal maps
-		std::vector<TexMesh> normalMaps = loadMaterialTextures(material, aiTextureType_HEIGHT, "texture_normal");
-		textures.insert(textures.end(), normalMaps.begin(), normalMaps.end());
-		// 4. height maps
-		std::vector<TexMesh> heightMaps = loadMaterialTextures(material, aiTextureType_AMBIENT, "texture_height");
-		textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
-
-	}
-	return Mesh(vertices, indices, textures);
+int Model::selectLod(const AABB& worldBounds) {
+	return LodSelector::get().select(worldBounds, this->m_lods);
 }
 
-std::vector<TexMesh> Model::loadMaterialTextures(aiMaterial* mat, aiTextureType type, const std::string& typeName) {
-	std::vector<TexMesh> textures;
-	for (unsigned int i = 0; i < mat->GetTextureCount(type); i++) {
-		aiString str;
-		mat->GetTexture(type, i, &str);
-		bool skip = false;
-		for (unsigned int j = 0; j < this->m_textures_loaded.size(); j++) {
-			if (std::strcmp(this->m_textures_loaded[j].path.data(), str.C_Str()) == 0) {
-				textures.push_back(this->m_textures_loaded[j]);
-				skip = true;
-				break;
-			}
-		}
-		if (!skip) {  
-			TexMesh texture;
-			texture.id = TextureFromFile(str.C_Str(), this->m_directory);
-			texture.type = typeName;
-			texture.path = str.C_Str();
-			textures.push_back(texture);
-			this->m_textures_loaded.push_back(texture);
-		}
-	}
-	return textures;
+void Model::setInstances(const std::vector<glm::mat4>& transforms) {
+	if (this->m_instanceVBO == 0) glGenBuffers(1, &this->m_instanceVBO);
+	glBindBuffer(GL_ARRAY_BUFFER, this->m_instanceVBO);
+	glBufferData(GL_ARRAY_BUFFER, transforms.size() * sizeof(glm::mat4), transforms.data(), GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	this->m_instanceCount = (int)transforms.size();
 }
 
-unsigned int Model::TextureFromFile(const char* path, const std::string& directory, bool gamma) {
-	std::string filename = std::string(path);
-	filename = directory + '/' + filename;
-
-	stbi_set_flip_vertically_on_load(this->m_flipTexture);
-
-	unsigned int textureID;
-	glGenTextures(1, &textureID);
-
-	int width, height, nrComponents;
-	unsigned char* data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
-	if (data) {
-		
-		GLuint format = GL_RGB;
-		switch (nrComponents) {
-			case 4:
-				format = GL_RGBA;
-				break;
-			case 3:
-				format = GL_RGB;
-				break;
-			case 2:
-				format = GL_RG;
-				break;
-			case 1:
-				format = GL_RED;
-				break;
-			default:
-				Log::error("Invalid Texture Format");
-				break;
-		};
-
-		glBindTexture(GL_TEXTURE_2D, textureID);
-		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-
-		/*glGenerateMipmap(GL_TEXTURE_2D);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);*/
-
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+int Model::getInstanceCount() const {
+	return this->m_instanceCount;
+}
 
-		stbi_image_free(data);
-	} else {
-		Log::error("Texture failed to load at path: {}", path);
-		stbi_image_free(data);
-	}
+void Model::drawInstanced() {
+	if (!this->m_asset) return;
+	for (Mesh& mesh : this->m_asset->meshes)
+		mesh.drawInstanced(this->m_TM, this->m_renderMode, this->m_instanceVBO, this->m_instanceCount);
+}
 
-	return textureID;
-}
\ No newline at end of file
+void Model::free() {
+	if (this->m_instanceVBO != 0) glDeleteBuffers(1, &this->m_instanceVBO);
+	this->m_instanceVBO = 0;
+	this->m_instanceCount = 0;
+}
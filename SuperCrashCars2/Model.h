@@ -1,12 +1,9 @@
 #pragma once
 
-#include <assimp/Importer.hpp>
-#include <assimp/scene.h>
-#include <assimp/postprocess.h>
-
 #include <stb_image.h>
 
-#include "Mesh.h"
+#include "AssetRegistry.h"
+#include "LodSelector.h"
 
 class Model {
 
@@ -16,8 +13,9 @@ public:
 	Model(const char* path, bool flipTexture = false, int renderMode = GL_FILL);
 	Model(const Model& model);
 	Model& operator=(const Model& model);
-	Model(Model&& model) = default;
-	Model& operator=(Model&& model) = default;
+	// moves hand the instance buffer over, a move assignment frees the one it replaces
+	Model(Model&& model) noexcept;
+	Model& operator=(Model&& model) noexcept;
 	~Model() = default;
 
 	void translate(const glm::vec3& offset);
@@ -30,17 +28,34 @@ public:
 	const glm::vec3& getPosition() const;
 	const glm::vec3& getScale() const;
 	float getAngle() const;
+	const glm::mat4& getTM() const;
+	int getRenderMode() const;
 
 	const std::vector<Mesh>& getMeshData() const;
+	// every mesh's bounds together, in model space and with this model's transform applied
+	AABB getBounds() const;
+	AABB getWorldBounds() const;
 
+	// these draw every mesh at the level of detail LodSelector picks for the whole model
 	void draw(glm::mat4& TM);
 	void draw();
+	// leaves out the meshes that are outside the frustum
+	void draw(const Frustum& frustum);
+	// the level of detail for this model at worldBounds in the current view, remembered per view
+	int selectLod(const AABB& worldBounds);
+
+	// per-instance transforms for drawInstanced(), each applied on top of this model's own transform.
+	// copies of the model don't share them.
+	void setInstances(const std::vector<glm::mat4>& transforms);
+	int getInstanceCount() const;
+	// every instance in one draw call per mesh
+	void drawInstanced();
+	// deletes the instance buffer, the meshes belong to the shared asset
+	void free();
 
 private:
 
-	std::vector<TexMesh> m_textures_loaded;
-	std::vector<Mesh> m_meshes;
-	std::string m_directory;
+	std::shared_ptr<ModelAsset> m_asset; // shared with every other Model of the same file
 
 	bool m_flipTexture;
 	int m_renderMode;
@@ -51,13 +66,9 @@ private:
 	float m_angle;
 	float m_theta;
 
-	void loadModel(const std::string& path);
-	void processNode(aiNode* node, const aiScene* scene);
-
-	Mesh processMesh(aiMesh* mesh, const aiScene* scene);
-	std::vector<TexMesh> loadMaterialTextures(aiMaterial* mat, aiTextureType type, const std::string& typeName);
-
-	unsigned int TextureFromFile(const char* path, const std::string& directory, bool gamma = false);
+	unsigned int m_instanceVBO = 0;
+	LodSelector::State m_lods{};
+	int m_instanceCount = 0;
 
 };
 
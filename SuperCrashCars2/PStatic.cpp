@@ -4,6 +4,16 @@ PStatic::PStatic(PhysicsManager& pm, const Model& model, const PxVec3& position,
 
 	this->m_static = this->createStatic(position, rotation);
 	pm.gScene->addActor(*this->m_static);
+
+	const int MAX_NUM_ACTOR_SHAPES = 128;
+	PxShape* shapes[MAX_NUM_ACTOR_SHAPES];
+	const PxU32 nbShapes = this->m_static->getNbShapes();
+	PX_ASSERT(nbShapes <= MAX_NUM_ACTOR_SHAPES);
+	this->m_static->getShapes(shapes, nbShapes);
+	for (PxU32 i = 0; i < nbShapes; i++) {
+		const PxMat44 shapePose(PxShapeExt::getGlobalPose(*shapes[i], *this->m_static));
+		this->m_shapeTransforms.push_back(glm::make_mat4(&shapePose.column0.x));
+	}
 }
 
 PxTransform PStatic::getTransform() const {
@@ -19,25 +29,7 @@ PxRigidStatic* PStatic::getRigidStatic() const {
 }
 
 void PStatic::render() {
-
-	PxRigidActor* rigidActor = static_cast<PxRigidActor*>(this->m_static);
-	if (!rigidActor) return;
-
-	const int MAX_NUM_ACTOR_SHAPES = 128;
-	PxShape* shapes[MAX_NUM_ACTOR_SHAPES];
-
-	const PxU32 nbShapes = rigidActor->getNbShapes();
-
-	PX_ASSERT(nbShapes <= MAX_NUM_ACTOR_SHAPES);
-	rigidActor->getShapes(shapes, nbShapes);
-
-	for (PxU32 i = 0; i < nbShapes; i++) {
-		const PxMat44 shapePose(PxShapeExt::getGlobalPose(*shapes[i], *rigidActor));
-		const PxGeometryHolder h = shapes[i]->getGeometry();
-
-		glm::mat4 TM = glm::make_mat4(&shapePose.column0.x);
-		this->m_model.draw(TM);
-	}
+	for (const glm::mat4& TM : this->m_shapeTransforms) this->m_model.draw(TM);
 }
 
 PxRigidStatic* PStatic::createStatic(const PxVec3& position, const PxQuat& rotation) {
@@ -22,6 +22,9 @@ protected:
 	PxRigidStatic* m_static = NULL;
 	Model m_model;
 
+	// statics never move, so the shape transforms are read once here and render() never touches PhysX.
+	std::vector<glm::mat4> m_shapeTransforms;
+
 	PxRigidStatic* createStatic(const PxVec3& position, const PxQuat& rotation);
 
 };
\ No newline at end of file
@@ -1,15 +1,11 @@
 #include "PVehicle.h"
+#include "SceneSnapshot.h"
+#include "SimClock.h"
+#include "Replay.h"
 
 using namespace physx;
 
 PVehicle::PVehicle(int id, PhysicsManager& pm, const VehicleType& vehicleType, PlayerOrAI carType, const PxVec3& position, const PxQuat& quat) : m_pm(pm), m_vehicleType(vehicleType) {
-	//Create the batched scene queries for the suspension raycasts.
-	gVehicleSceneQueryData = VehicleSceneQueryData::allocate(1, PX_MAX_NB_WHEELS, 1, 1, WheelSceneQueryPreFilterBlocking, NULL, pm.gAllocator);
-	gBatchQuery = VehicleSceneQueryData::setUpBatchedSceneQuery(0, *gVehicleSceneQueryData, pm.gScene);
-
-	//Create the friction table for each combination of tire and surface type.
-	gFrictionPairs = createFrictionPairs(pm.gMaterial);
-
 	this->initVehicleModel(); // maybe change where this is called.
 
 	VehicleDesc vehicleDesc = initVehicleDesc();
@@ -31,6 +27,10 @@ PVehicle::PVehicle(int id, PhysicsManager& pm, const VehicleType& vehicleType, P
 	PxTransform startTransform(PxVec3(0 + position.x, (vehicleDesc.chassisDims.y * 0.5f + vehicleDesc.wheelRadius + 1.0f) + position.y, 0 + position.z), quat);
 	gVehicle4W->getRigidDynamicActor()->setGlobalPose(startTransform);
 	pm.gScene->addActor(*gVehicle4W->getRigidDynamicActor());
+	this->snapPose();
+
+	//Raycasts and updates are batched with the rest of the fleet.
+	this->m_fleetIndex = pm.m_vehicleFleet.addVehicle(gVehicle4W);
 
 	this->initVehicleCollisionAttributes();
 	gVehicle4W->getRigidDynamicActor()->userData = this;
@@ -40,7 +40,7 @@ PVehicle::PVehicle(int id, PhysicsManager& pm, const VehicleType& vehicleType, P
 
 	m_lives = 3;
 	m_state = VehicleState::ePLAYING;
-	m_shieldUseTimestamp = steady_clock::now();
+	m_shieldUseTimestamp = SimClock::now();
 
 	this->carid = id;
 	this->m_carType = carType;
@@ -68,7 +68,7 @@ void PVehicle::initVehicleCollisionAttributes() {
 	this->vehicleAttr.reachedTarget = false;
 
 	this->vehicleAttr.forceToAdd = PxVec3(0.0f, 0.0f, 0.0f);
-	this->vehicleAttr.targetTimestamp = steady_clock::now();
+	this->vehicleAttr.targetTimestamp = SimClock::now();
 }
 void PVehicle::initVehicleModel() {
 	
@@ -196,26 +196,15 @@ void PVehicle::adjustConvexCollisionMesh(const PxVec3& chassis_tran, const PxVec
 		shapes[i]->setGeometry(x);
 	}
 }
-void PVehicle::updatePhysics() {
+void PVehicle::updateInputs() {
 	PxVehicleDrive4WSmoothAnalogRawInputsAndSetAnalogInputs(gPadSmoothingData, gSteerVsForwardSpeedTable, gVehicleInputData, this->m_pm.timestep, gIsVehicleInAir, *gVehicle4W);
+}
+void PVehicle::updatePhysics() {
+	//Suspension raycasts and vehicle update were done by the fleet in PhysicsManager::updateVehicles().
+	gIsVehicleInAir = this->m_pm.m_vehicleFleet.isVehicleInAir(this->m_fleetIndex);
 
-	//Raycasts.
-	PxVehicleWheels* vehicles[1] = { gVehicle4W };
-	PxRaycastQueryResult* raycastResults = gVehicleSceneQueryData->getRaycastQueryResultBuffer(0);
-	const PxU32 raycastResultsSize = gVehicleSceneQueryData->getQueryResultBufferSize();
-	PxVehicleSuspensionRaycasts(gBatchQuery, 1, vehicles, raycastResultsSize, raycastResults);
-
-	//Vehicle update.
-	const PxVec3 grav = this->m_pm.gScene->getGravity();
-	PxWheelQueryResult wheelQueryResults[PX_MAX_NB_WHEELS];
-	PxVehicleWheelQueryResult vehicleQueryResults[1] = { {wheelQueryResults, gVehicle4W->mWheelsSimData.getNbWheels()} };
-	PxVehicleUpdates(this->m_pm.timestep, grav, *gFrictionPairs, 1, vehicles, vehicleQueryResults);
-
-	//Work out if the vehicle is in the air.
-	gIsVehicleInAir = gVehicle4W->getRigidDynamicActor()->isSleeping() ? false : PxVehicleIsInAir(vehicleQueryResults[0]);
-
-	// update sphere position.
-	m_shieldSphere.setPosition(Utils::instance().pxToGlmVec3(this->gVehicle4W->getRigidDynamicActor()->getGlobalPose().p));
+	this->m_prevPose = this->m_currPose;
+	this->m_currPose = this->gVehicle4W->getRigidDynamicActor()->getGlobalPose();
 
 	// other updates over time
 
@@ -227,9 +216,7 @@ void PVehicle::updatePhysics() {
 	this->regainFlash();
 }
 void PVehicle::free() {
-	PX_RELEASE(gBatchQuery);
-	gVehicleSceneQueryData->free(this->m_pm.gAllocator);
-	PX_RELEASE(gFrictionPairs);
+	this->m_pm.m_vehicleFleet.removeVehicle(this->m_fleetIndex);
 
 	gVehicle4W->getRigidDynamicActor()->release();
 	gVehicle4W->free();
@@ -243,20 +230,24 @@ void PVehicle::releaseAllControls() {
 #pragma endregion
 #pragma region movement
 void PVehicle::accelerate(float throttle) {
+	if (this->m_replay) this->m_replay->write(this->carid, VehicleCommand::eACCELERATE, throttle);
 	if (this->gVehicle4W->getRigidDynamicActor()->getLinearVelocity().magnitude() >= 30.0f) return;
 	gVehicle4W->mDriveDynData.forceGearChange(PxVehicleGearsData::eFIRST);
 	gVehicleInputData.setAnalogAccel(throttle);
 }
 void PVehicle::reverse(float throttle) {
+	if (this->m_replay) this->m_replay->write(this->carid, VehicleCommand::eREVERSE, throttle);
 	gVehicle4W->mDriveDynData.forceGearChange(PxVehicleGearsData::eREVERSE);
 	gVehicleInputData.setAnalogAccel(throttle);
 }
 void PVehicle::brake(float throttle) {
+	if (this->m_replay) this->m_replay->write(this->carid, VehicleCommand::eBRAKE, throttle);
 	gVehicleInputData.setAnalogBrake(throttle);
 }
 void PVehicle::turnLeft(float throttle) {
+	if (this->m_replay) this->m_replay->write(this->carid, VehicleCommand::eTURN_LEFT, throttle);
 	gVehicleInputData.setAnalogSteer(throttle);
-	this->rotateXAxis(-0.35f);
+	this->applyYawTorque(-0.35f);
 	/*PxVec3 vel = this->getRigidDynamic()->getLinearVelocity();
 	float mag = vel.magnitude();
 	PxVec3 front = Utils::instance().glmToPxVec3(this->getFrontVec());
@@ -264,8 +255,9 @@ void PVehicle::turnLeft(float throttle) {
 	this->getRigidDynamic()->setAngularVelocity(this->getRigidDynamic()->getAngularVelocity() * 0.99f);
 }
 void PVehicle::turnRight(float throttle) {
+	if (this->m_replay) this->m_replay->write(this->carid, VehicleCommand::eTURN_RIGHT, throttle);
 	gVehicleInputData.setAnalogSteer(-throttle);
-	this->rotateXAxis(0.35f);
+	this->applyYawTorque(0.35f);
 	/*PxVec3 vel = this->getRigidDynamic()->getLinearVelocity();
 	float mag = vel.magnitude();
 	PxVec3 front = Utils::instance().glmToPxVec3(this->getFrontVec());
@@ -273,18 +265,29 @@ void PVehicle::turnRight(float throttle) {
 	this->getRigidDynamic()->setAngularVelocity(this->getRigidDynamic()->getAngularVelocity() * 0.99f);
 }
 void PVehicle::handbrake() {
+	if (this->m_replay) this->m_replay->write(this->carid, VehicleCommand::eHANDBRAKE);
 	gVehicleInputData.setAnalogHandbrake(1.0f);
 	this->getRigidDynamic()->setAngularVelocity(this->getRigidDynamic()->getAngularVelocity() * 1.01f);
 }
 void PVehicle::rotateYAxis(float amount) {
+	if (this->m_replay) this->m_replay->write(this->carid, VehicleCommand::eROTATE_Y, amount);
 	glm::vec3 rightVec = this->getRightVec();
 	this->getRigidDynamic()->addTorque(-0.05f * amount * PxVec3(rightVec.x, rightVec.y, rightVec.z), PxForceMode::eVELOCITY_CHANGE);
 }
 void PVehicle::rotateXAxis(float amount) {
+	if (this->m_replay) this->m_replay->write(this->carid, VehicleCommand::eROTATE_X, amount);
+	this->applyYawTorque(amount);
+}
+void PVehicle::applyYawTorque(float amount) {
 	glm::vec3 upVec = this->getUpVec();
 	this->getRigidDynamic()->addTorque(-0.04f * amount * PxVec3(upVec.x, upVec.y, upVec.z), PxForceMode::eVELOCITY_CHANGE);
 }
+void PVehicle::airBrake(float factor) {
+	if (this->m_replay) this->m_replay->write(this->carid, VehicleCommand::eAIR_BRAKE, factor);
+	this->getRigidDynamic()->setAngularVelocity(this->getRigidDynamic()->getAngularVelocity() * factor);
+}
 void PVehicle::boost() {
+	if (this->m_replay) this->m_replay->write(this->carid, VehicleCommand::eBOOST);
 	if (this->vehicleParams.boost > 0) {
 		// stuff to do if vehicle just started boosting
 		if (!this->vehicleParams.boosting) {
@@ -300,24 +303,36 @@ void PVehicle::boost() {
 		glm::vec3 frontVec = this->getFrontVec();
 		this->getRigidDynamic()->addForce(PxVec3(frontVec.x, frontVec.y, frontVec.z) * 0.5f, PxForceMode::eVELOCITY_CHANGE);
 		this->vehicleParams.boost--;
-		this->vehicleParams.boostCooldown = time(0);
+		this->vehicleParams.boostCooldown = SimClock::time();
+	}
+}
+void PVehicle::holdBoost(bool held) {
+	if (this->m_replay) this->m_replay->write(this->carid, VehicleCommand::eHOLD_BOOST, held ? 1.0f : 0.0f);
+	this->vehicleParams.boosting = held;
+}
+void PVehicle::boostTowards(const PxVec3& direction) {
+	if (this->m_replay) this->m_replay->write(this->carid, VehicleCommand::eBOOST_TOWARDS, direction);
+	if (this->vehicleParams.boost > 0) {
+		this->getRigidDynamic()->addForce(direction * 0.5f, PxForceMode::eVELOCITY_CHANGE);
+		this->vehicleParams.boost--;
 	}
 }
 void PVehicle::regainBoost() {
-	if (this->vehicleParams.boost < 100 && difftime(time(0), this->vehicleParams.boostCooldown) > 0.2f && !this->getVehicleInAir()) this->vehicleParams.boost++;
+	if (this->vehicleParams.boost < 100 && difftime(SimClock::time(), this->vehicleParams.boostCooldown) > 0.2f && !this->getVehicleInAir()) this->vehicleParams.boost++;
 }
 void PVehicle::jump() {
+	if (this->m_replay) this->m_replay->write(this->carid, VehicleCommand::eJUMP);
 	if (this->vehicleParams.canJump) {
 		this->vehicleParams.canJump = false;
 		PxVec3 vel = this->getRigidDynamic()->getLinearVelocity();
 		if (vel.y < 0) this->getRigidDynamic()->setLinearVelocity(PxVec3(vel.x, 0.f, vel.z));
 		this->getRigidDynamic()->addForce(PxVec3(0.0, 15.0f, 0.0), PxForceMode::eVELOCITY_CHANGE);
-		this->vehicleParams.jumpCooldown = time(0);
+		this->vehicleParams.jumpCooldown = SimClock::time();
 		AudioManager::get().playSound(SFX_JUMP_NORMAL, Utils::instance().pxToGlmVec3(this->getPosition()), 0.45f);
 	}
 }
 void PVehicle::regainJump() {
-	if (difftime(time(0), this->vehicleParams.jumpCooldown) > 1.0f && !this->getVehicleInAir()) this->vehicleParams.canJump = true;
+	if (difftime(SimClock::time(), this->vehicleParams.jumpCooldown) > 1.0f && !this->getVehicleInAir()) this->vehicleParams.canJump = true;
 }
 
 
@@ -353,20 +368,11 @@ PowerUpType PVehicle::getPocket() const {
 	return this->m_powerUpPocket;
 }
 #pragma endregion
-void PVehicle::render() {
-	const int MAX_NUM_ACTOR_SHAPES = 128;
-	PxShape* shapes[MAX_NUM_ACTOR_SHAPES];
-
-	PxRigidActor* rigidActor = static_cast<PxRigidActor*>(gVehicle4W->getRigidDynamicActor());
+void PVehicle::render(const VehicleSnapshot& snapshot, float alpha) {
+	const PxTransform actorPose = snapshot.getInterpolatedPose(alpha);
 
-	const PxU32 nbShapes = rigidActor->getNbShapes();
-
-	PX_ASSERT(nbShapes <= MAX_NUM_ACTOR_SHAPES);
-	rigidActor->getShapes(shapes, nbShapes);
-
-	for (PxU32 i = 0; i < nbShapes; i++) {
-		const PxMat44 shapePose(PxShapeExt::getGlobalPose(*shapes[i], *rigidActor));
-		const PxGeometryHolder h = shapes[i]->getGeometry();
+	for (int i = 0; i < VehicleSnapshot::NUM_SHAPES; i++) {
+		const PxMat44 shapePose(actorPose * snapshot.shapeLocalPoses[i]);
 
 		glm::mat4 TM = glm::make_mat4(&shapePose.column0.x);
 
@@ -378,23 +384,101 @@ void PVehicle::render() {
 
 		if (i < 4) this->m_tires.draw(TM);
 		else  this->m_chassis.draw(TM);
+	}
+}
 
-		//if (i >= 4) this->m_chassis.draw(TM);
+AABB PVehicle::getRenderBounds(const VehicleSnapshot& snapshot, float alpha) const {
+	const PxTransform actorPose = snapshot.getInterpolatedPose(alpha);
+	const AABB tire = this->m_tires.getBounds();
+	const AABB chassis = this->m_chassis.getBounds();
 
+	AABB bounds;
+	for (int i = 0; i < VehicleSnapshot::NUM_SHAPES; i++) {
+		const PxMat44 shapePose(actorPose * snapshot.shapeLocalPoses[i]);
+		bounds.add((i < 4 ? tire : chassis).transformed(glm::make_mat4(&shapePose.column0.x)));
 	}
+	return bounds;
+}
+
+void PVehicle::writeSnapshot(VehicleSnapshot& snapshot) {
+	const int MAX_NUM_ACTOR_SHAPES = 128;
+	PxShape* shapes[MAX_NUM_ACTOR_SHAPES];
+
+	PxRigidActor* rigidActor = static_cast<PxRigidActor*>(gVehicle4W->getRigidDynamicActor());
+
+	const PxU32 nbShapes = rigidActor->getNbShapes();
+
+	PX_ASSERT(nbShapes <= MAX_NUM_ACTOR_SHAPES);
+	rigidActor->getShapes(shapes, nbShapes);
+
+	// the wheel shapes are moved by the vehicle sdk every update, so they go in the snapshot too.
+	for (PxU32 i = 0; i < nbShapes && i < VehicleSnapshot::NUM_SHAPES; i++) snapshot.shapeLocalPoses[i] = shapes[i]->getLocalPose();
+
+	snapshot.prevPose = this->m_prevPose;
+	snapshot.currPose = this->m_currPose;
+	snapshot.frontVec = this->getFrontVec();
+	snapshot.speed = this->getRigidDynamic()->getLinearVelocity().magnitude();
+
+	snapshot.damage = this->vehicleAttr.collisionCoefficient;
+	snapshot.flashWhite = this->vehicleParams.flashWhite;
+	snapshot.shieldState = this->m_shieldState;
+
+	snapshot.carid = this->carid;
+	snapshot.lives = this->m_lives;
+	snapshot.boost = this->vehicleParams.boost;
+	snapshot.pocket = this->m_powerUpPocket;
+}
+
+void PVehicle::teleport(const PxTransform& pose) {
+	this->getRigidDynamic()->setGlobalPose(pose);
+	this->snapPose();
+}
+
+// drop the previous step so the next render doesn't blend across a teleport or a pause.
+void PVehicle::snapPose() {
+	this->m_currPose = this->getRigidDynamic()->getGlobalPose();
+	this->m_prevPose = this->m_currPose;
 }
 
 void PVehicle::reset() {
-	this->getRigidDynamic()->setGlobalPose(PxTransform(this->m_startingPosition, PxQuat(PxPi, PxVec3(0.0f, 1.0f, 0.0f))));
+	this->teleport(PxTransform(this->m_startingPosition, PxQuat(PxPi, PxVec3(0.0f, 1.0f, 0.0f))));
 	this->getRigidDynamic()->setLinearVelocity(PxVec3(0.f));
 	this->getRigidDynamic()->setAngularVelocity(PxVec3(0.f));
 	this->vehicleParams.boost = 100;
 	//this->m_lives = 3;
 }
 
+void PVehicle::manualReset() {
+	if (this->m_replay) this->m_replay->write(this->carid, VehicleCommand::eRESET);
+	this->reset();
+}
+
+void PVehicle::restart() {
+	this->m_state = VehicleState::ePLAYING;
+	this->m_lives = 3;
+	this->m_shieldState = ShieldPowerUpState::eINACTIVE;
+	this->m_shieldUseTimestamp = SimClock::now();
+	this->m_powerUpPocket = PowerUpType::eEMPTY;
+	this->accelerating = false;
+
+	// drop cooldowns, targets and drivetrain state left over from the last round.
+	this->vehicleParams = VehicleParams();
+	this->initVehicleCollisionAttributes();
+	this->vehicleAttr.collisionCoefficient = 0.0f;
+	this->releaseAllControls();
+	gVehicle4W->setToRestState();
+	gVehicle4W->mDriveDynData.forceGearChange(PxVehicleGearsData::eNEUTRAL);
+
+	this->reset();
+}
+
+void PVehicle::setReplay(Replay* replay) {
+	this->m_replay = replay;
+}
+
 void PVehicle::flashWhite() {
 	this->vehicleParams.flashWhite = 1.0f;
-	this->vehicleParams.flashDuration = time(0);
+	this->vehicleParams.flashDuration = SimClock::time();
 }
 
 void PVehicle::regainFlash() {
@@ -403,7 +487,7 @@ void PVehicle::regainFlash() {
 }
 
 void PVehicle::updateState() {
-	time_point now = steady_clock::now();
+	time_point now = SimClock::now();
 
 	switch (this->m_state) {
 	case VehicleState::ePLAYING:
@@ -411,7 +495,7 @@ void PVehicle::updateState() {
 		if (this->getPosition().y < -100.f) {
 			Log::debug("dead:");
 			this->m_state = VehicleState::eRESPAWNING;
-			deathTimestamp = steady_clock::now();
+			deathTimestamp = SimClock::now();
 			this->m_lives--;
 			AudioManager::get().playSound(SFX_DEATH, Utils::instance().pxToGlmVec3(this->getPosition()), 0.9f);
 			this->vehicleAttr.collisionCoefficient = 0.0f;
@@ -492,6 +576,7 @@ void PVehicle::pickUpPowerUp(PowerUp* p) {
 }
 
 void PVehicle::usePowerUp() {
+	if (this->m_replay) this->m_replay->write(this->carid, VehicleCommand::eUSE_POWERUP);
 	PxVec3 vel = this->getRigidDynamic()->getLinearVelocity();
 	switch (this->m_powerUpPocket) {
 	case PowerUpType::eJUMP:
@@ -503,7 +588,7 @@ void PVehicle::usePowerUp() {
 
 	case PowerUpType::eSHIELD:
 		this->m_shieldState = ShieldPowerUpState::eACTIVE;
-		m_shieldUseTimestamp = steady_clock::now();
+		m_shieldUseTimestamp = SimClock::now();
 		this->m_powerUpPocket = PowerUpType::eSHIELD;
 		break;
 
@@ -549,10 +634,7 @@ void PVehicle::driveTo(const PxVec3& targetPos, PVehicle* targetVehicle, PowerUp
 
 
 			//this->boost();
-			if (this->vehicleParams.boost > 0) {
-				this->getRigidDynamic()->addForce(PxVec3(newFront.x, newFront.y, newFront.z) * 0.5f, PxForceMode::eVELOCITY_CHANGE);
-				this->vehicleParams.boost--;
-			}
+			this->boostTowards(newFront);
 
 
 		
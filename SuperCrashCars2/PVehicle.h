@@ -25,6 +25,9 @@ using namespace std::chrono;
 
 #define PX_RELEASE(x)	if(x)	{ x->release(); x = NULL;	}
 
+struct VehicleSnapshot;
+class Replay;
+
 enum class VehicleType {
 	eAVA_GREEN,
 	eAVA_BLUE,
@@ -64,16 +67,16 @@ struct VehicleParams {
 
 	// jumping
 	bool canJump = true;
-	time_t jumpCooldown;
+	time_t jumpCooldown = 0;
 
 	// boosting
 	bool boosting = false;
-	time_t boostCooldown;
+	time_t boostCooldown = 0;
 	int boost = 100;
 
 	// visual effects
 	float flashWhite = 0.0f;
-	time_t flashDuration;
+	time_t flashDuration = 0;
 
 };
 
@@ -92,13 +95,18 @@ public:
 	void handbrake();
 	void rotateYAxis(float amount);
 	void rotateXAxis(float amount);
+	void airBrake(float factor);
 	void boost();
+	void holdBoost(bool held);
+	void boostTowards(const PxVec3& direction);
 	void regainBoost();
 	void jump();
 	void regainJump();
 	void flashWhite();
 	void regainFlash();
 	void reset();
+	void manualReset(); // reset asked for by the player, respawns call reset() directly
+	void restart(); // fresh car for a new round
 	void updateSound();
 
 	PxMat44 getTransform() const;
@@ -111,8 +119,19 @@ public:
 	
 	Model m_shieldSphere;
 
-	void render();
+	// render thread only, draws from a snapshot instead of the live actor.
+	void render(const VehicleSnapshot& snapshot, float alpha);
+	// world bounds of everything render() would draw
+	AABB getRenderBounds(const VehicleSnapshot& snapshot, float alpha) const;
+	void writeSnapshot(VehicleSnapshot& snapshot);
+
+	// every input this car receives is written to the replay while it is recording.
+	void setReplay(Replay* replay);
 
+	void teleport(const PxTransform& pose);
+	void snapPose();
+
+	void updateInputs();
 	void updatePhysics();
 	void free();
 
@@ -142,11 +161,14 @@ public:
 private:
 	PxVehicleDrive4W* gVehicle4W = NULL;
 
-	VehicleSceneQueryData* gVehicleSceneQueryData = NULL;
-	PxBatchQuery* gBatchQuery = NULL;
-	PxVehicleDrivableSurfaceToTireFrictionPairs* gFrictionPairs = NULL;
+	PxU32 m_fleetIndex;
+	Replay* m_replay = nullptr;
 	bool gIsVehicleInAir = true;
 
+	// actor pose after the previous and the latest simulation step, blended when rendering.
+	PxTransform m_prevPose;
+	PxTransform m_currPose;
+
 	PhysicsManager& m_pm;
 	bool m_isFalling = false;
 
@@ -212,6 +234,7 @@ private:
 	VehicleDesc initVehicleDesc();
 	void adjustConvexCollisionMesh(const PxVec3& chassis_tran, const PxVec3& chassis_scale, const PxVec3& wheel_tran, const PxVec3& wheel_scale);
 	void releaseAllControls();
+	void applyYawTorque(float amount);
 
 	void initVehicleCollisionAttributes();
 
@@ -0,0 +1,72 @@
+#include "PhysicsBenchmark.h"
+
+#include "PVehicle.h"
+#include "Log.h"
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+using namespace std::chrono;
+
+void PhysicsBenchmark::run(const std::vector<PxU32>& vehicleCounts, PxU32 ticks) {
+	std::vector<PxU32> workerCounts = { 1 };
+	const PxU32 hardwareThreads = PxMax(std::thread::hardware_concurrency(), 1u);
+	for (PxU32 workers = 2; workers < hardwareThreads; workers *= 2) workerCounts.push_back(workers);
+	if (hardwareThreads > 1) workerCounts.push_back(hardwareThreads);
+	if (std::find(workerCounts.begin(), workerCounts.end(), PhysicsManager::defaultNumWorkers()) == workerCounts.end()) workerCounts.push_back(PhysicsManager::defaultNumWorkers());
+	std::sort(workerCounts.begin(), workerCounts.end());
+
+	Log::info("Physics benchmark: {} ticks per case, {} hardware threads.", ticks, hardwareThreads);
+	Log::info("{:>8} | {:>7} | {:>14} | {:>16}", "vehicles", "workers", "tick (us)", "vehicles (us)");
+	for (PxU32 numVehicles : vehicleCounts) {
+		for (PxU32 numWorkers : workerCounts) {
+			std::pair<double, double> result = runCase(numVehicles, numWorkers, ticks);
+			Log::info("{:>8} | {:>7} | {:>14.1f} | {:>16.1f}", numVehicles, numWorkers, result.first, result.second);
+		}
+	}
+}
+
+std::pair<double, double> PhysicsBenchmark::runCase(PxU32 numVehicles, PxU32 numWorkers, PxU32 ticks) {
+	PhysicsManager pm = PhysicsManager(1.3f / 60.0f, numWorkers);
+
+	// lay the cars out on a grid in the middle of the map.
+	std::vector<PVehicle*> vehicles;
+	const PxU32 columns = 8;
+	for (PxU32 i = 0; i < numVehicles; i++) {
+		const PxVec3 position((float)(i % columns) * 12.0f - 42.0f, 25.0f, (float)(i / columns) * 15.0f - 52.0f);
+		vehicles.push_back(new PVehicle(i, pm, (VehicleType)(i % 4), PlayerOrAI::eAI, position));
+	}
+
+	const PxU32 warmupTicks = 60;
+	double tickTotal = 0.0;
+	double vehicleTotal = 0.0;
+	for (PxU32 tick = 0; tick < warmupTicks + ticks; tick++) {
+		// keep every car busy: full throttle while weaving.
+		for (PxU32 i = 0; i < vehicles.size(); i++) {
+			vehicles[i]->accelerate(1.0f);
+			if ((tick / 120 + i) % 2 == 0) vehicles[i]->turnLeft(0.5f);
+			else vehicles[i]->turnRight(0.5f);
+		}
+
+		time_point<steady_clock> tickStart = steady_clock::now();
+		pm.simulate();
+		time_point<steady_clock> vehicleStart = steady_clock::now();
+		for (PVehicle* vehicle : vehicles) vehicle->updateInputs();
+		pm.updateVehicles();
+		for (PVehicle* vehicle : vehicles) vehicle->updatePhysics();
+		time_point<steady_clock> tickEnd = steady_clock::now();
+
+		if (tick < warmupTicks) continue;
+		tickTotal += duration<double, std::micro>(tickEnd - tickStart).count();
+		vehicleTotal += duration<double, std::micro>(tickEnd - vehicleStart).count();
+	}
+
+	for (PVehicle* vehicle : vehicles) {
+		vehicle->free();
+		delete vehicle;
+	}
+	pm.free();
+
+	return { tickTotal / ticks, vehicleTotal / ticks };
+}
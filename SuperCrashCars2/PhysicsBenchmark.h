@@ -0,0 +1,18 @@
+#pragma once
+
+#include "PhysicsManager.h"
+
+#include <vector>
+
+// Drives a fleet of cars for a fixed number of ticks with every combination of
+// vehicle count and PhysX worker count, and logs the average tick time.
+// Needs a current GL context since the cars load their models.
+class PhysicsBenchmark {
+
+public:
+	static void run(const std::vector<PxU32>& vehicleCounts = { 4, 16, 64 }, PxU32 ticks = 600);
+
+private:
+	// returns the average { full tick, vehicle update only } time in microseconds.
+	static std::pair<double, double> runCase(PxU32 numVehicles, PxU32 numWorkers, PxU32 ticks);
+};
@@ -1,8 +1,12 @@
 #include "PhysicsManager.h"
 
+#include "CookCache.h"
+
+#include <thread>
+
 #define PX_RELEASE(x)	if(x)	{ x->release(); x = NULL;	}
 
-PhysicsManager::PhysicsManager(const PxF32 timestep) : timestep(timestep) {
+PhysicsManager::PhysicsManager(const PxF32 timestep, const PxU32 numWorkers) : timestep(timestep), numWorkers(PxMax(numWorkers, 1u)) {
 
 	gFoundation = PxCreateFoundation(PX_PHYSICS_VERSION, gAllocator, gErrorCallback);
 	gPvd = PxCreatePvd(*gFoundation);
@@ -13,11 +17,13 @@ PhysicsManager::PhysicsManager(const PxF32 timestep) : timestep(timestep) {
 	PxSceneDesc sceneDesc(gPhysics->getTolerancesScale());
 	sceneDesc.gravity = PxVec3(0.0f, -9.81f, 0.0f);
 
-	PxU32 numWorkers = 1;
-	gDispatcher = PxDefaultCpuDispatcherCreate(numWorkers);
+	gDispatcher = PxDefaultCpuDispatcherCreate(this->numWorkers);
+	Log::info("PhysX dispatcher using {} worker thread(s).", this->numWorkers);
 	sceneDesc.cpuDispatcher = gDispatcher;
 	sceneDesc.filterShader = VehicleFilterShader;
 	sceneDesc.simulationEventCallback = &gEventCallback;
+	// same inputs give the same results no matter what the scene went through before, replays depend on it.
+	sceneDesc.flags |= PxSceneFlag::eENABLE_ENHANCED_DETERMINISM;
 
 	gScene = gPhysics->createScene(sceneDesc);
 	PxPvdSceneClient* pvdClient = gScene->getScenePvdClient();
@@ -34,6 +40,9 @@ PhysicsManager::PhysicsManager(const PxF32 timestep) : timestep(timestep) {
 	PxVehicleSetBasisVectors(PxVec3(0, 1, 0), PxVec3(0, 0, 1));
 	PxVehicleSetUpdateMode(PxVehicleUpdateMode::eVELOCITY_CHANGE);
 
+	//Shared raycast batch and friction table for every vehicle.
+	this->m_vehicleFleet.init(gScene, gMaterial, gAllocator, gDispatcher, this->numWorkers);
+
 	//Create a plane to drive on.
 	this->m_groundModel = Model("models/ground/ground.obj");
 	std::vector<PxVec3> vertices;
@@ -55,7 +64,12 @@ void PhysicsManager::simulate() {
 	gScene->fetchResults(true);
 }
 
+void PhysicsManager::updateVehicles() {
+	this->m_vehicleFleet.update(this->timestep, gScene->getGravity());
+}
+
 void PhysicsManager::free() {
+	this->m_vehicleFleet.free(gAllocator);
 	PxCloseVehicleSDK();
 	PX_RELEASE(gGroundPlane);
 	PX_RELEASE(gMaterial);
@@ -76,36 +90,16 @@ void PhysicsManager::drawGround() {
 }
 
 PxTriangleMesh* PhysicsManager::createTriangleMesh(const std::vector<PxVec3>& verts, const std::vector<PxU32>& indices) {
-	PxTriangleMeshDesc meshDesc;
-	meshDesc.points.count = verts.size();
-	meshDesc.points.stride = sizeof(PxVec3);
-	meshDesc.points.data = &verts[0];
-
-	meshDesc.triangles.count = indices.size() / 3;
-	meshDesc.triangles.stride = 3 * sizeof(PxU32);
-	meshDesc.triangles.data = &indices[0];
-
-	PxDefaultMemoryOutputStream writeBuffer;
-	PxTriangleMeshCookingResult::Enum result;
-	bool status = gCooking->cookTriangleMesh(meshDesc, writeBuffer, &result);
-	if (!status) return NULL;
-
-	PxDefaultMemoryInputData readBuffer(writeBuffer.getData(), writeBuffer.getSize());
-	return gPhysics->createTriangleMesh(readBuffer);
+	return CookCache::get().createTriangleMesh(*gPhysics, *gCooking, verts.data(), (PxU32)verts.size(), indices.data(), (PxU32)indices.size());
 }
 
 PxConvexMesh* PhysicsManager::createConvexMesh(const std::vector<PxVec3>& verts) {
-	PxConvexMeshDesc convexDesc;
-	convexDesc.points.count = verts.size();
-	convexDesc.points.stride = sizeof(PxVec3);
-	convexDesc.points.data = &verts[0];
-	convexDesc.flags = PxConvexFlag::eCOMPUTE_CONVEX;
-
-	PxDefaultMemoryOutputStream buf;
-	if (!gCooking->cookConvexMesh(convexDesc, buf)) return NULL;
+	return CookCache::get().createConvexMesh(*gPhysics, *gCooking, verts.data(), (PxU32)verts.size());
+}
 
-	PxDefaultMemoryInputData input(buf.getData(), buf.getSize());
-	return gPhysics->createConvexMesh(input);
+PxU32 PhysicsManager::defaultNumWorkers() {
+	const unsigned int hardwareThreads = std::thread::hardware_concurrency();
+	return hardwareThreads > 2 ? hardwareThreads - 2 : 1;
 }
 
 PhysicsManager::~PhysicsManager() {}
\ No newline at end of file
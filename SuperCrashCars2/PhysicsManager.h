@@ -6,6 +6,7 @@
 #include "EventCallback.h"
 #include "SnippetVehicleFilterShader.h"
 #include "SnippetVehicleCreate.h"
+#include "VehicleFleet.h"
 
 using namespace physx;
 using namespace snippetvehicle;
@@ -13,7 +14,7 @@ using namespace snippetvehicle;
 class PhysicsManager {
 
 public:
-	PhysicsManager(const PxF32 timestep);
+	PhysicsManager(const PxF32 timestep, const PxU32 numWorkers = defaultNumWorkers());
 	~PhysicsManager();
 
 	PxDefaultAllocator gAllocator;
@@ -29,14 +30,20 @@ public:
 	EventCallback gEventCallback;
 
 	const PxF32 timestep;
+	const PxU32 numWorkers;
 
 	Model m_groundModel;
+	VehicleFleet m_vehicleFleet;
 
 	void simulate();
+	void updateVehicles();
 	void free();
 
 	void drawGround();
 
 	PxTriangleMesh* createTriangleMesh(const std::vector<PxVec3>& verts, const std::vector<PxU32>& indices);
 	PxConvexMesh* createConvexMesh(const std::vector<PxVec3>& verts);
+
+	// hardware threads minus the sim and render threads, at least one.
+	static PxU32 defaultNumWorkers();
 };
\ No newline at end of file
@@ -1,4 +1,6 @@
 #include "PowerUp.h"
+#include "SceneSnapshot.h"
+#include "SimClock.h"
 
 PowerUp::PowerUp(PhysicsManager& pm, const Model& model, const PowerUpType& powerUpType, const PxVec3& position, const PxQuat& rotation) :
 	PStatic(pm, model, position, rotation) 
@@ -37,11 +39,55 @@ PxVec3 PowerUp::getPosition() const {
 }
 
 
-void PowerUp::render() {
+void PowerUp::render(const PowerUpSnapshot& snapshot, float alpha) {
+	glm::mat4 TM = this->getRenderTransform(snapshot, alpha);
+
+	this->m_model.draw(TM);
+}
+
+glm::mat4 PowerUp::getRenderTransform(const PowerUpSnapshot& snapshot, float alpha) const {
+	const PxMat44 shapePose(snapshot.getShapePose(alpha));
+	return glm::make_mat4(&shapePose.column0.x);
+}
+
+AABB PowerUp::getRenderBounds(const PowerUpSnapshot& snapshot, float alpha) const {
+	return this->m_model.getBounds().transformed(this->getRenderTransform(snapshot, alpha));
+}
+
+void PowerUp::renderInstanced(const std::vector<glm::mat4>& transforms) {
+	this->m_model.setInstances(transforms);
+	this->m_model.drawInstanced();
+}
+
+void PowerUp::writeSnapshot(PowerUpSnapshot& snapshot) const {
+	snapshot.active = this->active;
+	snapshot.prevAngle = this->m_prevAngle;
+	snapshot.angle = this->m_angle;
 
+	PxRigidActor* rigidActor = static_cast<PxRigidActor*>(this->m_static);
+	if (!rigidActor || rigidActor->getNbShapes() == 0) {
+		snapshot.active = false;
+		return;
+	}
+
+	PxShape* shape;
+	rigidActor->getShapes(&shape, 1);
+	snapshot.pose = rigidActor->getGlobalPose();
+	snapshot.shapeOffset = shape->getLocalPose().p;
+}
+
+// spins the power up by a fixed amount every simulation step.
+void PowerUp::update() {
 	PxRigidActor* rigidActor = static_cast<PxRigidActor*>(this->m_static);
 	if (!rigidActor) return;
 
+	this->m_prevAngle = this->m_angle;
+	this->m_angle += glm::radians(2.0f);
+	if (this->m_angle >= 2.0f * PxPi) {
+		this->m_angle -= 2.0f * PxPi;
+		this->m_prevAngle -= 2.0f * PxPi;
+	}
+
 	const int MAX_NUM_ACTOR_SHAPES = 128;
 	PxShape* shapes[MAX_NUM_ACTOR_SHAPES];
 
@@ -51,26 +97,21 @@ void PowerUp::render() {
 	rigidActor->getShapes(shapes, nbShapes);
 
 	for (PxU32 i = 0; i < nbShapes; i++) {
-		const PxMat44 shapePose(PxShapeExt::getGlobalPose(*shapes[i], *rigidActor));
-		const PxGeometryHolder h = shapes[i]->getGeometry();
-		
-		glm::mat4 TM = glm::make_mat4(&shapePose.column0.x);
-
-		// rotate
-		this->m_model.rotate(glm::radians(2.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-		shapes[i]->setLocalPose(PxTransform(shapes[i]->getLocalPose().p, PxQuat(this->m_model.getAngle(), PxVec3(0.0f, 1.0f, 0.0f))));
-
-		this->m_model.draw(TM);
+		shapes[i]->setLocalPose(PxTransform(shapes[i]->getLocalPose().p, PxQuat(this->m_angle, PxVec3(0.0f, 1.0f, 0.0f))));
 	}
 }
 
+void PowerUp::snapPose() {
+	this->m_prevAngle = this->m_angle;
+}
+
 void PowerUp::collect(){
 	this->active = false;
-	triggeredTimestamp = steady_clock::now();
+	triggeredTimestamp = SimClock::now();
 }
 
 void PowerUp::tryRespawn(){
-	if (duration_cast<seconds>(steady_clock::now() - triggeredTimestamp) > seconds(15)) {
+	if (duration_cast<seconds>(SimClock::now() - triggeredTimestamp) > seconds(15)) {
 		this->active = true;
 		this->triggered = false;
 	}
@@ -23,13 +23,24 @@ enum class ShieldPowerUpState { // states of a shield powerup
 
 
 
+struct PowerUpSnapshot;
+
 class PowerUp : public PStatic {
 
 public:
 	PowerUp(PhysicsManager& pm, const Model& model, const PowerUpType& powerUpType, const PxVec3& position = PxVec3(0.0f), const PxQuat& rotation = PxQuat(PxPi, PxVec3(0.0f, 1.0f, 0.0f)));
 	~PowerUp() {};
 
-	void render();
+	// render thread only, draws from a snapshot instead of the live actor.
+	void render(const PowerUpSnapshot& snapshot, float alpha);
+	// the transform render() would draw with
+	glm::mat4 getRenderTransform(const PowerUpSnapshot& snapshot, float alpha) const;
+	AABB getRenderBounds(const PowerUpSnapshot& snapshot, float alpha) const;
+	// draws this power up's model at every transform in one go, for all power ups that share the model
+	void renderInstanced(const std::vector<glm::mat4>& transforms);
+	void writeSnapshot(PowerUpSnapshot& snapshot) const;
+	void update();
+	void snapPose();
 
 	void destroy();
 	void collect();
@@ -45,5 +56,9 @@ public:
 private:
 	PowerUpType m_powerUpType;
 	PxVec3 m_startingPosition;
+
+	// spin angle (radians) after the previous and the latest simulation step.
+	float m_prevAngle = 0.0f;
+	float m_angle = 0.0f;
 	
 };
\ No newline at end of file
@@ -0,0 +1,174 @@
+#include "Profiler.h"
+
+#include "Log.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+thread_local Profiler::ThreadState Profiler::s_thread;
+
+Profiler::Profiler() : m_epoch(steady_clock::now()) {
+	for (int i = 0; i < MAX_THREADS; i++) this->m_rings[i] = std::make_unique<Ring>();
+}
+
+Profiler::Ring* Profiler::ring() {
+	if (!s_thread.registered) {
+		s_thread.registered = true;
+		const int index = this->m_numRings.fetch_add(1);
+		if (index < MAX_THREADS) s_thread.ring = this->m_rings[index].get();
+		else Log::warning("Profiler: more than {} threads, ignoring the new one", MAX_THREADS);
+	}
+	return s_thread.ring;
+}
+
+int64_t Profiler::now() const {
+	return duration_cast<microseconds>(steady_clock::now() - this->m_epoch).count();
+}
+
+void Profiler::setThreadName(const char* name) {
+	Ring* ring = this->ring();
+	if (ring) ring->threadName = name;
+}
+
+void Profiler::begin(const char* name) {
+	if (s_thread.depth < MAX_DEPTH) {
+		s_thread.names[s_thread.depth] = name;
+		s_thread.starts[s_thread.depth] = this->now();
+	}
+	s_thread.depth++;
+}
+
+void Profiler::end() {
+	s_thread.depth--;
+	if (s_thread.depth < 0 || s_thread.depth >= MAX_DEPTH) return; // unbalanced or too deep to keep
+
+	Ring* ring = this->ring();
+	if (!ring) return;
+
+	ProfileEvent event;
+	event.name = s_thread.names[s_thread.depth];
+	event.start = s_thread.starts[s_thread.depth];
+	event.duration = (int32_t)(this->now() - event.start);
+	event.depth = s_thread.depth;
+	this->push(*ring, event);
+}
+
+int Profiler::addTrack(const char* name) {
+	const int index = this->m_numRings.fetch_add(1);
+	if (index >= MAX_THREADS) {
+		Log::warning("Profiler: no room for track {}", name);
+		return -1;
+	}
+	this->m_rings[index]->threadName = name;
+	return index;
+}
+
+void Profiler::record(int track, const ProfileEvent& event) {
+	if (track < 0 || track >= MAX_THREADS) return;
+	this->push(*this->m_rings[track], event);
+}
+
+void Profiler::push(Ring& ring, const ProfileEvent& event) {
+	const uint64_t head = ring.head.load(std::memory_order_relaxed);
+	ring.events[head & (CAPACITY - 1)] = event;
+	ring.head.store(head + 1, std::memory_order_release);
+}
+
+void Profiler::copyEvents(int i, uint64_t count, std::vector<ProfileEvent>& out) const {
+	const Ring& ring = *this->m_rings[i];
+	const uint64_t head = ring.head.load(std::memory_order_acquire);
+	// stay half a ring behind the writer, it would have to lap us mid-copy to tear an event.
+	count = std::min(std::min(count, head), CAPACITY / 2);
+	for (uint64_t e = head - count; e < head; e++) out.push_back(ring.events[e & (CAPACITY - 1)]);
+}
+
+std::vector<PhaseStats> Profiler::computeStats() const {
+	std::vector<PhaseStats> stats;
+	std::vector<ProfileEvent> events;
+	std::vector<float> durations;
+
+	const int numRings = std::min(this->m_numRings.load(), MAX_THREADS);
+	for (int i = 0; i < numRings; i++) {
+		events.clear();
+		this->copyEvents(i, STATS_WINDOW, events);
+
+		// phases in the order they first show up, durations gathered per phase
+		// (compared by contents, the same literal in two files is not guaranteed to share an address)
+		std::vector<const char*> names;
+		for (const ProfileEvent& event : events) {
+			auto same = [&](const char* name) { return std::strcmp(name, event.name) == 0; };
+			if (std::find_if(names.begin(), names.end(), same) == names.end()) names.push_back(event.name);
+		}
+		for (const char* name : names) {
+			durations.clear();
+			int depth = 0;
+			for (const ProfileEvent& event : events) {
+				if (std::strcmp(event.name, name) != 0) continue;
+				durations.push_back(event.duration / 1000.0f);
+				depth = event.depth;
+			}
+			std::sort(durations.begin(), durations.end());
+
+			PhaseStats phase;
+			phase.name = name;
+			phase.thread = this->m_rings[i]->threadName;
+			phase.depth = depth;
+			phase.count = (int)durations.size();
+			phase.p50 = durations[durations.size() / 2];
+			phase.p99 = durations[(durations.size() * 99) / 100];
+			phase.max = durations.back();
+			stats.push_back(phase);
+		}
+	}
+	return stats;
+}
+
+bool Profiler::exportChromeTrace(const std::string& path) const {
+	std::ofstream file(path);
+	if (!file) {
+		Log::error("Could not write profile {}", path);
+		return false;
+	}
+
+	std::vector<ProfileEvent> events;
+	file << "{\"traceEvents\":[\n";
+	bool first = true;
+	const int numRings = std::min(this->m_numRings.load(), MAX_THREADS);
+	for (int i = 0; i < numRings; i++) {
+		events.clear();
+		this->copyEvents(i, CAPACITY, events);
+
+		file << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << i << ",\"args\":{\"name\":\"" << this->m_rings[i]->threadName << "\"}}";
+		first = false;
+		for (const ProfileEvent& event : events) {
+			file << ",\n{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << i << ",\"ts\":" << event.start << ",\"dur\":" << event.duration << "}";
+		}
+	}
+	file << "\n]}\n";
+
+	Log::info("Saved chrome trace {}", path);
+	return (bool)file;
+}
+
+bool Profiler::exportCSV(const std::string& path) const {
+	std::ofstream file(path);
+	if (!file) {
+		Log::error("Could not write profile {}", path);
+		return false;
+	}
+
+	std::vector<ProfileEvent> events;
+	file << "thread,phase,depth,start_us,duration_us\n";
+	const int numRings = std::min(this->m_numRings.load(), MAX_THREADS);
+	for (int i = 0; i < numRings; i++) {
+		events.clear();
+		this->copyEvents(i, CAPACITY, events);
+		for (const ProfileEvent& event : events) {
+			file << this->m_rings[i]->threadName << "," << event.name << "," << event.depth << "," << event.start << "," << event.duration << "\n";
+		}
+	}
+
+	Log::info("Saved profile {}", path);
+	return (bool)file;
+}
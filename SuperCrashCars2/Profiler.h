@@ -0,0 +1,113 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace std::chrono;
+
+// one finished PROFILE_SCOPE. name must be a string literal (or otherwise outlive the profiler),
+// scopes with the same name are one phase.
+struct ProfileEvent {
+	const char* name;
+	int64_t start;		// microseconds since the profiler was created
+	int32_t duration;	// microseconds
+	int32_t depth;		// how many scopes were open around this one on the same thread
+};
+
+// p50/p99 of one phase over the most recent events of its thread.
+struct PhaseStats {
+	const char* name;
+	const char* thread;
+	int depth;
+	int count;
+	float p50;	// milliseconds
+	float p99;
+	float max;
+};
+
+// Scoped, nestable timing markers for the sim and render threads. Every thread writes finished
+// scopes into its own ring buffer without locks; the overlay and the exporters read the newest
+// events from any thread. Usage:
+//		PROFILE_SCOPE("physics");
+class Profiler {
+
+public:
+	static Profiler& get() {
+		static Profiler instance;
+		return instance;
+	}
+	Profiler(Profiler const&) = delete;
+	void operator=(Profiler const&) = delete;
+
+	// label for the calling thread in the overlay and the trace, registers the thread if it is new.
+	void setThreadName(const char* name);
+
+	void begin(const char* name);
+	void end();
+
+	// a named track not tied to any thread, for timings measured elsewhere (e.g. GpuTimer).
+	// only one thread may record into a given track. returns -1 if there is no room left.
+	int addTrack(const char* name);
+	void record(int track, const ProfileEvent& event);
+
+	// microseconds since the profiler was created, the time base of every event.
+	int64_t now() const;
+
+	// stats over roughly the last few seconds of every thread, sorted by thread then first appearance.
+	std::vector<PhaseStats> computeStats() const;
+
+	// everything still in the rings, as chrome://tracing / Perfetto JSON or one row per scope.
+	bool exportChromeTrace(const std::string& path) const;
+	bool exportCSV(const std::string& path) const;
+
+	std::atomic<bool> showOverlay{ false };
+
+private:
+	Profiler();
+
+	static constexpr int MAX_THREADS = 4; // sim, render, gpu and a spare; anything past that is ignored
+	static constexpr int MAX_DEPTH = 32;
+	static constexpr uint64_t CAPACITY = 1 << 15; // events per thread, power of two
+	static constexpr uint64_t STATS_WINDOW = 4096; // newest events per thread that go into computeStats()
+
+	struct Ring {
+		const char* threadName = "thread";
+		ProfileEvent events[CAPACITY];
+		std::atomic<uint64_t> head{ 0 }; // total events written, only the owning thread moves it
+	};
+
+	// open scopes of the calling thread
+	struct ThreadState {
+		Ring* ring = nullptr;
+		bool registered = false;
+		const char* names[MAX_DEPTH];
+		int64_t starts[MAX_DEPTH];
+		int depth = 0;
+	};
+	static thread_local ThreadState s_thread;
+
+	Ring* ring();
+	void push(Ring& ring, const ProfileEvent& event);
+	// copies the newest count events of ring i, oldest first.
+	void copyEvents(int i, uint64_t count, std::vector<ProfileEvent>& out) const;
+
+	time_point<steady_clock> m_epoch;
+	std::unique_ptr<Ring> m_rings[MAX_THREADS]; // allocated up front so readers never race a new ring
+	std::atomic<int> m_numRings{ 0 };
+};
+
+class ProfileScope {
+
+public:
+	ProfileScope(const char* name) { Profiler::get().begin(name); }
+	~ProfileScope() { Profiler::get().end(); }
+	ProfileScope(ProfileScope const&) = delete;
+	void operator=(ProfileScope const&) = delete;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
@@ -1,5 +1,9 @@
 #include "RenderManager.h"
 
+#include <algorithm>
+#include <cstddef>
+#include <string>
+
 RenderManager::RenderManager(Window* window, std::vector<Camera*>* cameraList, Camera* menuCamera){
 
 	m_window = window;
@@ -13,30 +17,195 @@ RenderManager::RenderManager(Window* window, std::vector<Camera*>* cameraList, C
 	carShader = std::make_shared<ShaderProgram>("shaders/car.vert", "shaders/car.frag");
 	transparentShader = std::make_shared<ShaderProgram>("shaders/transparent.vert", "shaders/transparent.frag");
 	powerUpShader = std::make_shared<ShaderProgram>("shaders/powerUp.vert", "shaders/powerUp.frag");
+	staticShader = std::make_shared<ShaderProgram>("shaders/static.vert", "shaders/static.frag");
+	staticDepthShader = std::make_shared<ShaderProgram>("shaders/staticDepth.vert", "shaders/simpleDepth.frag");
 
 	Utils::instance().shader = defaultShader;
 
 	// Shadows start 
-	glGenFramebuffers(1, &depthMapFBO);
+	lightView = glm::lookAt(lightPos, glm::vec3(0.0f), glm::vec3(0.0, 1.0, 0.0));
+	lightSpaceMatrix = lightProjection * lightView;
+	setShadowQuality(GameManager::get().shadowQuality);
+	// end shadows
+
+	createUniformBlocks();
+
+	// instance transform seen by every non-instanced draw, see Mesh::drawInstanced
+	const glm::mat4 identity(1.0f);
+	for (unsigned int c = 0; c < 4; c++) glVertexAttrib4fv(Mesh::INSTANCE_LOCATION + c, &identity[c][0]);
+}
+
+void RenderManager::createUniformBlocks() {
+	glGenBuffers(1, &viewUBO);
+	glBindBuffer(GL_UNIFORM_BUFFER, viewUBO);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(ViewBlock), NULL, GL_DYNAMIC_DRAW);
+	glBindBufferBase(GL_UNIFORM_BUFFER, ShaderProgram::VIEW_BLOCK_BINDING, viewUBO);
+	setNumViews(1);
+
+	FrameBlock frame;
+	frame.lightSpaceMatrix = lightSpaceMatrix;
+	frame.lightPos = glm::vec4(lightPos, 1.0f);
+	glGenBuffers(1, &frameUBO);
+	glBindBuffer(GL_UNIFORM_BUFFER, frameUBO);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameBlock), &frame, GL_STATIC_DRAW);
+	glBindBufferBase(GL_UNIFORM_BUFFER, ShaderProgram::FRAME_BLOCK_BINDING, frameUBO);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+	// samplers never change unit, set them once instead of every pass
+	for (const std::shared_ptr<ShaderProgram>& shader : { defaultShader, carShader, transparentShader, powerUpShader, staticShader }) {
+		shader->use();
+		shader->setInt("shadowMap", 1);
+		shader->setInt("shadowCascades", 2);
+	}
+	staticShader->use();
+	staticShader->setInt("staticTextures", StaticBatch::TEXTURE_UNIT);
+	Utils::instance().shader->use();
+}
+
+void RenderManager::uploadViewBlock() {
+	Camera* camera = m_cameraList->at(m_currentViewportActive);
+	ViewData view;
+	view.V = camera->getViewMat();
+	view.P = camera->getPerspMat();
+	view.camPos = glm::vec4(camera->getPosition(), 1.0f);
+	for (int c = 0; c < MAX_CASCADES; c++) {
+		view.cascadeMatrices[c] = cascadeMatrices[c];
+		view.cascadeSplits[c] = cascadeSplits[c];
+	}
+	view.numCascades = m_numCascades;
+	m_viewFrustum = Frustum(view.P * view.V);
+
+	// levels of detail are picked by how big things are in this viewport
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	const float pixelsPerUnit = view.P[1][1] * viewport[3] * 0.5f;
+	LodSelector::get().setView(camera->getPosition(), pixelsPerUnit, m_currentViewportActive);
+
+	const int slot = viewSlot();
+	m_viewFrusta[slot] = m_viewFrustum;
+	m_viewPositions[slot] = camera->getPosition();
+	m_viewPixelsPerUnit[slot] = pixelsPerUnit;
+	glBindBuffer(GL_UNIFORM_BUFFER, viewUBO);
+	glBufferSubData(GL_UNIFORM_BUFFER, offsetof(ViewBlock, views) + slot * sizeof(ViewData), sizeof(ViewData), &view);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+int RenderManager::viewSlot() const {
+	return m_singlePassViews > 0 ? m_currentViewportActive : 0;
+}
+
+void RenderManager::setNumViews(int views) {
+	Utils::instance().numViews = views;
+	glBindBuffer(GL_UNIFORM_BUFFER, viewUBO);
+	glBufferSubData(GL_UNIFORM_BUFFER, offsetof(ViewBlock, numViews), sizeof(int), &views);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void RenderManager::createDepthTarget(unsigned int& fbo, unsigned int& texture) {
+	glGenFramebuffers(1, &fbo);
 	// create depth texture
-	glGenTextures(1, &depthMap);
-	glBindTexture(GL_TEXTURE_2D, depthMap);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, SHADOW_WIDTH, SHADOW_HEIGHT, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, SHADOW_WIDTH, SHADOW_HEIGHT, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
 	glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, borderColor);
 	// attach depth texture as FBO's depth buffer
-	glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthMap, 0);
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, texture, 0);
 	glDrawBuffer(GL_NONE);
 	glReadBuffer(GL_NONE);
 	glBindFramebuffer(GL_FRAMEBUFFER, 0);
-	// end shadows
+}
+
+void RenderManager::freeShadowTargets() {
+	glDeleteFramebuffers(1, &depthMapFBO);
+	glDeleteTextures(1, &depthMap);
+	glDeleteFramebuffers(1, &cascadeFBO);
+	glDeleteTextures(1, &cascadeArray);
+	depthMapFBO = depthMap = cascadeFBO = cascadeArray = 0;
+}
+
+void RenderManager::setShadowQuality(ShadowQuality quality) {
+	freeShadowTargets();
+	m_shadowQuality = quality;
+	m_staticShadowsDirty = true;
+	m_shadowCasterPoses.clear();
+
+	switch (quality) {
+	case ShadowQuality::eLEGACY:
+		m_numCascades = 0;
+		m_cascadeSize = m_cascadeQualitySize = 0;
+		createDepthTarget(depthMapFBO, depthMap);
+		return;
+	case ShadowQuality::eLOW:
+		m_numCascades = 3;
+		m_cascadeQualitySize = 1024;
+		break;
+	case ShadowQuality::eMEDIUM:
+		m_numCascades = 4;
+		m_cascadeQualitySize = 2048;
+		break;
+	case ShadowQuality::eHIGH:
+		m_numCascades = 4;
+		m_cascadeQualitySize = 4096;
+		break;
+	}
+	createCascadeTargets(m_cascadeViews);
+}
+
+void RenderManager::createCascadeTargets(int views) {
+	glDeleteFramebuffers(1, &cascadeFBO);
+	glDeleteTextures(1, &cascadeArray);
+	m_cascadeViews = views;
+	// several viewports split the screen, so each gets half the resolution: four take the memory of one
+	m_cascadeSize = views > 1 ? m_cascadeQualitySize / 2 : m_cascadeQualitySize;
+
+	glGenTextures(1, &cascadeArray);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, cascadeArray);
+	glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT24, m_cascadeSize, m_cascadeSize, m_numCascades * views, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+	glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, borderColor);
+
+	glGenFramebuffers(1, &cascadeFBO);
+	glBindFramebuffer(GL_FRAMEBUFFER, cascadeFBO);
+	glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, cascadeArray, 0, 0);
+	glDrawBuffer(GL_NONE);
+	glReadBuffer(GL_NONE);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+ShadowQuality RenderManager::getShadowQuality() const {
+	return m_shadowQuality;
+}
+
+int RenderManager::getNumCascades() const {
+	return m_numCascades;
+}
+
+int RenderManager::getShadowMapSize() const {
+	return m_numCascades > 0 ? m_cascadeSize : (int)SHADOW_WIDTH;
+}
+
+size_t RenderManager::getShadowMemory() const {
+	const size_t bytesPerTexel = 4; // 24 bit depth is padded to 32 by every driver we've seen
+	if (m_numCascades == 0) return (size_t)SHADOW_WIDTH * SHADOW_HEIGHT * bytesPerTexel;
+	return (size_t)m_numCascades * m_cascadeViews * m_cascadeSize * m_cascadeSize * bytesPerTexel;
 }
 
 void RenderManager::startFrame(){
+	m_lastCameraCull = m_cameraCull;
+	m_lastShadowCull = m_shadowCull;
+	m_cameraCull = CullStats();
+	m_shadowCull = CullStats();
+	m_lastQueueStats = m_queue.takeStats();
+	m_lastLodStats = LodSelector::get().takeStats();
+
 	glEnable(GL_CULL_FACE);
 	glCullFace(GL_FRONT);
 	glFrontFace(GL_CW);
@@ -52,64 +221,198 @@ void RenderManager::endFrame(){
 
 bool RenderManager::switchViewport(int playerNumber, int i) { // returns true only on first viewport - used to trigger the timer.
 	m_currentViewportActive = i;
+	m_playerNumber = playerNumber;
+	const glm::ivec4 rect = viewportRect(playerNumber, i);
+	glViewport(rect.x, rect.y, rect.z, rect.w);
+	return i == 0; //time.startRenderTimer(); RETURN TRUE to trigger timer
+}
+
+glm::ivec4 RenderManager::viewportRect(int playerNumber, int i) {
+	const int width = Utils::instance().SCREEN_WIDTH, height = Utils::instance().SCREEN_HEIGHT;
 	switch (i)
 	{
-	case 0:		
+	case 0:
 		switch (playerNumber) {
-		case 1: //Full screen
-			glViewport(0, 0, Utils::instance().SCREEN_WIDTH, Utils::instance().SCREEN_HEIGHT);
-			break;
 		case 2: //Left Screen
-			glViewport(0, 0, Utils::instance().SCREEN_WIDTH / 2, Utils::instance().SCREEN_HEIGHT);
-			break;
+			return glm::ivec4(0, 0, width / 2, height);
 		case 3: //Whole top part of the screen
-			glViewport(Utils::instance().SCREEN_WIDTH / 4, Utils::instance().SCREEN_HEIGHT / 2, Utils::instance().SCREEN_WIDTH /2, Utils::instance().SCREEN_HEIGHT / 2);
-			break;
+			return glm::ivec4(width / 4, height / 2, width / 2, height / 2);
 		case 4:	//Top left of the screen
-			glViewport(0, Utils::instance().SCREEN_HEIGHT / 2, Utils::instance().SCREEN_WIDTH / 2, Utils::instance().SCREEN_HEIGHT / 2);
-			break;
+			return glm::ivec4(0, height / 2, width / 2, height / 2);
 		}
-		return true; //time.startRenderTimer(); RETURN TRUE to trigger timer
-		break;
+		break; //Full screen
 	case 1:
 		switch (playerNumber) {
 		case 2: //Right screen
-
-			glViewport(Utils::instance().SCREEN_WIDTH / 2, 0, Utils::instance().SCREEN_WIDTH / 2, Utils::instance().SCREEN_HEIGHT);
-			break;
-		case 3: 			// Bottom left screen
-			glViewport(0, 0, Utils::instance().SCREEN_WIDTH / 2, Utils::instance().SCREEN_HEIGHT / 2);
-			break;
-		case 4://Top right of the screen
-			glViewport(Utils::instance().SCREEN_WIDTH / 2, Utils::instance().SCREEN_HEIGHT / 2, Utils::instance().SCREEN_WIDTH / 2, Utils::instance().SCREEN_HEIGHT / 2);
-			break;
+			return glm::ivec4(width / 2, 0, width / 2, height);
+		case 3: // Bottom left screen
+			return glm::ivec4(0, 0, width / 2, height / 2);
+		case 4: //Top right of the screen
+			return glm::ivec4(width / 2, height / 2, width / 2, height / 2);
 		}
 		break;
 	case 2:
 		switch (playerNumber) {
 		case 3: //Bottom right
-			glViewport(Utils::instance().SCREEN_WIDTH / 2, 0, Utils::instance().SCREEN_WIDTH / 2, Utils::instance().SCREEN_HEIGHT / 2);
-			break;
-		case 4:// Bottom left screen
-			glViewport(0, 0, Utils::instance().SCREEN_WIDTH / 2, Utils::instance().SCREEN_HEIGHT / 2);
-			break;
+			return glm::ivec4(width / 2, 0, width / 2, height / 2);
+		case 4: // Bottom left screen
+			return glm::ivec4(0, 0, width / 2, height / 2);
 		}
 		break;
-	case 3:
-		//Bottom right
-		glViewport(Utils::instance().SCREEN_WIDTH / 2, 0, Utils::instance().SCREEN_WIDTH / 2, Utils::instance().SCREEN_HEIGHT / 2);
-		break;
+	case 3: //Bottom right
+		return glm::ivec4(width / 2, 0, width / 2, height / 2);
 	}
+	return glm::ivec4(0, 0, width, height);
+}
 
+void RenderManager::setSplitScreenMode(SplitScreenMode mode) {
+	m_splitScreenMode = mode;
+}
 
+SplitScreenMode RenderManager::getSplitScreenMode() const {
+	return m_splitScreenMode;
+}
 
+bool RenderManager::singlePassSupported() {
+	return GLEW_ARB_viewport_array && (GLEW_ARB_shader_viewport_layer_array || GLEW_AMD_vertex_shader_viewport_index);
+}
 
-	
+bool RenderManager::prepareViewports(int playerNumber) {
+	const bool singlePass = m_splitScreenMode == SplitScreenMode::eSINGLE_PASS && playerNumber > 1 && playerNumber <= MAX_VIEWS && singlePassSupported();
+	m_singlePassViews = singlePass ? playerNumber : 0;
+	// the cascades of every viewport have to survive until the single pass
+	const int views = singlePass ? playerNumber : 1;
+	if (m_numCascades > 0 && views != m_cascadeViews) createCascadeTargets(views);
+	return singlePass;
+}
+
+void RenderManager::beginSinglePass() {
+	// instance v of every draw lands in viewport v (gl_ViewportIndex in the vertex shaders)
+	for (int v = 0; v < m_singlePassViews; v++) {
+		const glm::ivec4 rect = viewportRect(m_playerNumber, v);
+		glViewportIndexedf(v, (float)rect.x, (float)rect.y, (float)rect.z, (float)rect.w);
+	}
+	LodSelector::get().clearView();
+	for (int v = 0; v < m_singlePassViews; v++) LodSelector::get().addView(m_viewPositions[v], m_viewPixelsPerUnit[v], v);
+	setNumViews(m_singlePassViews);
+}
+
+void RenderManager::endSinglePass() {
+	setNumViews(1);
+	m_singlePassViews = 0;
+	restoreViewport(); // glViewport sets every viewport of the array again
+}
+
+void RenderManager::setStaticShadowCasters(const std::vector<Model*>& casters) {
+	m_staticShadowCasters = casters;
+	m_staticShadowsDirty = true;
+	std::vector<AABB> bounds;
+	for (Model* caster : casters) bounds.push_back(caster->getWorldBounds());
+	m_staticShadowBVH.build(bounds);
+	mapShadowCasters();
+}
+
+void RenderManager::setStaticObjects(const std::vector<Model*>& objects) {
+	m_staticObjects = objects;
+	std::vector<AABB> bounds;
+	for (Model* object : objects) bounds.push_back(object->getWorldBounds());
+	m_staticBVH.build(bounds);
+	m_staticBatch.build(objects);
+	m_staticShadowsDirty = true;
+	mapShadowCasters();
+}
+
+void RenderManager::mapShadowCasters() {
+	m_shadowCasterSlots.clear();
+	for (Model* caster : m_staticShadowCasters) {
+		const auto found = std::find(m_staticObjects.begin(), m_staticObjects.end(), caster);
+		const int slot = found == m_staticObjects.end() ? -1 : (int)(found - m_staticObjects.begin());
+		m_shadowCasterSlots.push_back(slot >= 0 && m_staticBatch.contains(slot) ? slot : -1);
+	}
+}
+
+void RenderManager::renderBatchedCasters(const glm::mat4& lightMatrix) {
+	if (!m_staticBatch.hasQueued()) return;
+	staticDepthShader->use();
+	staticDepthShader->setMat4("lightSpaceMatrix", lightMatrix);
+	m_staticBatch.flush(*staticDepthShader);
+	depthShader->use();
+}
+
+void RenderManager::queryStatic(const BVH& bvh, const Frustum& frustum, CullStats& stats) {
+	m_visible.clear();
+	bvh.query(frustum, m_visible);
+	std::sort(m_visible.begin(), m_visible.end());
+	stats.tested += bvh.getNumItems();
+	stats.culled += bvh.getNumItems() - (int)m_visible.size();
+}
+
+void RenderManager::queryViews(const BVH& bvh, CullStats& stats) {
+	if (m_singlePassViews == 0) {
+		queryStatic(bvh, m_viewFrustum, stats);
+		return;
+	}
+	m_visible.clear();
+	for (int v = 0; v < m_singlePassViews; v++) bvh.query(m_viewFrusta[v], m_visible);
+	std::sort(m_visible.begin(), m_visible.end());
+	m_visible.erase(std::unique(m_visible.begin(), m_visible.end()), m_visible.end());
+	stats.tested += bvh.getNumItems();
+	stats.culled += bvh.getNumItems() - (int)m_visible.size();
+}
+
+bool RenderManager::isInView(const AABB& bounds) const {
+	if (m_singlePassViews == 0) return m_viewFrustum.isVisible(bounds);
+	for (int v = 0; v < m_singlePassViews; v++) {
+		if (m_viewFrusta[v].isVisible(bounds)) return true;
+	}
 	return false;
 }
 
-void RenderManager::renderShadows(const std::vector<PVehicle*>& vehicleList, const std::vector<PowerUp*>& powerUps) {
+void RenderManager::renderStaticShadows(const Frustum& frustum) {
+	m_queue.begin();
+	queryStatic(m_staticShadowBVH, frustum, m_shadowCull);
+	for (int i : m_visible) {
+		if (m_shadowCasterSlots[i] >= 0) m_staticBatch.add(m_shadowCasterSlots[i], frustum);
+		else m_staticShadowCasters[i]->draw(frustum);
+	}
+	m_queue.flush();
+	renderBatchedCasters(lightSpaceMatrix);
+}
+
+glm::ivec4 RenderManager::shadowTexels(const AABB& box) const {
+	if (!box.valid()) return glm::ivec4(0);
+	AABB ndc;
+	for (int c = 0; c < 8; c++) {
+		const glm::vec3 corner((c & 1) ? box.max.x : box.min.x, (c & 2) ? box.max.y : box.min.y, (c & 4) ? box.max.z : box.min.z);
+		ndc.add(glm::vec3(lightSpaceMatrix * glm::vec4(corner, 1.0f))); // orthographic, w stays 1
+	}
+	// one texel of slack on every side for the rounding, then clamped to the map
+	const glm::ivec4 texels(
+		(int)glm::floor((ndc.min.x * 0.5f + 0.5f) * SHADOW_WIDTH) - 1, (int)glm::floor((ndc.min.y * 0.5f + 0.5f) * SHADOW_HEIGHT) - 1,
+		(int)glm::ceil((ndc.max.x * 0.5f + 0.5f) * SHADOW_WIDTH) + 1, (int)glm::ceil((ndc.max.y * 0.5f + 0.5f) * SHADOW_HEIGHT) + 1);
+	return glm::clamp(texels, glm::ivec4(0), glm::ivec4(SHADOW_WIDTH, SHADOW_HEIGHT, SHADOW_WIDTH, SHADOW_HEIGHT));
+}
 
+void RenderManager::renderShadows(const std::vector<PVehicle*>& vehicleList, const std::vector<VehicleSnapshot>& vehicles, const std::vector<PowerUp*>& powerUps, const std::vector<PowerUpSnapshot>& powerUpStates, float alpha) {
+	if (m_shadowQuality != ShadowQuality::eLEGACY) return; // renderCascades, per viewport
+	LodSelector::get().clearView(); // one map for every viewport, and most of it is kept between frames
+
+	// where every dynamic caster would be drawn this frame, inactive power-ups get a marker that never matches a pose.
+	std::vector<PxTransform> poses;
+	poses.reserve(vehicles.size() * (VehicleSnapshot::NUM_SHAPES + 1) + powerUpStates.size());
+	for (const VehicleSnapshot& vehicle : vehicles) {
+		poses.push_back(vehicle.getInterpolatedPose(alpha));
+		for (int i = 0; i < VehicleSnapshot::NUM_SHAPES; i++) poses.push_back(vehicle.shapeLocalPoses[i]);
+	}
+	for (const PowerUpSnapshot& powerUp : powerUpStates) {
+		poses.push_back(powerUp.active ? powerUp.getShapePose(alpha) : PxTransform(PxVec3(0.0f), PxQuat(0.0f, 0.0f, 0.0f, 0.0f)));
+	}
+	if (!m_staticShadowsDirty && poses == m_shadowCasterPoses) { // depthMap is still right
+		glCullFace(GL_BACK);
+		glFrontFace(GL_CCW);
+		return;
+	}
+	m_shadowCasterPoses.swap(poses);
 
 	glCullFace(GL_FRONT);
 	glFrontFace(GL_CCW);
@@ -117,39 +420,68 @@ void RenderManager::renderShadows(const std::vector<PVehicle*>& vehicleList, con
 	// 1. render depth of scene to texture (from light's perspective)
 	// --------------------------------------------------------------
 
-	lightView = glm::lookAt(lightPos, glm::vec3(0.0f), glm::vec3(0.0, 1.0, 0.0));
-	lightSpaceMatrix = lightProjection * lightView;
 	// render scene from light's point of view
 
 	Utils::instance().shader = depthShader;
 	Utils::instance().shader->use();
-	Utils::instance().shader->setInt("shadowMap", 1);
 	Utils::instance().shader->setMat4("lightSpaceMatrix", lightSpaceMatrix);
-	Utils::instance().shader->setVector4("lightColor", lightColor);
-	Utils::instance().shader->setVector3("lightPos", lightPos);
-	Utils::instance().shader->setVector3("camPos", m_cameraList->at(m_currentViewportActive)->getPosition());
 
 
 	glViewport(0, 0, SHADOW_WIDTH, SHADOW_HEIGHT);
+	glActiveTexture(GL_TEXTURE0);
 	glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
+
+	// only the texels the dynamic casters cover now or covered last time change, the static casters
+	// elsewhere stay in depthMap from the frames before
+	const auto merge = [](const glm::ivec4& a, const glm::ivec4& b) {
+		if (b.z <= b.x || b.w <= b.y) return a;
+		if (a.z <= a.x || a.w <= a.y) return b;
+		return glm::ivec4(glm::min(a.x, b.x), glm::min(a.y, b.y), glm::max(a.z, b.z), glm::max(a.w, b.w));
+	};
+	glm::ivec4 casterTexels(0);
+	for (size_t i = 0; i < vehicleList.size(); i++) casterTexels = merge(casterTexels, shadowTexels(vehicleList[i]->getRenderBounds(vehicles[i], alpha)));
+	for (size_t i = 0; i < powerUps.size(); i++) {
+		if (powerUpStates[i].active) casterTexels = merge(casterTexels, shadowTexels(powerUps[i]->getRenderBounds(powerUpStates[i], alpha)));
+	}
+	const glm::ivec4 region = m_staticShadowsDirty ? glm::ivec4(0, 0, SHADOW_WIDTH, SHADOW_HEIGHT) : merge(casterTexels, m_shadowCasterTexels);
+	m_shadowCasterTexels = casterTexels;
+	m_staticShadowsDirty = false;
+	if (region.z <= region.x || region.w <= region.y) { // nothing moving, nothing moved away
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		restoreViewport();
+		glCullFace(GL_BACK);
+		glFrontFace(GL_CCW);
+		return;
+	}
+
+	glEnable(GL_SCISSOR_TEST);
+	glScissor(region.x, region.y, region.z - region.x, region.w - region.y);
 	glClear(GL_DEPTH_BUFFER_BIT);
-	glActiveTexture(GL_TEXTURE0);
 
-	for (PVehicle* carPtr : vehicleList) {
-		carPtr->render();
+	// the light's box cropped to the region, so only the static casters that land in it are drawn again
+	const glm::vec2 ndcMin = glm::vec2(region.x / (float)SHADOW_WIDTH, region.y / (float)SHADOW_HEIGHT) * 2.0f - 1.0f;
+	const glm::vec2 ndcMax = glm::vec2(region.z / (float)SHADOW_WIDTH, region.w / (float)SHADOW_HEIGHT) * 2.0f - 1.0f;
+	const glm::mat4 crop = glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(-(ndcMin + ndcMax) / (ndcMax - ndcMin), 0.0f)), glm::vec3(2.0f / (ndcMax - ndcMin), 1.0f));
+	renderStaticShadows(Frustum(crop * lightSpaceMatrix));
+
+	m_queue.begin();
+	for (size_t i = 0; i < vehicleList.size(); i++) {
+		vehicleList[i]->render(vehicles[i], alpha);
 	}
 
-	for (PowerUp* powerUpPtr : powerUps) {
-		if (powerUpPtr->active) {
-			powerUpPtr->render();
+	for (size_t i = 0; i < powerUps.size(); i++) {
+		if (powerUpStates[i].active) {
+			powerUps[i]->render(powerUpStates[i], alpha);
 		}
 	}
+	m_queue.flush();
+	glDisable(GL_SCISSOR_TEST);
 
 
 	glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
 	// reset viewport
-	switchViewport(GameManager::get().playerNumber, m_currentViewportActive); // change back to the current viewport
+	restoreViewport(); // change back to the current viewport
 	//glViewport(0, 0, Utils::instance().SCREEN_WIDTH, Utils::instance().SCREEN_HEIGHT);
 	//glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
@@ -158,92 +490,189 @@ void RenderManager::renderShadows(const std::vector<PVehicle*>& vehicleList, con
 
 }
 
-void RenderManager::renderCars(const std::vector<PVehicle*>& vehicleList){
-	// Cars rendering
-	Utils::instance().shader = carShader;
+void RenderManager::fitCascades() {
+	// must match Camera::UpdateVP
+	const float cameraNear = 0.1f, cameraFar = 2000.0f;
+	// nothing in the arena is further than this from any camera that matters, the last cascade ends here
+	const float shadowDistance = 700.0f;
+	// how far behind a cascade casters can be, covers the top of the map from the lowest camera
+	const float casterRange = 500.0f;
+	// blend between uniform and logarithmic splits, higher is more resolution up close
+	const float splitLambda = 0.75f;
+
+	Camera* camera = m_cameraList->at(m_currentViewportActive);
+	const glm::mat4 inverseVP = glm::inverse(camera->getPerspMat() * camera->getViewMat());
+	glm::vec3 nearCorners[4], farCorners[4];
+	for (int i = 0; i < 4; i++) {
+		const float x = (i & 1) ? 1.0f : -1.0f, y = (i & 2) ? 1.0f : -1.0f;
+		const glm::vec4 nearCorner = inverseVP * glm::vec4(x, y, -1.0f, 1.0f);
+		const glm::vec4 farCorner = inverseVP * glm::vec4(x, y, 1.0f, 1.0f);
+		nearCorners[i] = glm::vec3(nearCorner) / nearCorner.w;
+		farCorners[i] = glm::vec3(farCorner) / farCorner.w;
+	}
+
+	const glm::vec3 lightDirection = glm::normalize(lightPos); // the light looks at the origin, see lightView
+	const glm::mat4 lightRotation = glm::lookAt(glm::vec3(0.0f), -lightDirection, glm::vec3(0.0f, 1.0f, 0.0f));
+	float splitNear = cameraNear;
+	for (int c = 0; c < m_numCascades; c++) {
+		const float ratio = (float)(c + 1) / m_numCascades;
+		const float splitUniform = cameraNear + (shadowDistance - cameraNear) * ratio;
+		const float splitLog = cameraNear * std::pow(shadowDistance / cameraNear, ratio);
+		const float splitFar = splitLambda * splitLog + (1.0f - splitLambda) * splitUniform;
+
+		// slice of the view frustum between the two splits, the corner rays are straight so lerping works
+		glm::vec3 corners[8];
+		glm::vec3 center(0.0f);
+		for (int i = 0; i < 4; i++) {
+			corners[i] = glm::mix(nearCorners[i], farCorners[i], (splitNear - cameraNear) / (cameraFar - cameraNear));
+			corners[i + 4] = glm::mix(nearCorners[i], farCorners[i], (splitFar - cameraNear) / (cameraFar - cameraNear));
+			center += corners[i] + corners[i + 4];
+		}
+		center /= 8.0f;
+
+		// bounding sphere instead of a tight box so the size doesn't change as the camera turns
+		float radius = 0.0f;
+		for (const glm::vec3& corner : corners) radius = std::max(radius, glm::length(corner - center));
+		radius = std::ceil(radius * 16.0f) / 16.0f;
+
+		// move the center in whole texels in light space, otherwise the edges crawl as the camera moves
+		const float texelSize = 2.0f * radius / m_cascadeSize;
+		glm::vec3 lightSpaceCenter = glm::vec3(lightRotation * glm::vec4(center, 1.0f));
+		lightSpaceCenter.x = std::floor(lightSpaceCenter.x / texelSize) * texelSize;
+		lightSpaceCenter.y = std::floor(lightSpaceCenter.y / texelSize) * texelSize;
+		center = glm::vec3(glm::inverse(lightRotation) * glm::vec4(lightSpaceCenter, 1.0f));
+
+		const glm::mat4 view = glm::lookAt(center + lightDirection * casterRange, center, glm::vec3(0.0f, 1.0f, 0.0f));
+		const glm::mat4 projection = glm::ortho(-radius, radius, -radius, radius, 0.1f, casterRange + radius);
+		cascadeMatrices[c] = projection * view;
+		cascadeSplits[c] = splitFar;
+		cascadeTexelDensity[c] = 1.0f / texelSize;
+		splitNear = splitFar;
+	}
+}
+
+void RenderManager::renderCascades(const std::vector<PVehicle*>& vehicleList, const std::vector<VehicleSnapshot>& vehicles, const std::vector<PowerUp*>& powerUps, const std::vector<PowerUpSnapshot>& powerUpStates, float alpha) {
+	if (m_numCascades > 0) fitCascades();
+	uploadViewBlock(); // the lit passes of this viewport read the camera and cascades from here
+	if (m_numCascades == 0) return; // eLEGACY, see renderShadows
+
+	glCullFace(GL_FRONT);
+	glFrontFace(GL_CCW);
+
+	Utils::instance().shader = depthShader;
 	Utils::instance().shader->use();
-	Utils::instance().shader->setInt("shadowMap", 1);
-	Utils::instance().shader->setMat4("lightSpaceMatrix", lightSpaceMatrix);
-	Utils::instance().shader->setVector4("lightColor", lightColor);
-	Utils::instance().shader->setVector3("lightPos", lightPos);
-	Utils::instance().shader->setVector3("camPos", m_cameraList->at(m_currentViewportActive)->getPosition());
-	m_cameraList->at(m_currentViewportActive)->sendMatricesToShader();
 
+	glViewport(0, 0, m_cascadeSize, m_cascadeSize);
+	glBindFramebuffer(GL_FRAMEBUFFER, cascadeFBO);
+	glActiveTexture(GL_TEXTURE0);
+	const int firstLayer = viewSlot() * m_numCascades;
+	for (int c = 0; c < m_numCascades; c++) {
+		glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, cascadeArray, 0, firstLayer + c);
+		glClear(GL_DEPTH_BUFFER_BIT);
+		Utils::instance().shader->setMat4("lightSpaceMatrix", cascadeMatrices[c]);
+
+		// nothing outside the cascade's box can land in it, there is no depth clamp
+		const Frustum frustum(cascadeMatrices[c]);
+		m_queue.begin();
+		queryStatic(m_staticShadowBVH, frustum, m_shadowCull);
+		for (int i : m_visible) {
+			if (m_shadowCasterSlots[i] >= 0) m_staticBatch.add(m_shadowCasterSlots[i], frustum, m_staticShadowCasters[i]->selectLod(m_staticShadowCasters[i]->getWorldBounds()));
+			else m_staticShadowCasters[i]->draw(frustum);
+		}
+		for (size_t i = 0; i < vehicleList.size(); i++) {
+			m_shadowCull.tested++;
+			if (frustum.isVisible(vehicleList[i]->getRenderBounds(vehicles[i], alpha))) vehicleList[i]->render(vehicles[i], alpha);
+			else m_shadowCull.culled++;
+		}
+		for (size_t i = 0; i < powerUps.size(); i++) {
+			if (!powerUpStates[i].active) continue;
+			m_shadowCull.tested++;
+			if (frustum.isVisible(powerUps[i]->getRenderBounds(powerUpStates[i], alpha))) powerUps[i]->render(powerUpStates[i], alpha);
+			else m_shadowCull.culled++;
+		}
+		m_queue.flush(); // before the next layer is attached
+		renderBatchedCasters(cascadeMatrices[c]);
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	restoreViewport();
+	glCullFace(GL_BACK);
+	glFrontFace(GL_CCW);
+}
+
+void RenderManager::bindShadowMaps() {
+	glActiveTexture(GL_TEXTURE2);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, cascadeArray);
 	glActiveTexture(GL_TEXTURE1);
 	glBindTexture(GL_TEXTURE_2D, depthMap);
+}
 
-	for (PVehicle* carPtr : vehicleList) {
-		Utils::instance().shader->setFloat("damage", carPtr->vehicleAttr.collisionCoefficient * 0.3); // number is how fast car turns red
-		Utils::instance().shader->setFloat("flashStrength", carPtr->vehicleParams.flashWhite);
-		carPtr->render();
+void RenderManager::restoreViewport() {
+	if (m_currentViewportActive > 3) glViewport(0, 0, Utils::instance().SCREEN_WIDTH, Utils::instance().SCREEN_HEIGHT); // menu camera
+	else switchViewport(m_playerNumber, m_currentViewportActive);
+}
+
+void RenderManager::renderCars(const std::vector<PVehicle*>& vehicleList, const std::vector<VehicleSnapshot>& vehicles, float alpha){
+	// Cars rendering
+	Utils::instance().shader = carShader;
+	Utils::instance().shader->use();
+	bindShadowMaps();
+
+	for (size_t i = 0; i < vehicleList.size(); i++) {
+		m_cameraCull.tested++;
+		if (!isInView(vehicleList[i]->getRenderBounds(vehicles[i], alpha))) {
+			m_cameraCull.culled++;
+			continue;
+		}
+		setDrawFloat("damage", vehicles[i].damage * 0.3); // number is how fast car turns red
+		setDrawFloat("flashStrength", vehicles[i].flashWhite);
+		vehicleList[i]->render(vehicles[i], alpha);
 	}
 }
 
 // only runs code to setup for rendering a 'normal object'. doesn't actually render anything itself to not pass around too many specific things
-void RenderManager::renderNormalObjects(std::vector<Model>& trees, std::vector<Model>& grassPatches) {
+void RenderManager::renderNormalObjects(Model& trees, Model& grassPatches) {
 	// Other rendering
 	Utils::instance().shader = defaultShader;
 	Utils::instance().shader->use();
-	Utils::instance().shader->setInt("shadowMap", 1);
-	Utils::instance().shader->setMat4("lightSpaceMatrix", lightSpaceMatrix);
-	Utils::instance().shader->setVector4("lightColor", lightColor);
-	Utils::instance().shader->setVector3("lightPos", lightPos);
-	Utils::instance().shader->setVector3("camPos", m_cameraList->at(m_currentViewportActive)->getPosition());
-	m_cameraList->at(m_currentViewportActive)->sendMatricesToShader();
-	glActiveTexture(GL_TEXTURE1);
-	glBindTexture(GL_TEXTURE_2D, depthMap);
+	bindShadowMaps();
 
-	for (Model& grass : grassPatches) grass.draw();
-	for (Model& tree : trees) tree.draw();
+	if (grassPatches.getInstanceCount() > 0) grassPatches.drawInstanced();
+	if (trees.getInstanceCount() > 0) trees.drawInstanced();
 }
 
-void RenderManager::generateLandscape(std::vector<Model>& trees, std::vector<Model>& grassPatches, Model& ground) {
-
+void RenderManager::generateLandscape(Model& trees, Model& grassPatches, const Model& ground) {
+	// one instance per picked ground vertex, drawn with a single call per mesh by renderNormalObjects
+	std::vector<glm::mat4> treeTransforms, grassTransforms;
 	int counter = 0;
-	Model tree = Model("models/tree/tree.obj");
 	for (const Mesh& mesh : ground.getMeshData()) {
 		for (const Vertex& vertex : mesh.m_vertices) {
-			if (counter % 750 == 0) {
-				const glm::vec3& position = vertex.Position;
-				Model tree_c = Model(tree);
-				tree_c.setPosition(glm::vec3(position.x, position.y, position.z));
-				tree_c.scale(glm::vec3(2.f));
-				trees.push_back(tree_c);
-			}
-			counter++;
-		}
-	}
-
-	counter = 0;
-	Model grass = Model("models/grass/grass.obj");
-	for (const Mesh& mesh : ground.getMeshData()) {
-		for (const Vertex& vertex : mesh.m_vertices) {
-			if (counter % 20 == 0) {
-				const glm::vec3& position = vertex.Position;
-				Model grass_c = Model(grass);
-				grass_c.setPosition(glm::vec3(position.x, position.y, position.z));
-				grass_c.scale(glm::vec3(1.75f));
-				grassPatches.push_back(grass_c);
-			}
+			const glm::mat4 T = glm::translate(glm::mat4(1.0f), vertex.Position);
+			if (counter % 750 == 0) treeTransforms.push_back(glm::scale(T, glm::vec3(2.f)));
+			if (counter % 20 == 0) grassTransforms.push_back(glm::scale(T, glm::vec3(1.75f)));
 			counter++;
 		}
 	}
 
+	trees = Model("models/tree/tree.obj");
+	trees.setInstances(treeTransforms);
+	grassPatches = Model("models/grass/grass.obj");
+	grassPatches.setInstances(grassTransforms);
+	Log::info("Landscape: {} trees, {} grass patches", treeTransforms.size(), grassTransforms.size());
 }
 
-void RenderManager::renderTransparentObjects(const std::vector<PVehicle*>& vehicleList, PStatic& sphere, double os, Time& time) {
+void RenderManager::renderTransparentObjects(const std::vector<PVehicle*>& vehicleList, const std::vector<VehicleSnapshot>& vehicles, PStatic& sphere, double os, Time& time, float alpha) {
 	// Sphere
 	Utils::instance().shader = transparentShader;
 	Utils::instance().shader->use();
 	Utils::instance().shader->setFloat("opacity", os);
-	Utils::instance().shader->setInt("shadowMap", 1);
-	Utils::instance().shader->setMat4("lightSpaceMatrix", lightSpaceMatrix);
-	Utils::instance().shader->setVector4("lightColor", lightColor);
-	Utils::instance().shader->setVector3("lightPos", lightPos);
-	Utils::instance().shader->setVector3("camPos", m_cameraList->at(m_currentViewportActive)->getPosition());
-	m_cameraList->at(m_currentViewportActive)->sendMatricesToShader();
-	for (PVehicle* carPtr : vehicleList) {
-		switch (carPtr->m_shieldState) {
+	// blended, so these and everything drawn after them in this pass keep their order, after the opaque draws
+	if (m_queue.isActive()) m_queue.setLayer(RenderQueue::Layer::eTRANSPARENT);
+	bindShadowMaps();
+	for (size_t i = 0; i < vehicleList.size(); i++) {
+		PVehicle* carPtr = vehicleList[i];
+		carPtr->m_shieldSphere.setPosition(Utils::instance().pxToGlmVec3(vehicles[i].getInterpolatedPose(alpha).p));
+		switch (vehicles[i].shieldState) {
 		case ShieldPowerUpState::eINACTIVE:
 			break;
 		case ShieldPowerUpState::eACTIVE:
@@ -264,31 +693,89 @@ void RenderManager::renderTransparentObjects(const std::vector<PVehicle*>& vehic
 
 }
 
-void RenderManager::renderPowerUps(const std::vector<PowerUp*>& powerUps, double os) {
+void RenderManager::renderPowerUps(const std::vector<PowerUp*>& powerUps, const std::vector<PowerUpSnapshot>& powerUpStates, double os, float alpha) {
 	// Power ups
 	Utils::instance().shader = powerUpShader;
 	Utils::instance().shader->use();
 	Utils::instance().shader->setFloat("os", os);
-	Utils::instance().shader->setMat4("lightSpaceMatrix", lightSpaceMatrix);
-	Utils::instance().shader->setMat4("lightSpaceMatrix", lightSpaceMatrix);
-	Utils::instance().shader->setVector4("lightColor", lightColor);
-	Utils::instance().shader->setVector3("lightPos", lightPos);
-	Utils::instance().shader->setVector3("camPos", m_cameraList->at(m_currentViewportActive)->getPosition());
-	m_cameraList->at(m_currentViewportActive)->sendMatricesToShader();
-
-	for (PowerUp* powerUpPtr : powerUps) {
-		if (powerUpPtr->active) {
-			powerUpPtr->render();
+	bindShadowMaps();
+
+	// one instanced draw per type, power ups of the same type share a model
+	std::vector<glm::mat4> transforms;
+	for (size_t i = 0; i < powerUps.size(); i++) {
+		const PowerUpType type = powerUps[i]->getType();
+		bool drawn = false;
+		for (size_t j = 0; j < i && !drawn; j++) drawn = powerUps[j]->getType() == type;
+		if (drawn) continue;
+
+		transforms.clear();
+		for (size_t j = i; j < powerUps.size(); j++) {
+			if (!powerUpStates[j].active || powerUps[j]->getType() != type) continue;
+			m_cameraCull.tested++;
+			if (isInView(powerUps[j]->getRenderBounds(powerUpStates[j], alpha))) transforms.push_back(powerUps[j]->getRenderTransform(powerUpStates[j], alpha));
+			else m_cameraCull.culled++;
 		}
+		if (!transforms.empty()) powerUps[i]->renderInstanced(transforms);
 	}
 }
 
+void RenderManager::renderStaticObjects(double os) {
+	queryViews(m_staticBVH, m_cameraCull);
+	// a single pass draws a model's meshes for every viewport that sees the model, the BVH was enough
+	const Frustum frustum = m_singlePassViews > 0 ? Frustum() : m_viewFrustum;
+	for (int i : m_visible) {
+		if (m_staticBatch.contains(i)) m_staticBatch.add(i, frustum, m_staticObjects[i]->selectLod(m_staticObjects[i]->getWorldBounds()));
+		else m_staticObjects[i]->draw(frustum); // left out of the batch, with the current shader
+	}
+	if (!m_staticBatch.hasQueued()) return;
+
+	staticShader->use();
+	staticShader->setFloat("opacity", os);
+	bindShadowMaps();
+	m_staticBatch.flush(*staticShader);
+	Utils::instance().shader->use();
+}
+
+void RenderManager::beginQueue() {
+	m_queue.begin();
+}
+
+void RenderManager::flushQueue() {
+	m_queue.flush();
+}
+
+void RenderManager::setPass(const char* name) {
+	m_queue.setPass(name);
+}
+
+void RenderManager::setGpuTimer(GpuTimer* timer) {
+	m_queue.setGpuTimer(timer);
+}
+
+void RenderManager::setDrawFloat(const std::string& name, float value) {
+	if (m_queue.isActive()) m_queue.setFloat(name, value);
+	else Utils::instance().shader->setFloat(name, value);
+}
+
 void RenderManager::useDefaultShader() {
 	Utils::instance().shader = defaultShader;
 	Utils::instance().shader->use();
-	Utils::instance().shader->setVector4("lightColor", lightColor);
-	Utils::instance().shader->setVector3("lightPos", lightPos);
-	Utils::instance().shader->setVector3("camPos", m_menuCamera->getPosition());
+}
+
+const CullStats& RenderManager::getCameraCullStats() const {
+	return m_lastCameraCull;
+}
+
+const CullStats& RenderManager::getShadowCullStats() const {
+	return m_lastShadowCull;
+}
+
+const RenderQueue::Stats& RenderManager::getQueueStats() const {
+	return m_lastQueueStats;
+}
+
+const LodSelector::Stats& RenderManager::getLodStats() const {
+	return m_lastLodStats;
 }
 
 
@@ -24,6 +24,17 @@
 #include "PowerUp.h"
 
 #include "Time.h"
+#include "SceneSnapshot.h"
+#include "BVH.h"
+#include "RenderQueue.h"
+#include "StaticBatch.h"
+#include "LodSelector.h"
+
+// how the viewports of a split-screen match are drawn, see RenderManager::prepareViewports
+enum class SplitScreenMode {
+	eLOOP,			// the whole scene once per viewport
+	eSINGLE_PASS	// every draw once, instanced into all viewports at the same time, where the driver can
+};
 
 class RenderManager {
 
@@ -36,21 +47,32 @@ public:
 	std::vector<Camera*> *m_cameraList;
 
 	int m_currentViewportActive; // for camera selection
+	int m_playerNumber = 1; // viewport layout from the last switchViewport()
 
 	std::shared_ptr<ShaderProgram> defaultShader, depthShader, carShader, transparentShader, powerUpShader;
+	std::shared_ptr<ShaderProgram> staticShader, staticDepthShader; // StaticBatch, looks like transparentShader/depthShader
 
 	Skybox skybox;
 
-	const glm::vec4 lightColor = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f);
 	const glm::vec3 lightPos = glm::vec3(300.0f, 400.0f, 0.0f);
 
 #pragma region shadow_init
 	// Shadows
+	// ShadowQuality::eLEGACY, everything else uses the cascades below
 	const unsigned int SHADOW_WIDTH = 2048 * 4, SHADOW_HEIGHT = 2048 * 4;
-	unsigned int depthMapFBO;
+	unsigned int depthMapFBO = 0;
 
 	// create depth texture
-	unsigned int depthMap;
+	unsigned int depthMap = 0;
+
+	// cascaded shadow maps: one layer per cascade, refit to the active camera by renderCascades(). a single
+	// pass needs every viewport's at once, those are one after another (see prepareViewports)
+	static constexpr int MAX_CASCADES = 4; // matches the cascade arrays in the shaders
+	unsigned int cascadeFBO = 0;
+	unsigned int cascadeArray = 0;
+	glm::mat4 cascadeMatrices[MAX_CASCADES];
+	float cascadeSplits[MAX_CASCADES] = {}; // far end of each cascade, view space depth
+	float cascadeTexelDensity[MAX_CASCADES] = {}; // texels per world unit
 
 	float borderColor[4] = { 1.0, 1.0, 1.0, 1.0 };
 
@@ -61,22 +83,169 @@ public:
 
 #pragma endregion
 
+	// uniform blocks shared by every lit shader, std140 so these must match the blocks in the shaders exactly.
+	// camera and cascades, uploaded by renderCascades() once per viewport
+	struct ViewData {
+		glm::mat4 V;
+		glm::mat4 P;
+		glm::vec4 camPos; // w unused
+		glm::mat4 cascadeMatrices[MAX_CASCADES];
+		glm::vec4 cascadeSplits;
+		int numCascades;
+		int pad[3];
+	};
+	static constexpr int MAX_VIEWS = 4; // views[] in the shaders
+	// a single pass reads every viewport's, otherwise everything is drawn from views[0]
+	struct ViewBlock {
+		ViewData views[MAX_VIEWS];
+		int numViews;
+		int pad[3];
+	};
+	// the light, never changes so it is uploaded once
+	struct FrameBlock {
+		glm::mat4 lightSpaceMatrix;
+		glm::vec4 lightPos; // w unused
+	};
+	unsigned int viewUBO = 0, frameUBO = 0;
+
 	void startFrame();
 	void endFrame();
 	bool switchViewport(int playerNumber, int i);
-	void renderShadows(const std::vector<PVehicle*>& vehicleList, const std::vector<PowerUp*>& powerUps);
-
-	void renderCars(const std::vector<PVehicle*>& vehicleList);
-
-	void renderNormalObjects(std::vector<Model>& trees, std::vector<Model>& grassPatches);
-	void generateLandscape(std::vector<Model>& trees, std::vector<Model>& grassPatches, Model& ground);
-
-	void renderTransparentObjects(const std::vector<PVehicle*>& vehicleList, PStatic& sphere, double os, Time& time);
-
-	void renderPowerUps(const std::vector<PowerUp*>& powerUps, double os);
+	// where viewport i of playerNumber is on the screen, x, y, width, height
+	static glm::ivec4 viewportRect(int playerNumber, int i);
+
+	void setSplitScreenMode(SplitScreenMode mode);
+	SplitScreenMode getSplitScreenMode() const;
+	// viewport arrays, and gl_ViewportIndex in the vertex shader
+	static bool singlePassSupported();
+	// once a frame before the viewports: true when this frame draws them in one pass, with eSINGLE_PASS, more
+	// than one player and the driver support. then every viewport still gets switchViewport and renderCascades,
+	// and the scene is drawn once between beginSinglePass and endSinglePass. otherwise the usual loop.
+	bool prepareViewports(int playerNumber);
+	// the scene draws in between are instanced once per viewport, each instance into its own viewport with
+	// its own camera, cascades, culling and level of detail
+	void beginSinglePass();
+	void endSinglePass();
+	// frees and reallocates the shadow targets, render thread only.
+	void setShadowQuality(ShadowQuality quality);
+	ShadowQuality getShadowQuality() const;
+	int getNumCascades() const; // 0 for eLEGACY
+	int getShadowMapSize() const;
+	size_t getShadowMemory() const; // bytes of depth texture allocated for the current quality and viewports
+
+	// static geometry baked into the cached depth layer, redrawn only after this is called again.
+	// the cascades cull these against each cascade through a BVH.
+	void setStaticShadowCasters(const std::vector<Model*>& casters);
+	// props that never move, drawn by renderStaticObjects(). their BVH and the StaticBatch holding their
+	// meshes are built here from where they are now. casters that are among them are drawn from the batch too.
+	void setStaticObjects(const std::vector<Model*>& objects);
+	// eLEGACY only, once per frame before the viewports: the light doesn't depend on the camera. skipped
+	// entirely when no dynamic caster moved since the last call.
+	// vehicleList/powerUps only provide the models, transforms and state come from the matching snapshot entries.
+	// alpha blends between the last two simulation steps (see SceneSnapshot::getInterpolationAlpha)
+	void renderShadows(const std::vector<PVehicle*>& vehicleList, const std::vector<VehicleSnapshot>& vehicles, const std::vector<PowerUp*>& powerUps, const std::vector<PowerUpSnapshot>& powerUpStates, float alpha);
+
+	// once per viewport after its camera moved, whatever the quality: uploads the camera to the view block and,
+	// with cascades, fits every cascade to the camera's frustum and redraws them (they follow the camera, so
+	// there is nothing to cache across frames).
+	void renderCascades(const std::vector<PVehicle*>& vehicleList, const std::vector<VehicleSnapshot>& vehicles, const std::vector<PowerUp*>& powerUps, const std::vector<PowerUpSnapshot>& powerUpStates, float alpha);
+
+	void renderCars(const std::vector<PVehicle*>& vehicleList, const std::vector<VehicleSnapshot>& vehicles, float alpha);
+
+	void renderNormalObjects(Model& trees, Model& grassPatches);
+	// loads the tree and grass models and scatters instances of them over the ground's vertices
+	void generateLandscape(Model& trees, Model& grassPatches, const Model& ground);
+
+	void renderTransparentObjects(const std::vector<PVehicle*>& vehicleList, const std::vector<VehicleSnapshot>& vehicles, PStatic& sphere, double os, Time& time, float alpha);
+
+	void renderPowerUps(const std::vector<PowerUp*>& powerUps, const std::vector<PowerUpSnapshot>& powerUpStates, double os, float alpha);
+
+	// the static objects the current viewport's camera (any viewport's in a single pass) can see, one multi-draw
+	// per vertex layout through the StaticBatch, lit like transparentShader with opacity os. draws right away,
+	// so after flushQueue().
+	void renderStaticObjects(double os);
 
 	void useDefaultShader();
 
-private:
+	// mesh draws between these two are sorted by state and issued together (see RenderQueue). nothing
+	// that changes the view block, framebuffer or viewport may run in between.
+	void beginQueue();
+	void flushQueue();
+	// the GPU scope the queued draws from here on are timed under, see RenderQueue::setPass
+	void setPass(const char* name);
+	// times the passes of every queue flush, null for none. render thread only
+	void setGpuTimer(GpuTimer* timer);
+
+	// objects tested and culled over the last whole frame, against the cameras and against the shadow cascades
+	const CullStats& getCameraCullStats() const;
+	const CullStats& getShadowCullStats() const;
+	// draws and state changes of the last whole frame's queues
+	const RenderQueue::Stats& getQueueStats() const;
+	// triangles the last whole frame drew, against the same draws at full detail
+	const LodSelector::Stats& getLodStats() const;
 
+private:
+	void createDepthTarget(unsigned int& fbo, unsigned int& texture);
+	// the cascade array with room for views viewports, freeing the old one
+	void createCascadeTargets(int views);
+	void freeShadowTargets();
+	// the static casters inside frustum, into whatever depth target is bound
+	void renderStaticShadows(const Frustum& frustum);
+	// the depthMap texels box covers from the light, x0 y0 x1 y1 (empty when x1 <= x0)
+	glm::ivec4 shadowTexels(const AABB& box) const;
+	void fitCascades();
+	void createUniformBlocks();
+	void uploadViewBlock();
+	// where the current viewport's camera and cascades go: its own in a single pass, the first otherwise
+	int viewSlot() const;
+	void setNumViews(int views);
+	// shadow map textures for the lit passes, the sampler units are set once per program
+	void bindShadowMaps();
+	void restoreViewport();
+	// static casters added to m_staticBatch, in one go with staticDepthShader. depthShader is back in use after.
+	void renderBatchedCasters(const glm::mat4& lightMatrix);
+	// for every static caster, its index among the static objects or -1
+	void mapShadowCasters();
+
+	ShadowQuality m_shadowQuality = ShadowQuality::eLEGACY;
+	int m_numCascades = 0;
+	int m_cascadeSize = 0; // per layer, smaller than the quality's when several viewports share the array
+	int m_cascadeQualitySize = 0;
+	int m_cascadeViews = 1; // viewports cascadeArray has layers for
+
+	SplitScreenMode m_splitScreenMode = SplitScreenMode::eLOOP;
+	int m_singlePassViews = 0; // viewports of this frame's single pass, 0 in the loop
+	// every viewport's camera, for the single pass
+	Frustum m_viewFrusta[MAX_VIEWS];
+	glm::vec3 m_viewPositions[MAX_VIEWS];
+	float m_viewPixelsPerUnit[MAX_VIEWS] = {};
+
+	std::vector<Model*> m_staticShadowCasters;
+	BVH m_staticShadowBVH;
+	bool m_staticShadowsDirty = true;
+	std::vector<PxTransform> m_shadowCasterPoses; // what is in depthMap right now
+	glm::ivec4 m_shadowCasterTexels = glm::ivec4(0); // where those are drawn, cleared and redrawn when they move
+
+	// culling
+	std::vector<Model*> m_staticObjects;
+	BVH m_staticBVH;
+	Frustum m_viewFrustum; // the current viewport's camera, set with the view block
+	// against the current viewport, or any viewport of the single pass
+	bool isInView(const AABB& bounds) const;
+	std::vector<int> m_visible; // BVH query results, kept to reuse the allocation
+	StaticBatch m_staticBatch; // m_staticObjects
+	std::vector<int> m_shadowCasterSlots; // see mapShadowCasters
+	CullStats m_cameraCull, m_shadowCull; // this frame so far
+	CullStats m_lastCameraCull, m_lastShadowCull;
+
+	// the models of bvh that the frustum touches, back in the order of models
+	void queryStatic(const BVH& bvh, const Frustum& frustum, CullStats& stats);
+	// the same against the current viewport, or what any viewport of the single pass sees
+	void queryViews(const BVH& bvh, CullStats& stats);
+
+	RenderQueue m_queue;
+	RenderQueue::Stats m_lastQueueStats;
+	LodSelector::Stats m_lastLodStats;
+	// a float of the current shader for the next draws, through the queue while there is one
+	void setDrawFloat(const std::string& name, float value);
 };
\ No newline at end of file
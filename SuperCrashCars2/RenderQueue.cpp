@@ -0,0 +1,228 @@
+#include "RenderQueue.h"
+
+#include "GpuTimer.h"
+#include "Mesh.h"
+#include "Utils.h"
+
+#include <algorithm>
+#include <cstring>
+
+void RenderQueue::begin() {
+	this->m_active = true;
+	this->m_layer = Layer::eOPAQUE;
+	this->m_passes.clear();
+	this->m_pass = -1;
+	this->m_uniformProgram = nullptr;
+	this->m_firstUniform = this->m_numUniforms = 0;
+	Utils::instance().queue = this;
+}
+
+bool RenderQueue::isActive() const {
+	return this->m_active;
+}
+
+void RenderQueue::setLayer(Layer layer) {
+	this->m_layer = layer;
+}
+
+void RenderQueue::setPass(const char* name) {
+	const auto found = std::find(this->m_passes.begin(), this->m_passes.end(), name);
+	if (found != this->m_passes.end()) this->m_pass = (int)(found - this->m_passes.begin());
+	else if ((int)this->m_passes.size() < MAX_PASSES) {
+		this->m_pass = (int)this->m_passes.size();
+		this->m_passes.push_back(name);
+	}
+	// past MAX_PASSES the draws stay in the last pass
+}
+
+void RenderQueue::setGpuTimer(GpuTimer* timer) {
+	this->m_gpuTimer = timer;
+}
+
+void RenderQueue::setFloat(const std::string& name, float value) {
+	const ShaderProgram* program = Utils::instance().shader.get();
+	if (program != this->m_uniformProgram) {
+		this->m_uniformProgram = program;
+		this->m_numUniforms = 0;
+	}
+	// copy on write, items already submitted keep pointing at the old set
+	const GLint location = program->getUniformLocation(name);
+	const int first = (int)this->m_uniforms.size();
+	bool replaced = false;
+	for (int i = 0; i < this->m_numUniforms; i++) {
+		Uniform uniform = this->m_uniforms[this->m_firstUniform + i];
+		if (uniform.location == location) {
+			uniform.value = value;
+			replaced = true;
+		}
+		this->m_uniforms.push_back(uniform);
+	}
+	if (!replaced) this->m_uniforms.push_back({ location, value });
+	this->m_firstUniform = first;
+	this->m_numUniforms = (int)this->m_uniforms.size() - first;
+}
+
+void RenderQueue::submit(Mesh& mesh, const glm::mat4& TM, int renderMode, int lod, unsigned int instanceVBO, int instanceCount) {
+	const ShaderProgram* program = Utils::instance().shader.get();
+	if (program != this->m_uniformProgram) {
+		this->m_uniformProgram = program;
+		this->m_numUniforms = 0;
+	}
+
+	Item item;
+	item.program = program;
+	item.mesh = &mesh;
+	item.TM = TM;
+	item.renderMode = renderMode;
+	item.firstIndex = mesh.getLod(lod).firstIndex;
+	item.count = mesh.getLod(lod).count;
+	item.instanceVBO = instanceVBO;
+	item.instanceCount = instanceCount;
+	item.textures = !mesh.m_samplerNames.empty() && program->getUniformLocation(mesh.m_samplerNames[0]) >= 0;
+	item.firstUniform = this->m_firstUniform;
+	item.numUniforms = this->m_numUniforms;
+	item.pass = this->m_pass;
+
+	const uint32_t sequence = (uint32_t)this->m_items.size();
+	this->m_order.emplace_back(this->sortKey(item, sequence), sequence);
+	this->m_items.push_back(item);
+}
+
+// opaque: layer 0 | pass 3 bits | program 12 | first texture 16 | VAO 16 | submission order 16
+// transparent: layer 1 | submission order
+uint64_t RenderQueue::sortKey(const Item& item, uint32_t sequence) const {
+	if (this->m_layer == Layer::eTRANSPARENT) return (1ull << 63) | sequence;
+	const uint64_t pass = (uint64_t)(item.pass + 1);
+	const uint64_t program = (GLuint)*item.program & 0xfff;
+	const uint64_t texture = item.textures ? item.mesh->m_textures[0].id & 0xffff : 0;
+	const uint64_t VAO = (item.instanceCount > 0 ? 0x8000 : 0) | (item.mesh->VAO & 0x7fff);
+	return (pass << 60) | (program << 48) | (texture << 32) | (VAO << 16) | (sequence & 0xffff);
+}
+
+void RenderQueue::flush() {
+	this->m_active = false;
+	if (Utils::instance().queue == this) Utils::instance().queue = nullptr;
+
+	std::sort(this->m_order.begin(), this->m_order.end());
+	// nothing is known about the state other code left behind
+	this->m_cache = StateCache();
+	// a GPU scope for every run of the same pass, in sorted order
+	int pass = -1;
+	for (const std::pair<uint64_t, uint32_t>& entry : this->m_order) {
+		const Item& item = this->m_items[entry.second];
+		if (this->m_gpuTimer && item.pass != pass) {
+			if (pass >= 0) this->m_gpuTimer->end();
+			if (item.pass >= 0) this->m_gpuTimer->begin(this->m_passes[item.pass]);
+			pass = item.pass;
+		}
+		this->apply(item);
+	}
+	if (this->m_gpuTimer && pass >= 0) this->m_gpuTimer->end();
+
+	if (!this->m_items.empty()) {
+		glBindVertexArray(0);
+		glActiveTexture(GL_TEXTURE0);
+		// the code after the pass expects its own shader to be in use
+		if (Utils::instance().shader) Utils::instance().shader->use();
+	}
+	this->m_items.clear();
+	this->m_order.clear();
+	this->m_uniforms.clear();
+	this->m_uniformProgram = nullptr;
+	this->m_firstUniform = this->m_numUniforms = 0;
+}
+
+void RenderQueue::apply(const Item& item) {
+	StateCache& cache = this->m_cache;
+	const GLuint program = *item.program;
+	if (cache.program != program) {
+		glUseProgram(program);
+		cache.program = program;
+		cache.lastTM = nullptr;
+		this->m_stats.stateChanges++;
+	} else this->m_stats.redundant++;
+
+	for (int i = 0; i < item.numUniforms; i++) {
+		const Uniform& uniform = this->m_uniforms[item.firstUniform + i];
+		this->setUniform(program, uniform.location, uniform.value);
+	}
+
+	Mesh& mesh = *item.mesh;
+	if (item.textures) {
+		for (unsigned int i = 0; i < mesh.m_textures.size() && i < 16; i++) {
+			this->setSampler(program, item.program->getUniformLocation(mesh.m_samplerNames[i]), i);
+			this->bindTexture(i, mesh.m_textures[i].id);
+		}
+	}
+
+	const GLuint VAO = item.instanceCount > 0 ? mesh.instanceVAO(item.instanceVBO) : mesh.VAO;
+	if (cache.VAO != VAO) {
+		glBindVertexArray(VAO);
+		cache.VAO = VAO;
+		this->m_stats.stateChanges++;
+	} else this->m_stats.redundant++;
+
+	if (cache.lastTM == nullptr || std::memcmp(&cache.lastTM->TM, &item.TM, sizeof(glm::mat4)) != 0) {
+		glUniformMatrix4fv(item.program->getModelLocation(), 1, GL_FALSE, &item.TM[0][0]);
+		this->m_stats.stateChanges++;
+	} else this->m_stats.redundant++;
+	cache.lastTM = &item;
+
+	if (cache.polygonMode != item.renderMode) {
+		glPolygonMode(GL_FRONT_AND_BACK, item.renderMode);
+		cache.polygonMode = item.renderMode;
+		this->m_stats.stateChanges++;
+	} else this->m_stats.redundant++;
+
+	const void* offset = (const void*)(item.firstIndex * sizeof(unsigned int));
+	// once per view on top, see Utils::numViews
+	const int views = Utils::instance().numViews;
+	glDrawElementsInstanced(GL_TRIANGLES, item.count, GL_UNSIGNED_INT, offset, item.instanceCount > 0 ? item.instanceCount * views : views);
+	this->m_stats.draws++;
+}
+
+void RenderQueue::setUniform(GLuint program, GLint location, float value) {
+	if (location < 0) return;
+	const uint64_t key = ((uint64_t)program << 32) | (uint32_t)location;
+	auto cached = this->m_cache.floats.find(key);
+	if (cached != this->m_cache.floats.end() && cached->second == value) {
+		this->m_stats.redundant++;
+		return;
+	}
+	glUniform1f(location, value);
+	this->m_cache.floats[key] = value;
+	this->m_stats.stateChanges++;
+}
+
+void RenderQueue::setSampler(GLuint program, GLint location, int unit) {
+	if (location < 0) return;
+	const uint64_t key = ((uint64_t)program << 32) | (uint32_t)location;
+	auto cached = this->m_cache.ints.find(key);
+	if (cached != this->m_cache.ints.end() && cached->second == unit) {
+		this->m_stats.redundant++;
+		return;
+	}
+	glUniform1i(location, unit);
+	this->m_cache.ints[key] = unit;
+	this->m_stats.stateChanges++;
+}
+
+void RenderQueue::bindTexture(unsigned int unit, GLuint texture) {
+	if (this->m_cache.textures[unit] == texture) {
+		this->m_stats.redundant++;
+		return;
+	}
+	if (this->m_cache.activeTexture != GL_TEXTURE0 + unit) {
+		glActiveTexture(GL_TEXTURE0 + unit);
+		this->m_cache.activeTexture = GL_TEXTURE0 + unit;
+	}
+	glBindTexture(GL_TEXTURE_2D, texture);
+	this->m_cache.textures[unit] = texture;
+	this->m_stats.stateChanges++;
+}
+
+RenderQueue::Stats RenderQueue::takeStats() {
+	const Stats stats = this->m_stats;
+	this->m_stats = Stats();
+	return stats;
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <GL/glew.h>
+#include "glm/glm.hpp"
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ShaderProgram.h"
+
+class GpuTimer;
+class Mesh;
+
+// Collects the mesh draws of a pass and issues them sorted by program, textures and VAO, skipping
+// every bind, uniform and polygon mode change that would not change anything.
+// While a queue is begun it is Utils::instance().queue, and Mesh::draw/drawInstanced submit to it
+// with whatever Utils::instance().shader is at that point, so the existing render code feeds it
+// unchanged. Anything else a pass sets (uniforms of the whole pass, the framebuffer, the view block)
+// has to stay put until flush().
+// Transparent draws go after the opaque ones in the order they were submitted.
+// Opaque draws are grouped by pass first, so each pass can be timed on the GPU as a whole.
+class RenderQueue {
+
+public:
+	enum class Layer { eOPAQUE, eTRANSPARENT };
+
+	// GL calls over the flushes since the last takeStats()
+	struct Stats {
+		int draws = 0;
+		int stateChanges = 0; // program, texture, VAO, uniform and polygon mode changes issued
+		int redundant = 0; // the ones the state cache skipped
+	};
+
+	void begin();
+	// sorts and draws everything submitted since begin(), then stops collecting
+	void flush();
+	bool isActive() const;
+
+	// layer of the draws submitted from now on, reset to eOPAQUE by begin()
+	void setLayer(Layer layer);
+	// GPU scope the draws submitted from now on are timed under, none after begin(). name must outlive the
+	// flush, a string literal like GPU_SCOPE's
+	void setPass(const char* name);
+	// times every pass of a flush with timer, null (the default) times nothing
+	void setGpuTimer(GpuTimer* timer);
+	// a float uniform of the current shader for the draws submitted after this, until the shader changes.
+	// what would otherwise be a setFloat right before a draw, e.g. a car's damage
+	void setFloat(const std::string& name, float value);
+
+	// called by Mesh
+	void submit(Mesh& mesh, const glm::mat4& TM, int renderMode, int lod, unsigned int instanceVBO = 0, int instanceCount = 0);
+
+	Stats takeStats();
+
+private:
+	struct Uniform {
+		GLint location;
+		float value;
+	};
+
+	struct Item {
+		const ShaderProgram* program;
+		Mesh* mesh;
+		glm::mat4 TM;
+		int renderMode;
+		unsigned int firstIndex; // the level of detail's range
+		unsigned int count;
+		unsigned int instanceVBO;
+		int instanceCount;
+		bool textures; // false when the program samples none of the mesh's textures, e.g. depth only
+		int pass; // into m_passes, -1 for none
+		int firstUniform;
+		int numUniforms;
+	};
+
+	// what GL was last told during this flush, 0/-1 for unknown
+	struct StateCache {
+		StateCache() { for (GLuint& texture : textures) texture = UNKNOWN; }
+		static constexpr GLuint UNKNOWN = ~0u;
+
+		GLuint program = 0;
+		GLuint VAO = 0;
+		GLenum activeTexture = 0;
+		GLuint textures[16];
+		int polygonMode = -1;
+		const Item* lastTM = nullptr; // the item whose TM was uploaded last, to the same program
+		std::unordered_map<uint64_t, float> floats; // by program << 32 | location
+		std::unordered_map<uint64_t, int> ints;
+	};
+
+	uint64_t sortKey(const Item& item, uint32_t sequence) const;
+	void apply(const Item& item);
+	void setUniform(GLuint program, GLint location, float value);
+	void setSampler(GLuint program, GLint location, int unit);
+	void bindTexture(unsigned int unit, GLuint texture);
+
+	static constexpr int MAX_PASSES = 7; // per flush, 3 bits of the sort key with none
+
+	bool m_active = false;
+	Layer m_layer = Layer::eOPAQUE;
+	std::vector<const char*> m_passes; // names given to setPass since begin()
+	int m_pass = -1;
+	GpuTimer* m_gpuTimer = nullptr;
+	std::vector<Item> m_items;
+	std::vector<std::pair<uint64_t, uint32_t>> m_order; // sort key, item
+	std::vector<Uniform> m_uniforms; // the sets of per-draw uniforms items point into
+	const ShaderProgram* m_uniformProgram = nullptr; // the program the current set belongs to
+	int m_firstUniform = 0;
+	int m_numUniforms = 0;
+
+	StateCache m_cache;
+	Stats m_stats;
+};
@@ -0,0 +1,238 @@
+#include "Replay.h"
+
+#include "PVehicle.h"
+#include "Log.h"
+
+#include <cstring>
+#include <fstream>
+
+Replay::Replay() {}
+
+void Replay::record() {
+	this->m_mode = Mode::eRECORDING;
+	this->m_data.clear();
+	this->m_numSyncs = 0;
+}
+
+bool Replay::load(const std::string& path) {
+	std::ifstream file(path, std::ios::binary);
+	if (!file) {
+		Log::error("Could not open replay {}", path);
+		return false;
+	}
+
+	uint32_t magic = 0;
+	uint16_t version = 0;
+	uint32_t seed = 0;
+	uint8_t playerNumber = 0;
+	uint8_t singlePlayer = 0;
+	uint32_t numSyncs = 0;
+	int32_t recordedWinner = -1;
+	uint32_t recordedTicks = 0;
+	uint32_t size = 0;
+	file.read((char*)&magic, sizeof(magic));
+	file.read((char*)&version, sizeof(version));
+	if (!file || magic != MAGIC || version != VERSION) {
+		Log::error("{} is not a replay this build can play", path);
+		return false;
+	}
+	file.read((char*)&seed, sizeof(seed));
+	file.read((char*)&playerNumber, sizeof(playerNumber));
+	file.read((char*)&singlePlayer, sizeof(singlePlayer));
+	file.read((char*)&numSyncs, sizeof(numSyncs));
+	file.read((char*)&recordedWinner, sizeof(recordedWinner));
+	file.read((char*)&recordedTicks, sizeof(recordedTicks));
+	file.read((char*)&size, sizeof(size));
+
+	this->m_data.resize(size);
+	file.read((char*)this->m_data.data(), size);
+	if (!file) {
+		Log::error("Replay {} is truncated", path);
+		return false;
+	}
+
+	this->m_seed = seed;
+	this->m_playerNumber = playerNumber;
+	this->m_singlePlayer = singlePlayer != 0;
+	this->m_numSyncs = numSyncs;
+	this->m_recordedWinner = recordedWinner;
+	this->m_recordedTicks = recordedTicks;
+	this->m_mode = Mode::ePLAYING;
+	this->rewind();
+	Log::info("Loaded replay {} ({} bytes, seed {})", path, size, seed);
+	return true;
+}
+
+bool Replay::save(const std::string& path) const {
+	std::ofstream file(path, std::ios::binary);
+	if (!file) {
+		Log::error("Could not write replay {}", path);
+		return false;
+	}
+
+	const uint32_t magic = MAGIC;
+	const uint16_t version = VERSION;
+	const uint32_t seed = this->m_seed;
+	const uint8_t playerNumber = (uint8_t)this->m_playerNumber;
+	const uint8_t singlePlayer = this->m_singlePlayer;
+	const uint32_t numSyncs = this->m_numSyncs;
+	const int32_t recordedWinner = this->m_recordedWinner;
+	const uint32_t recordedTicks = this->m_recordedTicks;
+	const uint32_t size = (uint32_t)this->m_data.size();
+	file.write((const char*)&magic, sizeof(magic));
+	file.write((const char*)&version, sizeof(version));
+	file.write((const char*)&seed, sizeof(seed));
+	file.write((const char*)&playerNumber, sizeof(playerNumber));
+	file.write((const char*)&singlePlayer, sizeof(singlePlayer));
+	file.write((const char*)&numSyncs, sizeof(numSyncs));
+	file.write((const char*)&recordedWinner, sizeof(recordedWinner));
+	file.write((const char*)&recordedTicks, sizeof(recordedTicks));
+	file.write((const char*)&size, sizeof(size));
+	file.write((const char*)this->m_data.data(), size);
+
+	Log::info("Saved replay {} ({} bytes)", path, size);
+	return (bool)file;
+}
+
+void Replay::stop() {
+	this->m_mode = Mode::eOFF;
+}
+
+bool Replay::isRecording() const {
+	return this->m_mode == Mode::eRECORDING;
+}
+
+bool Replay::isPlaying() const {
+	return this->m_mode == Mode::ePLAYING;
+}
+
+bool Replay::isFinished() const {
+	return this->m_finished;
+}
+
+void Replay::begin(unsigned int seed, int playerNumber, bool singlePlayer) {
+	this->m_seed = seed;
+	this->m_playerNumber = playerNumber;
+	this->m_singlePlayer = singlePlayer;
+	this->m_numSyncs = 0;
+	this->m_recordedWinner = -1;
+	this->m_recordedTicks = 0;
+	this->m_data.clear();
+}
+
+void Replay::rewind() {
+	this->m_cursor = 0;
+	this->m_finished = false;
+}
+
+void Replay::setResult(int winner, PxU32 ticks) {
+	if (this->m_mode != Mode::eRECORDING) return;
+	this->m_recordedWinner = winner;
+	this->m_recordedTicks = ticks;
+}
+
+void Replay::write(int carid, VehicleCommand command, float value) {
+	if (this->m_mode != Mode::eRECORDING) return;
+	this->m_data.push_back((uint8_t)command);
+	this->m_data.push_back((uint8_t)carid);
+	if (numArgs(command) == 0) return;
+	const uint8_t* bytes = (const uint8_t*)&value;
+	this->m_data.insert(this->m_data.end(), bytes, bytes + sizeof(float));
+}
+
+void Replay::write(int carid, VehicleCommand command, const PxVec3& value) {
+	if (this->m_mode != Mode::eRECORDING) return;
+	this->m_data.push_back((uint8_t)command);
+	this->m_data.push_back((uint8_t)carid);
+	const uint8_t* bytes = (const uint8_t*)&value.x;
+	this->m_data.insert(this->m_data.end(), bytes, bytes + 3 * sizeof(float));
+}
+
+void Replay::sync(std::vector<PVehicle*>& vehicleList) {
+	if (this->m_mode == Mode::eRECORDING) {
+		this->m_data.push_back(SYNC_MARKER);
+		this->m_numSyncs++;
+		return;
+	}
+	if (this->m_mode != Mode::ePLAYING || this->m_finished) return;
+
+	while (this->m_cursor < this->m_data.size()) {
+		const uint8_t tag = this->m_data[this->m_cursor++];
+		if (tag == SYNC_MARKER) return;
+
+		const VehicleCommand command = (VehicleCommand)tag;
+		const int count = numArgs(command);
+		if (tag > (uint8_t)VehicleCommand::eRESET || this->m_cursor + 1 + count * sizeof(float) > this->m_data.size()) {
+			Log::error("Replay data is corrupt at byte {}", this->m_cursor - 1);
+			break;
+		}
+		const int carid = this->m_data[this->m_cursor++];
+		float args[3] = {};
+		std::memcpy(args, &this->m_data[this->m_cursor], count * sizeof(float));
+		this->m_cursor += count * sizeof(float);
+
+		for (PVehicle* carPtr : vehicleList) {
+			if (carPtr->carid == carid) this->apply(*carPtr, command, args);
+		}
+	}
+	this->m_finished = true;
+}
+
+unsigned int Replay::getSeed() const {
+	return this->m_seed;
+}
+
+int Replay::getPlayerNumber() const {
+	return this->m_playerNumber;
+}
+
+bool Replay::getSinglePlayer() const {
+	return this->m_singlePlayer;
+}
+
+PxU32 Replay::getNumSyncs() const {
+	return this->m_numSyncs;
+}
+
+int Replay::getRecordedWinner() const {
+	return this->m_recordedWinner;
+}
+
+PxU32 Replay::getRecordedTicks() const {
+	return this->m_recordedTicks;
+}
+
+int Replay::numArgs(VehicleCommand command) {
+	switch (command) {
+	case VehicleCommand::eHANDBRAKE:
+	case VehicleCommand::eBOOST:
+	case VehicleCommand::eJUMP:
+	case VehicleCommand::eUSE_POWERUP:
+	case VehicleCommand::eRESET:
+		return 0;
+	case VehicleCommand::eBOOST_TOWARDS:
+		return 3;
+	default:
+		return 1;
+	}
+}
+
+void Replay::apply(PVehicle& vehicle, VehicleCommand command, const float* args) {
+	switch (command) {
+	case VehicleCommand::eACCELERATE: vehicle.accelerate(args[0]); break;
+	case VehicleCommand::eREVERSE: vehicle.reverse(args[0]); break;
+	case VehicleCommand::eBRAKE: vehicle.brake(args[0]); break;
+	case VehicleCommand::eTURN_LEFT: vehicle.turnLeft(args[0]); break;
+	case VehicleCommand::eTURN_RIGHT: vehicle.turnRight(args[0]); break;
+	case VehicleCommand::eHANDBRAKE: vehicle.handbrake(); break;
+	case VehicleCommand::eROTATE_X: vehicle.rotateXAxis(args[0]); break;
+	case VehicleCommand::eROTATE_Y: vehicle.rotateYAxis(args[0]); break;
+	case VehicleCommand::eAIR_BRAKE: vehicle.airBrake(args[0]); break;
+	case VehicleCommand::eBOOST: vehicle.boost(); break;
+	case VehicleCommand::eHOLD_BOOST: vehicle.holdBoost(args[0] != 0.0f); break;
+	case VehicleCommand::eBOOST_TOWARDS: vehicle.boostTowards(PxVec3(args[0], args[1], args[2])); break;
+	case VehicleCommand::eJUMP: vehicle.jump(); break;
+	case VehicleCommand::eUSE_POWERUP: vehicle.usePowerUp(); break;
+	case VehicleCommand::eRESET: vehicle.manualReset(); break;
+	}
+}
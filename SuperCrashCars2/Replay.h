@@ -0,0 +1,97 @@
+#pragma once
+
+#include <PxPhysicsAPI.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace physx;
+
+class PVehicle;
+
+// every PVehicle input that can change the simulation, with the arguments it was called with.
+enum class VehicleCommand : uint8_t {
+	eACCELERATE,
+	eREVERSE,
+	eBRAKE,
+	eTURN_LEFT,
+	eTURN_RIGHT,
+	eHANDBRAKE,
+	eROTATE_X,
+	eROTATE_Y,
+	eAIR_BRAKE,
+	eBOOST,
+	eHOLD_BOOST,
+	eBOOST_TOWARDS,
+	eJUMP,
+	eUSE_POWERUP,
+	eRESET
+};
+
+// Binary log of vehicle inputs for one match. While recording, every command a car receives (from a
+// controller or the AI) is appended together with its exact arguments; Match writes a sync marker at
+// fixed points of each tick. Playback calls the same PVehicle methods at the same markers, and with
+// the seed and game clock restored the match plays out the same way.
+class Replay {
+
+public:
+	Replay();
+
+	// arm recording, the header and first tick are written when the next match starts.
+	void record();
+	bool load(const std::string& path);
+	bool save(const std::string& path) const;
+	void stop();
+
+	bool isRecording() const;
+	bool isPlaying() const;
+	// playback ran past the last recorded tick.
+	bool isFinished() const;
+
+	// called by Match at the start of a round.
+	void begin(unsigned int seed, int playerNumber, bool singlePlayer);
+	void rewind();
+	// how the recorded match ended, so a playback can tell whether it went the same way.
+	void setResult(int winner, PxU32 ticks);
+
+	// recording side, ignored unless recording.
+	void write(int carid, VehicleCommand command, float value = 0.0f);
+	void write(int carid, VehicleCommand command, const PxVec3& value);
+	// tick boundary. recording writes a marker, playback applies everything up to the next one.
+	void sync(std::vector<PVehicle*>& vehicleList);
+
+	unsigned int getSeed() const;
+	int getPlayerNumber() const;
+	bool getSinglePlayer() const;
+	PxU32 getNumSyncs() const;
+	int getRecordedWinner() const; // -1 if the recording was stopped before anyone won
+	PxU32 getRecordedTicks() const;
+
+private:
+	enum class Mode {
+		eOFF,
+		eRECORDING,
+		ePLAYING
+	};
+
+	static const uint32_t MAGIC = 0x52434353; // "SCCR"
+	static const uint16_t VERSION = 1;
+	static const uint8_t SYNC_MARKER = 0xFF;
+
+	Mode m_mode = Mode::eOFF;
+	bool m_finished = false;
+
+	unsigned int m_seed = 0;
+	int m_playerNumber = 0;
+	bool m_singlePlayer = false;
+	PxU32 m_numSyncs = 0;
+	int m_recordedWinner = -1;
+	PxU32 m_recordedTicks = 0;
+
+	std::vector<uint8_t> m_data;
+	size_t m_cursor = 0;
+
+	static int numArgs(VehicleCommand command);
+	void apply(PVehicle& vehicle, VehicleCommand command, const float* args);
+};
@@ -0,0 +1,41 @@
+#include "SceneSnapshot.h"
+
+#include <glm/gtc/quaternion.hpp>
+
+PxTransform VehicleSnapshot::getInterpolatedPose(float alpha) const {
+	const glm::quat prevRot(this->prevPose.q.w, this->prevPose.q.x, this->prevPose.q.y, this->prevPose.q.z);
+	const glm::quat currRot(this->currPose.q.w, this->currPose.q.x, this->currPose.q.y, this->currPose.q.z);
+	const glm::quat rot = glm::slerp(prevRot, currRot, alpha);
+	return PxTransform(this->prevPose.p + (this->currPose.p - this->prevPose.p) * alpha, PxQuat(rot.x, rot.y, rot.z, rot.w));
+}
+
+PxTransform PowerUpSnapshot::getShapePose(float alpha) const {
+	const float blended = this->prevAngle + (this->angle - this->prevAngle) * alpha;
+	return this->pose * PxTransform(this->shapeOffset, PxQuat(blended, PxVec3(0.0f, 1.0f, 0.0f)));
+}
+
+float SceneSnapshot::getInterpolationAlpha(microseconds simStep) const {
+	const float alpha = duration<float>(steady_clock::now() - this->timestamp).count() / duration<float>(simStep).count();
+	return alpha < 0.0f ? 0.0f : (alpha > 1.0f ? 1.0f : alpha);
+}
+
+SnapshotBuffer::SnapshotBuffer() : m_middle(2) {}
+
+SceneSnapshot& SnapshotBuffer::back() {
+	return this->m_buffers[this->m_back];
+}
+
+void SnapshotBuffer::publish() {
+	this->m_buffers[this->m_back].timestamp = steady_clock::now();
+	// hand the finished slot over and take whatever was in the middle to write next.
+	const int previous = this->m_middle.exchange(this->m_back | FRESH_BIT, std::memory_order_acq_rel);
+	this->m_back = previous & ~FRESH_BIT;
+}
+
+const SceneSnapshot& SnapshotBuffer::acquire() {
+	if (this->m_middle.load(std::memory_order_relaxed) & FRESH_BIT) {
+		const int latest = this->m_middle.exchange(this->m_front, std::memory_order_acq_rel);
+		this->m_front = latest & ~FRESH_BIT;
+	}
+	return this->m_buffers[this->m_front];
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <PxPhysicsAPI.h>
+#include "glm/glm.hpp"
+
+#include "PVehicle.h"
+#include "PowerUp.h"
+#include "GameManager.h"
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+
+using namespace physx;
+using namespace std::chrono;
+
+// Everything the renderer needs from one simulation step. Written by the simulation thread,
+// read by the render thread, never shared between the two while in use (see SnapshotBuffer).
+
+struct VehicleSnapshot {
+	static const int NUM_SHAPES = 5; // 0-3 tires, 4 body (same order as PVehicle::render)
+
+	PxTransform prevPose;
+	PxTransform currPose;
+	PxTransform shapeLocalPoses[NUM_SHAPES];
+	glm::vec3 frontVec;
+	float speed;
+
+	float damage;		// vehicleAttr.collisionCoefficient
+	float flashWhite;
+	ShieldPowerUpState shieldState;
+
+	int carid;
+	int lives;
+	int boost;
+	PowerUpType pocket;
+
+	PxTransform getInterpolatedPose(float alpha) const;
+};
+
+struct PowerUpSnapshot {
+	PxTransform pose;
+	PxVec3 shapeOffset;
+	float prevAngle;
+	float angle;
+	bool active;
+
+	PxTransform getShapePose(float alpha) const;
+};
+
+struct SceneSnapshot {
+	time_point<steady_clock> timestamp; // when the step was published, used to blend prev/curr poses
+
+	std::vector<VehicleSnapshot> vehicles;
+	std::vector<PowerUpSnapshot> powerUps;
+
+	// game/menu state, copied from GameManager
+	Screen screen = Screen::eMAINMENU;
+	MainMenuScreen mainMenuScreen = MainMenuScreen::eMAIN_SCREEN;
+	MainMenuButton menuButton = MainMenuButton::eSINGLEPLAYER;
+	PlayerSelectButton playerSelectButton = PlayerSelectButton::eSELECTING;
+	OptionsButton optionsButton = OptionsButton::eBGM;
+	PauseButton pauseButton = PauseButton::eRESUME;
+	bool paused = false;
+	int playerNumber = 1;
+	int winner = 0;
+	bool multiplayer = false; // render at the multiplayer frame cap
+	int statsResets = 0; // bumped when a match starts, the render thread resets its own timing stats on change
+
+	int bgmLevel = 0;
+	int sfxLevel = 0;
+	std::string multiplayerFPS;
+	ShadowQuality shadowQuality = ShadowQuality::eMEDIUM;
+	std::string shadowQualityName;
+
+	bool controllerConnected[4] = {};
+	bool controllerStartHeld[4] = {};
+
+	// how far the render thread is between this step and the next one.
+	float getInterpolationAlpha(microseconds simStep) const;
+};
+
+// Lock-free triple buffer: the simulation always has a slot to write into, the renderer always
+// has a complete snapshot to read, and neither ever waits for the other.
+class SnapshotBuffer {
+
+public:
+	SnapshotBuffer();
+
+	// simulation thread
+	SceneSnapshot& back();
+	void publish();
+
+	// render thread, returns the newest published snapshot (the same one again if nothing new arrived).
+	const SceneSnapshot& acquire();
+
+private:
+	static const int FRESH_BIT = 4;
+
+	SceneSnapshot m_buffers[3];
+	int m_back = 0;
+	int m_front = 1;
+	std::atomic<int> m_middle;
+};
@@ -1,5 +1,6 @@
 #include "ShaderProgram.h"
 
+#include <algorithm>
 #include <iostream>
 #include <stdexcept>
 #include <vector>
@@ -20,6 +21,9 @@ ShaderProgram::ShaderProgram(const std::string& vertexPath, const std::string& f
 		glDeleteProgram(programID);
 		throw std::runtime_error("Shaders did not link.");
 	}
+
+	cacheUniforms();
+	bindUniformBlocks();
 }
 
 bool ShaderProgram::recompile() {
@@ -37,6 +41,58 @@ bool ShaderProgram::recompile() {
 }
 
 
+GLint ShaderProgram::getUniformLocation(const std::string& name) const {
+	auto it = m_uniformLocations.find(name);
+	return it == m_uniformLocations.end() ? -1 : it->second;
+}
+
+
+void ShaderProgram::cacheUniforms() {
+	m_uniformLocations.clear();
+
+	GLint count = 0, maxLength = 0;
+	glGetProgramiv(programID, GL_ACTIVE_UNIFORMS, &count);
+	glGetProgramiv(programID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+	std::vector<char> buffer(std::max(maxLength, 1));
+
+	for (GLint i = 0; i < count; i++) {
+		GLsizei length = 0;
+		GLint size = 0;
+		GLenum type = 0;
+		glGetActiveUniform(programID, (GLuint)i, (GLsizei)buffer.size(), &length, &size, &type, buffer.data());
+		std::string name(buffer.data(), length);
+
+		// members of a uniform block have no location
+		const GLint location = glGetUniformLocation(programID, name.c_str());
+		if (location < 0) continue;
+
+		// arrays are reported as "name[0]", register the bare name and every element
+		const size_t bracket = name.find('[');
+		if (bracket == std::string::npos) {
+			m_uniformLocations[name] = location;
+			continue;
+		}
+		const std::string base = name.substr(0, bracket);
+		m_uniformLocations[base] = location;
+		for (GLint e = 0; e < size; e++) {
+			const std::string element = base + "[" + std::to_string(e) + "]";
+			m_uniformLocations[element] = glGetUniformLocation(programID, element.c_str());
+		}
+	}
+
+	m_modelLocation = getUniformLocation("TM");
+}
+
+
+void ShaderProgram::bindUniformBlocks() const {
+	const GLuint viewBlock = glGetUniformBlockIndex(programID, "ViewBlock");
+	if (viewBlock != GL_INVALID_INDEX) glUniformBlockBinding(programID, viewBlock, VIEW_BLOCK_BINDING);
+
+	const GLuint frameBlock = glGetUniformBlockIndex(programID, "FrameBlock");
+	if (frameBlock != GL_INVALID_INDEX) glUniformBlockBinding(programID, frameBlock, FRAME_BLOCK_BINDING);
+}
+
+
 void attach(ShaderProgram& sp, Shader& s) {
 	glAttachShader(sp.programID, s.shaderID);
 }
@@ -8,6 +8,7 @@
 #include "glm/glm.hpp"
 
 #include <string>
+#include <unordered_map>
 
 
 class ShaderProgram {
@@ -26,14 +27,23 @@ public:
 	bool recompile();
 	void use() const { glUseProgram(programID); }
 
-	void setBool(const std::string& name, bool value) const { glUniform1i(glGetUniformLocation(*this, name.c_str()), (int)value); }
-	void setInt(const std::string& name, int value) const { glUniform1i(glGetUniformLocation(*this, name.c_str()), value); }
-	void setFloat(const std::string& name, float value) const { glUniform1f(glGetUniformLocation(*this, name.c_str()), value); }
+	// uniform block binding points, the same for every program (see RenderManager::ViewBlock/FrameBlock)
+	static constexpr GLuint VIEW_BLOCK_BINDING = 0;
+	static constexpr GLuint FRAME_BLOCK_BINDING = 1;
 
-	void setVector4(const std::string& name, glm::vec4 value) const { glUniform4f(glGetUniformLocation(*this, name.c_str()), value.x, value.y, value.z, value.w); }
-	void setVector3(const std::string& name, glm::vec3 value) const { glUniform3f(glGetUniformLocation(*this, name.c_str()), value.x, value.y, value.z); }
+	// locations are looked up once at link time, -1 for anything the linker dropped
+	GLint getUniformLocation(const std::string& name) const;
+	GLint getModelLocation() const { return m_modelLocation; } // "TM", set for every draw
 
-	void setMat4(const std::string& name, glm::mat4 value) const { glUniformMatrix4fv(glGetUniformLocation(*this, name.c_str()), 1, GL_FALSE, &value[0][0]); }
+	void setBool(const std::string& name, bool value) const { glUniform1i(getUniformLocation(name), (int)value); }
+	void setInt(const std::string& name, int value) const { glUniform1i(getUniformLocation(name), value); }
+	void setFloat(const std::string& name, float value) const { glUniform1f(getUniformLocation(name), value); }
+
+	void setVector4(const std::string& name, glm::vec4 value) const { glUniform4f(getUniformLocation(name), value.x, value.y, value.z, value.w); }
+	void setVector3(const std::string& name, glm::vec3 value) const { glUniform3f(getUniformLocation(name), value.x, value.y, value.z); }
+	void setVector2(const std::string& name, glm::vec2 value) const { glUniform2f(getUniformLocation(name), value.x, value.y); }
+
+	void setMat4(const std::string& name, const glm::mat4& value) const { glUniformMatrix4fv(getUniformLocation(name), 1, GL_FALSE, &value[0][0]); }
 
 	void friend attach(ShaderProgram& sp, Shader& s);
 
@@ -47,5 +57,10 @@ private:
 	Shader vertex;
 	Shader fragment;
 
+	std::unordered_map<std::string, GLint> m_uniformLocations;
+	GLint m_modelLocation = -1;
+
 	bool checkAndLogLinkSuccess() const;
+	void cacheUniforms();
+	void bindUniformBlocks() const;
 };
@@ -0,0 +1,53 @@
+#include "ShadowBenchmark.h"
+
+#include "BenchmarkScene.h"
+#include "Log.h"
+
+namespace {
+	const char* qualityName(ShadowQuality quality) {
+		switch (quality) {
+		case ShadowQuality::eLEGACY: return "legacy";
+		case ShadowQuality::eLOW: return "low";
+		case ShadowQuality::eMEDIUM: return "medium";
+		default: return "high";
+		}
+	}
+}
+
+void ShadowBenchmark::run(RenderManager& renderer, std::vector<Camera*>& cameraList, PxU32 frames) {
+	const ShadowQuality previous = renderer.getShadowQuality();
+
+	Log::info("Shadow benchmark: {} frames per case, cars driving, shadow passes only.", frames);
+	Log::info("{:>7} | {:>9} | {:>10} | {:>9} | {:>9} | {:>14} | {:>13}", "quality", "maps", "memory MB", "1P ms", "4P ms", "near texels/m", "far texels/m");
+	for (int q = 0; q < 4; q++) {
+		const ShadowQuality quality = (ShadowQuality)q;
+		renderer.setShadowQuality(quality);
+
+		const double onePlayer = runCase(renderer, cameraList, 1, frames);
+		const double fourPlayers = runCase(renderer, cameraList, 4, frames);
+
+		// the legacy map covers a fixed 600 unit box, the cascades report what they were last fit to (player 4's camera)
+		float nearDensity = renderer.SHADOW_WIDTH / 600.0f, farDensity = nearDensity;
+		if (renderer.getNumCascades() > 0) {
+			nearDensity = renderer.cascadeTexelDensity[0];
+			farDensity = renderer.cascadeTexelDensity[renderer.getNumCascades() - 1];
+		}
+		const std::string maps = fmt::format("{}x{}^2", PxMax(renderer.getNumCascades(), 1), renderer.getShadowMapSize());
+		Log::info("{:>7} | {:>9} | {:>10.0f} | {:>9.2f} | {:>9.2f} | {:>14.2f} | {:>13.2f}", qualityName(quality), maps, renderer.getShadowMemory() / (1024.0 * 1024.0), onePlayer, fourPlayers, nearDensity, farDensity);
+	}
+
+	renderer.setShadowQuality(previous);
+}
+
+double ShadowBenchmark::runCase(RenderManager& renderer, std::vector<Camera*>& cameraList, int playerNumber, PxU32 frames) {
+	// the casters keep moving, a still scene would let the legacy map skip its redraw.
+	BenchmarkScene scene;
+	return scene.run(renderer, frames, [&]() {
+		renderer.renderShadows(scene.vehicles, scene.snapshots, scene.powerUps, scene.powerUpStates, 1.0f);
+		for (int viewport = 0; viewport < playerNumber; viewport++) {
+			renderer.switchViewport(playerNumber, viewport);
+			scene.followCar(cameraList, viewport);
+			renderer.renderCascades(scene.vehicles, scene.snapshots, scene.powerUps, scene.powerUpStates, 1.0f);
+		}
+	});
+}
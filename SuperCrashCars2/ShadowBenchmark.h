@@ -0,0 +1,18 @@
+#pragma once
+
+#include "RenderManager.h"
+
+#include <vector>
+
+// Renders only the shadow passes of a 4 car match for every ShadowQuality, with one and with four
+// viewports, and logs the depth memory, the GPU time of the passes and the shadow texel density
+// near and far from the camera. Needs a current GL context; leaves the renderer on its old quality.
+class ShadowBenchmark {
+
+public:
+	static void run(RenderManager& renderer, std::vector<Camera*>& cameraList, PxU32 frames = 300);
+
+private:
+	// returns the average GPU time of the shadow passes per frame in milliseconds.
+	static double runCase(RenderManager& renderer, std::vector<Camera*>& cameraList, int playerNumber, PxU32 frames);
+};
@@ -0,0 +1,19 @@
+#include "SimClock.h"
+
+time_point<steady_clock> SimClock::s_now = time_point<steady_clock>();
+
+time_point<steady_clock> SimClock::now() {
+	return s_now;
+}
+
+void SimClock::advance(microseconds step) {
+	s_now += step;
+}
+
+void SimClock::reset() {
+	s_now = time_point<steady_clock>();
+}
+
+time_t SimClock::time() {
+	return (time_t)duration_cast<seconds>(s_now.time_since_epoch()).count();
+}
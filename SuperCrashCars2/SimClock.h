@@ -0,0 +1,23 @@
+#pragma once
+
+#include <chrono>
+#include <ctime>
+
+using namespace std::chrono;
+
+// Gameplay clock. It only moves when the world is stepped, one fixed step at a time, so shield,
+// respawn, death and AI timers follow the simulation rather than the wall clock: a paused game
+// stands still and a headless match can run as fast as the CPU allows with the same outcome.
+class SimClock {
+
+public:
+	static time_point<steady_clock> now();
+	static void advance(microseconds step);
+	// back to zero at the start of a round, so a replayed match sees the same clock as the recording.
+	static void reset();
+	// whole seconds, stands in for time(0) in the cooldowns.
+	static time_t time();
+
+private:
+	static time_point<steady_clock> s_now;
+};
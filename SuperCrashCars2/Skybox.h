@@ -4,12 +4,12 @@
 #include "glm/glm.hpp"
 #include "glm/gtc/type_ptr.hpp"
 
-#include <stb_image.h>
 #include <vector>
 #include <string>
 #include <iostream>
 
 #include "ShaderProgram.h"
+#include "AssetLoader.h"
 
 class Skybox {
 public:
@@ -75,35 +75,31 @@ public:
         glEnableVertexAttribArray(0);
         glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
 
-        std::vector<std::string> faces
-        {
-            "skybox/nx.jpeg",
-            "skybox/px.jpeg",
-            "skybox/py.jpeg",
-            "skybox/ny.jpeg",
-            "skybox/nz.jpeg",
-            "skybox/pz.jpeg",
-        };
+        const std::vector<std::string> faces = Skybox::faces();
 
         unsigned int textureID;
         glGenTextures(1, &textureID);
         glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
 
-        int width, height, nrChannels;
         for (unsigned int i = 0; i < faces.size(); i++)
         {
-            unsigned char* data = stbi_load(faces[i].c_str(), &width, &height, &nrChannels, 0);
-            if (data)
+            // decoded on a loader worker if it was requested there
+            DecodedImage decoded;
+            const DecodedImage* image = AssetLoader::get().findImage(faces[i], false);
+            if (image == nullptr)
+            {
+                decoded = AssetLoader::decode(faces[i], false);
+                image = &decoded;
+            }
+            if (image->valid())
             {
                 glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i,
-                    0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data
+                    0, GL_RGB, image->width, image->height, 0, GL_RGB, GL_UNSIGNED_BYTE, image->pixels.data()
                 );
-                stbi_image_free(data);
             }
             else
             {
                 std::cout << "Error" << std::endl;
-                stbi_image_free(data);
             }
         }
         glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
@@ -118,6 +114,18 @@ public:
         shader.setInt("skybox", 0);
     }
 
+    // one image per cube face, in GL's +x, -x, +y, -y, +z, -z order
+    static std::vector<std::string> faces() {
+        return {
+            "skybox/nx.jpeg",
+            "skybox/px.jpeg",
+            "skybox/py.jpeg",
+            "skybox/ny.jpeg",
+            "skybox/nz.jpeg",
+            "skybox/pz.jpeg",
+        };
+    }
+
     void draw(glm::mat4 projection, glm::mat4 view) {
         glDepthFunc(GL_LEQUAL);  // change depth function so depth test passes when values are equal to depth buffer's content
         shader.use();
@@ -33,6 +33,7 @@
 #include "SnippetVehicleFilterShader.h"
 #include "SnippetVehicleTireFriction.h"
 #include "PxPhysicsAPI.h"
+#include "CookCache.h"
 
 namespace snippetvehicle
 {
@@ -55,36 +56,11 @@ PxRigidStatic* createDrivablePlane(const PxFilterData& simFilterData, PxMaterial
 
 static PxConvexMesh* createConvexMesh(const PxVec3* verts, const PxU32 numVerts, PxPhysics& physics, PxCooking& cooking)
 {
-	// Create descriptor for convex mesh
-	PxConvexMeshDesc convexDesc;
-	convexDesc.points.count			= numVerts;
-	convexDesc.points.stride		= sizeof(PxVec3);
-	convexDesc.points.data			= verts;
-	convexDesc.flags				= PxConvexFlag::eCOMPUTE_CONVEX;
-
-	PxConvexMesh* convexMesh = NULL;
-	PxDefaultMemoryOutputStream buf;
-	if(cooking.cookConvexMesh(convexDesc, buf))
-	{
-		PxDefaultMemoryInputData id(buf.getData(), buf.getSize());
-		convexMesh = physics.createConvexMesh(id);
-	}
-
-	return convexMesh;
+	return CookCache::get().createConvexMesh(physics, cooking, verts, numVerts);
 }
 
 static PxConvexMesh* createConvexMesh(const std::vector<PxVec3>& vertices, PxPhysics& physics, PxCooking& cooking) {
-	PxConvexMeshDesc convexDesc;
-	convexDesc.points.count = vertices.size();
-	convexDesc.points.stride = sizeof(PxVec3);
-	convexDesc.points.data = &vertices[0];
-	convexDesc.flags = PxConvexFlag::eCOMPUTE_CONVEX;
-
-	PxDefaultMemoryOutputStream buf;
-	if (!cooking.cookConvexMesh(convexDesc, buf)) return NULL;
-
-	PxDefaultMemoryInputData input(buf.getData(), buf.getSize());
-	return physics.createConvexMesh(input);
+	return CookCache::get().createConvexMesh(physics, cooking, vertices.data(), (PxU32)vertices.size());
 }
 
 PxConvexMesh* createChassisMesh(const PxVec3 dims, PxPhysics& physics, PxCooking& cooking)
@@ -0,0 +1,66 @@
+#include "SplitScreenBenchmark.h"
+
+#include "BenchmarkScene.h"
+#include "Log.h"
+
+#include <chrono>
+
+using namespace std::chrono;
+
+void SplitScreenBenchmark::run(RenderManager& renderer, std::vector<Camera*>& cameraList, PxU32 frames) {
+	const SplitScreenMode previous = renderer.getSplitScreenMode();
+
+	Log::info("Split screen benchmark: {} frames per case, cars driving, cars and static world only.", frames);
+	if (!RenderManager::singlePassSupported()) Log::info("No ARB_viewport_array with gl_ViewportIndex in the vertex shader here, the single pass falls back to the loop.");
+	Log::info("{:>7} | {:>11} | {:>10} | {:>9}", "players", "mode", "submit ms", "GPU ms");
+	for (int playerNumber : { 2, 4 }) {
+		for (SplitScreenMode mode : { SplitScreenMode::eLOOP, SplitScreenMode::eSINGLE_PASS }) {
+			renderer.setSplitScreenMode(mode);
+			const Result result = runCase(renderer, cameraList, playerNumber, frames);
+			Log::info("{:>7} | {:>11} | {:>10.3f} | {:>9.2f}", playerNumber, mode == SplitScreenMode::eLOOP ? "loop" : "single pass", result.cpuMs, result.gpuMs);
+		}
+	}
+
+	renderer.setSplitScreenMode(previous);
+}
+
+SplitScreenBenchmark::Result SplitScreenBenchmark::runCase(RenderManager& renderer, std::vector<Camera*>& cameraList, int playerNumber, PxU32 frames) {
+	BenchmarkScene scene;
+	// the same order main uses for a match
+	auto renderScene = [&]() {
+		renderer.beginQueue();
+		renderer.renderCars(scene.vehicles, scene.snapshots, 1.0f);
+		renderer.flushQueue();
+		renderer.renderStaticObjects(0.5);
+	};
+
+	Result result;
+	duration<double, std::milli> submit(0.0);
+	result.gpuMs = scene.run(renderer, frames, [&]() {
+		submit = duration<double, std::milli>(0.0);
+		renderer.renderShadows(scene.vehicles, scene.snapshots, scene.powerUps, scene.powerUpStates, 1.0f);
+		const bool singlePass = renderer.prepareViewports(playerNumber);
+		for (int viewport = 0; viewport < playerNumber; viewport++) {
+			renderer.switchViewport(playerNumber, viewport);
+			scene.followCar(cameraList, viewport);
+			renderer.renderCascades(scene.vehicles, scene.snapshots, scene.powerUps, scene.powerUpStates, 1.0f);
+			if (singlePass) continue;
+
+			const time_point<steady_clock> start = steady_clock::now();
+			renderScene();
+			submit += steady_clock::now() - start;
+		}
+		if (singlePass) {
+			const time_point<steady_clock> start = steady_clock::now();
+			renderer.beginSinglePass();
+			renderScene();
+			renderer.endSinglePass();
+			submit += steady_clock::now() - start;
+		}
+	}, [&]() {
+		result.cpuMs += submit.count();
+	});
+
+	result.cpuMs /= frames;
+	return result;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "RenderManager.h"
+
+#include <vector>
+
+// Renders the cars and the static world of a 2 and a 4 player match with the viewports drawn one by one and
+// in a single pass, every camera following its car, and logs the CPU time spent submitting the scene and
+// the GPU time per frame. Needs a current GL context and the renderer's static objects set;
+// leaves the renderer on its old mode.
+class SplitScreenBenchmark {
+
+public:
+	static void run(RenderManager& renderer, std::vector<Camera*>& cameraList, PxU32 frames = 300);
+
+private:
+	struct Result {
+		double cpuMs = 0.0; // submitting the scene of every viewport, per frame
+		double gpuMs = 0.0; // cascades and scene
+	};
+	static Result runCase(RenderManager& renderer, std::vector<Camera*>& cameraList, int playerNumber, PxU32 frames);
+};
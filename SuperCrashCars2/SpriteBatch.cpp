@@ -0,0 +1,210 @@
+#include "SpriteBatch.h"
+
+#include "Log.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+
+namespace {
+	constexpr int FLOATS_PER_VERTEX = 7; // pos, tex, color
+	constexpr int CELL = 1 << SpriteBatch::PAGE_LEVELS;
+
+	int roundUp(int value, int multiple) {
+		return (value + multiple - 1) / multiple * multiple;
+	}
+}
+
+SpriteBatch::SpriteBatch() : m_shader("shaders/image.vert", "shaders/image.frag") {
+	this->m_shader.use();
+	this->m_shader.setInt("image", 0);
+
+	glGenVertexArrays(1, &this->m_VAO);
+	glGenBuffers(1, &this->m_VBO);
+	glBindVertexArray(this->m_VAO);
+	glBindBuffer(GL_ARRAY_BUFFER, this->m_VBO);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, FLOATS_PER_VERTEX * sizeof(float), (void*)0);
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, FLOATS_PER_VERTEX * sizeof(float), (void*)(4 * sizeof(float)));
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindVertexArray(0);
+
+	glGenFramebuffers(1, &this->m_readFBO);
+	glGenFramebuffers(1, &this->m_drawFBO);
+}
+
+SpriteBatch::~SpriteBatch() {
+	for (const Page& page : this->m_pages) {
+		if (page.owned) glDeleteTextures(1, &page.texture);
+	}
+	glDeleteFramebuffers(1, &this->m_readFBO);
+	glDeleteFramebuffers(1, &this->m_drawFBO);
+	glDeleteBuffers(1, &this->m_VBO);
+	glDeleteVertexArrays(1, &this->m_VAO);
+}
+
+void SpriteBatch::setScreenSize(float width, float height) {
+	this->m_shader.use();
+	this->m_shader.setMat4("projection", glm::ortho(0.0f, width, height, 0.0f, -1.0f, 1.0f));
+}
+
+void SpriteBatch::draw(const Texture& texture, glm::vec2 position, glm::vec2 size, float rotate, glm::vec3 color) {
+	const Sprite& sprite = this->find(texture);
+
+	// scale, rotate around the center, then translate, the way the model matrix used to
+	const glm::vec2 half = 0.5f * size;
+	const float c = std::cos(glm::radians(rotate));
+	const float s = std::sin(glm::radians(rotate));
+	// the images are flipped on load, so the top of the quad reads the top (last) rows
+	auto corner = [&](float* out, float x, float y) {
+		const glm::vec2 offset = glm::vec2(x, y) * size - half;
+		out[0] = position.x + half.x + offset.x * c - offset.y * s;
+		out[1] = position.y + half.y + offset.x * s + offset.y * c;
+		out[2] = x == 0.f ? sprite.uvMin.x : sprite.uvMax.x;
+		out[3] = y == 0.f ? sprite.uvMax.y : sprite.uvMin.y;
+		out[4] = color.r;
+		out[5] = color.g;
+		out[6] = color.b;
+	};
+
+	Quad quad;
+	quad.page = sprite.page;
+	corner(&quad.vertices[0 * FLOATS_PER_VERTEX], 0.f, 1.f);
+	corner(&quad.vertices[1 * FLOATS_PER_VERTEX], 1.f, 1.f);
+	corner(&quad.vertices[2 * FLOATS_PER_VERTEX], 1.f, 0.f);
+	corner(&quad.vertices[3 * FLOATS_PER_VERTEX], 0.f, 1.f);
+	corner(&quad.vertices[4 * FLOATS_PER_VERTEX], 1.f, 0.f);
+	corner(&quad.vertices[5 * FLOATS_PER_VERTEX], 0.f, 0.f);
+	this->m_quads.push_back(quad);
+}
+
+void SpriteBatch::flush() {
+	if (this->m_quads.empty()) return;
+
+	// stable, so quads on one page still overlap the way they were drawn
+	std::stable_sort(this->m_quads.begin(), this->m_quads.end(), [](const Quad& a, const Quad& b) { return a.page < b.page; });
+	this->m_vertices.clear();
+	for (const Quad& quad : this->m_quads) this->m_vertices.insert(this->m_vertices.end(), std::begin(quad.vertices), std::end(quad.vertices));
+
+	this->m_shader.use();
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glActiveTexture(GL_TEXTURE0);
+	glBindVertexArray(this->m_VAO);
+	glBindBuffer(GL_ARRAY_BUFFER, this->m_VBO);
+	// respecifying the buffer orphans last flush's storage instead of waiting on it
+	glBufferData(GL_ARRAY_BUFFER, this->m_vertices.size() * sizeof(float), this->m_vertices.data(), GL_STREAM_DRAW);
+
+	size_t first = 0;
+	while (first < this->m_quads.size()) {
+		size_t last = first;
+		while (last < this->m_quads.size() && this->m_quads[last].page == this->m_quads[first].page) last++;
+
+		Page& page = this->m_pages[this->m_quads[first].page];
+		glBindTexture(GL_TEXTURE_2D, page.texture);
+		if (page.dirty) {
+			glGenerateMipmap(GL_TEXTURE_2D);
+			page.dirty = false;
+		}
+		glDrawArrays(GL_TRIANGLES, (GLint)(first * 6), (GLsizei)((last - first) * 6));
+		first = last;
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindVertexArray(0);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	this->m_quads.clear();
+}
+
+const SpriteBatch::Sprite& SpriteBatch::find(const Texture& texture) {
+	auto found = this->m_sprites.find(texture.getID());
+	if (found != this->m_sprites.end()) return found->second;
+
+	Sprite sprite;
+	const glm::ivec2 size = texture.getDimensions();
+	if (size.x > MAX_PACKED || size.y > MAX_PACKED) {
+		// drawn straight from its own texture
+		Page page;
+		page.texture = texture.getID();
+		sprite.page = (int)this->m_pages.size();
+		sprite.uvMin = glm::vec2(0.f);
+		sprite.uvMax = glm::vec2(1.f);
+		this->m_pages.push_back(page);
+		return this->m_sprites.emplace(texture.getID(), sprite).first->second;
+	}
+
+	int x = 0, y = 0;
+	sprite.page = -1;
+	for (size_t i = 0; i < this->m_pages.size() && sprite.page < 0; i++) {
+		if (this->m_pages[i].owned && this->place(this->m_pages[i], size.x, size.y, x, y)) sprite.page = (int)i;
+	}
+	if (sprite.page < 0) {
+		sprite.page = this->addPage();
+		this->place(this->m_pages[sprite.page], size.x, size.y, x, y);
+	}
+	Page& page = this->m_pages[sprite.page];
+	this->copy(texture, page, x, y, size.x, size.y);
+	page.dirty = true;
+	sprite.uvMin = glm::vec2(x, y) / (float)PAGE_SIZE;
+	sprite.uvMax = glm::vec2(x + size.x, y + size.y) / (float)PAGE_SIZE;
+	return this->m_sprites.emplace(texture.getID(), sprite).first->second;
+}
+
+// shelf packing on the mip grid, with a free cell after every image and shelf
+bool SpriteBatch::place(Page& page, int width, int height, int& x, int& y) {
+	const int cellsWidth = roundUp(width, CELL) + CELL;
+	const int cellsHeight = roundUp(height, CELL) + CELL;
+	if (page.shelfX + cellsWidth > PAGE_SIZE) {
+		page.shelfX = 0;
+		page.shelfY += page.shelfHeight;
+		page.shelfHeight = 0;
+	}
+	if (page.shelfY + cellsHeight > PAGE_SIZE) return false;
+	x = page.shelfX;
+	y = page.shelfY;
+	page.shelfX += cellsWidth;
+	page.shelfHeight = std::max(page.shelfHeight, cellsHeight);
+	return true;
+}
+
+int SpriteBatch::addPage() {
+	Page page;
+	page.owned = true;
+	// cleared to transparent, the free cells between images are what keeps them from bleeding
+	const std::vector<unsigned char> empty((size_t)PAGE_SIZE * PAGE_SIZE * 4, 0);
+	glGenTextures(1, &page.texture);
+	glBindTexture(GL_TEXTURE_2D, page.texture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, PAGE_SIZE, PAGE_SIZE, 0, GL_RGBA, GL_UNSIGNED_BYTE, empty.data());
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, PAGE_LEVELS);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	this->m_pages.push_back(page);
+	Log::info("Sprite atlas page {} created", this->m_pages.size() - 1);
+	return (int)this->m_pages.size() - 1;
+}
+
+// level 0 of the texture into the page with a framebuffer blit, GL 3.3 has no image copy
+void SpriteBatch::copy(const Texture& texture, const Page& page, int x, int y, int width, int height) {
+	GLint readFBO = 0, drawFBO = 0;
+	glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &readFBO);
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &drawFBO);
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, this->m_readFBO);
+	glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture.getID(), 0);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, this->m_drawFBO);
+	glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, page.texture, 0);
+	if (glCheckFramebufferStatus(GL_READ_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE && glCheckFramebufferStatus(GL_DRAW_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE) {
+		glBlitFramebuffer(0, 0, width, height, x, y, x + width, y + height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+	} else {
+		Log::warning("Could not copy {} into the sprite atlas", texture.getPath());
+	}
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, readFBO);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, drawFBO);
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <GL/glew.h>
+#include "glm/glm.hpp"
+
+#include <unordered_map>
+#include <vector>
+
+#include "ShaderProgram.h"
+#include "Texture.h"
+
+// Draws every 2D image of a frame (HUD, minimap, menus) with one shader and as few draws as it can.
+// A texture is copied into an atlas page the first time it's drawn; anything bigger than MAX_PACKED
+// on a side stays in its own texture and counts as a page of its own. draw() only queues the quad,
+// flush() sorts the queue by page and draws each page once.
+// Quads on the same page keep the order they were drawn in, quads on different pages don't, so flush
+// between layers that overlap and come from different pages.
+class SpriteBatch {
+
+public:
+	// creates the shader and buffers, so the first call has to come from the GL thread
+	static SpriteBatch& get() { static SpriteBatch shared; return shared; }
+
+	static constexpr int PAGE_SIZE = 2048;
+	static constexpr int MAX_PACKED = 1024;
+	// mip levels an atlas page keeps. packed images start and end on a 2^PAGE_LEVELS grid with an empty
+	// cell in between, so even the smallest level never blends two of them
+	static constexpr int PAGE_LEVELS = 6;
+
+	// the screen the positions are in, pixels from the top left
+	void setScreenSize(float width, float height);
+
+	// same arguments as Image::draw always took: rotate is in degrees around the quad's center
+	void draw(const Texture& texture, glm::vec2 position, glm::vec2 size, float rotate, glm::vec3 color);
+	// draws everything queued since the last flush
+	void flush();
+
+private:
+	SpriteBatch();
+	~SpriteBatch();
+
+	struct Page {
+		GLuint texture = 0;
+		bool owned = false; // an atlas page, otherwise the texture of one big image
+		bool dirty = false; // images were copied in since the mips were made
+		int shelfX = 0;
+		int shelfY = 0;
+		int shelfHeight = 0;
+	};
+
+	struct Sprite {
+		int page = 0;
+		glm::vec2 uvMin;
+		glm::vec2 uvMax;
+	};
+
+	struct Quad {
+		int page = 0;
+		float vertices[6 * 7]; // pos, tex, color
+	};
+
+	// where the texture lives, packing it on first use
+	const Sprite& find(const Texture& texture);
+	bool place(Page& page, int width, int height, int& x, int& y);
+	int addPage();
+	void copy(const Texture& texture, const Page& page, int x, int y, int width, int height);
+
+	ShaderProgram m_shader;
+	GLuint m_VAO = 0;
+	GLuint m_VBO = 0;
+	GLuint m_readFBO = 0;
+	GLuint m_drawFBO = 0;
+
+	std::vector<Page> m_pages;
+	std::unordered_map<GLuint, Sprite> m_sprites; // by texture id, the game's textures live as long as it runs
+	std::vector<Quad> m_quads;
+	std::vector<float> m_vertices;
+};
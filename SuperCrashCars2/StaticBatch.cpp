@@ -0,0 +1,301 @@
+#include "StaticBatch.h"
+
+#include <algorithm>
+
+#include "LodSelector.h"
+#include "Log.h"
+#include "Utils.h"
+
+StaticBatch::~StaticBatch() {
+	this->free();
+}
+
+void StaticBatch::build(const std::vector<Model*>& models) {
+	this->free();
+
+	struct Entry {
+		int model;
+		int layer;
+		const Mesh* mesh;
+		glm::mat4 TM;
+	};
+	std::vector<VertexLayout> layouts;
+	std::vector<std::vector<Entry>> entries; // per layout
+	std::vector<GLuint> textures; // layer - 1
+
+	this->m_modelParts.assign(models.size(), {});
+	this->m_TMs.assign(std::min((int)models.size(), MAX_MODELS), glm::mat4(1.0f));
+	int numModels = 0;
+	for (int m = 0; m < (int)models.size(); m++) {
+		if (m >= MAX_MODELS || models[m]->getRenderMode() != GL_FILL) continue;
+		this->m_TMs[m] = models[m]->getTM();
+		numModels++;
+
+		for (const Mesh& mesh : models[m]->getMeshData()) {
+			int layer = 0;
+			for (const TexMesh& texture : mesh.m_textures) {
+				if (texture.type != "texture_diffuse") continue;
+				auto found = std::find(textures.begin(), textures.end(), texture.id);
+				if (found != textures.end()) layer = (int)(found - textures.begin()) + 1;
+				else if (textures.size() < 255) { // the layer is a byte
+					textures.push_back(texture.id);
+					layer = (int)textures.size();
+				}
+				break;
+			}
+
+			const size_t group = std::find(layouts.begin(), layouts.end(), mesh.getLayout()) - layouts.begin();
+			if (group == layouts.size()) {
+				layouts.push_back(mesh.getLayout());
+				entries.emplace_back();
+			}
+			entries[group].push_back({ m, layer, &mesh, models[m]->getTM() });
+		}
+	}
+
+	this->m_groups.resize(layouts.size());
+	for (size_t g = 0; g < layouts.size(); g++) {
+		Group& group = this->m_groups[g];
+		const unsigned int stride = layouts[g].stride();
+		size_t numVertices = 0;
+		size_t numIndices = 0;
+		for (const Entry& entry : entries[g]) {
+			numVertices += entry.mesh->m_vertices.size();
+			for (int level = 0; level < entry.mesh->getNumLods(); level++) numIndices += entry.mesh->getLod(level).count;
+		}
+
+		glGenVertexArrays(1, &group.VAO);
+		glGenBuffers(1, &group.VBO);
+		glGenBuffers(1, &group.slotVBO);
+		glGenBuffers(1, &group.EBO);
+		glBindVertexArray(group.VAO);
+
+		glBindBuffer(GL_ARRAY_BUFFER, group.VBO);
+		glBufferData(GL_ARRAY_BUFFER, numVertices * stride, NULL, GL_STATIC_DRAW);
+
+		std::vector<unsigned int> indices;
+		std::vector<unsigned char> slots; // model, layer
+		std::vector<GLuint> baseVertices;
+		indices.reserve(numIndices);
+		slots.reserve(numVertices * 2);
+		GLuint baseVertex = 0;
+		const int firstPart = (int)this->m_parts.size();
+		for (const Entry& entry : entries[g]) {
+			const Mesh& mesh = *entry.mesh;
+			// straight from the mesh's own buffer, packed vertices aren't kept on the CPU
+			glBindBuffer(GL_COPY_READ_BUFFER, mesh.VBO);
+			glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_ARRAY_BUFFER, 0, (GLintptr)baseVertex * stride, (GLsizeiptr)mesh.m_vertices.size() * stride);
+
+			Part part{};
+			part.group = (int)g;
+			part.numLods = mesh.getNumLods();
+			part.bounds = mesh.getBounds().transformed(entry.TM);
+			this->m_modelParts[entry.model].push_back((int)this->m_parts.size());
+			this->m_parts.push_back(part);
+
+			for (size_t v = 0; v < mesh.m_vertices.size(); v++) {
+				slots.push_back((unsigned char)entry.model);
+				slots.push_back((unsigned char)entry.layer);
+			}
+			baseVertices.push_back(baseVertex);
+			baseVertex += (GLuint)mesh.m_vertices.size();
+		}
+		glBindBuffer(GL_COPY_READ_BUFFER, 0);
+
+		for (int level = 0; level < Mesh::MAX_LODS; level++) {
+			for (size_t e = 0; e < entries[g].size(); e++) {
+				const Mesh& mesh = *entries[g][e].mesh;
+				Part& part = this->m_parts[firstPart + e];
+				if (level >= part.numLods) continue;
+				const unsigned int* levelIndices = mesh.getLodIndices(level);
+				const unsigned int count = mesh.getLod(level).count;
+				part.firstIndex[level] = (GLuint)indices.size();
+				part.count[level] = (GLsizei)count;
+				for (unsigned int i = 0; i < count; i++) indices.push_back(baseVertices[e] + levelIndices[i]);
+			}
+		}
+
+		Mesh::setVertexAttributes(layouts[g]);
+
+		glBindBuffer(GL_ARRAY_BUFFER, group.slotVBO);
+		glBufferData(GL_ARRAY_BUFFER, slots.size(), slots.data(), GL_STATIC_DRAW);
+		glEnableVertexAttribArray(SLOT_LOCATION);
+		glVertexAttribIPointer(SLOT_LOCATION, 2, GL_UNSIGNED_BYTE, 0, (void*)0);
+
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, group.EBO);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+
+		glBindVertexArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+
+	this->buildTextureArray(textures);
+
+	Log::info("STATIC_BATCH {} meshes of {} models in {} buffers, {} textures, {}", this->m_parts.size(), numModels, this->m_groups.size(), textures.size(),
+		GLEW_ARB_multi_draw_indirect ? "multi-draw-indirect" : "multi-draw");
+}
+
+void StaticBatch::buildTextureArray(const std::vector<GLuint>& textures) {
+	glGenTextures(1, &this->m_textureArray);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, this->m_textureArray);
+	glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, LAYER_SIZE, LAYER_SIZE, (GLsizei)textures.size() + 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	GLint previousFBO = 0;
+	GLint viewport[4];
+	GLfloat clearColor[4];
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFBO);
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	glGetFloatv(GL_COLOR_CLEAR_VALUE, clearColor);
+	const GLboolean blend = glIsEnabled(GL_BLEND);
+	const GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+	const GLboolean cullFace = glIsEnabled(GL_CULL_FACE);
+
+	GLuint FBO, VAO;
+	glGenFramebuffers(1, &FBO);
+	glGenVertexArrays(1, &VAO); // core profile wants one bound, even without attributes
+	glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+	glViewport(0, 0, LAYER_SIZE, LAYER_SIZE);
+	glDisable(GL_BLEND);
+	glDisable(GL_DEPTH_TEST);
+	glDisable(GL_CULL_FACE);
+	glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+
+	glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, this->m_textureArray, 0, 0);
+	glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+	glClear(GL_COLOR_BUFFER_BIT);
+
+	// drawn, not blitted: model textures are usually block compressed, and those can't be attached
+	ShaderProgram copy("shaders/fullscreen.vert", "shaders/texture_report.frag");
+	copy.use();
+	copy.setInt("image", 0);
+	copy.setFloat("repeat", 1.0f);
+	glBindVertexArray(VAO);
+	glActiveTexture(GL_TEXTURE0);
+	for (size_t i = 0; i < textures.size(); i++) {
+		glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, this->m_textureArray, 0, (GLint)i + 1);
+		glBindTexture(GL_TEXTURE_2D, textures[i]);
+		glDrawArrays(GL_TRIANGLES, 0, 3);
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glBindVertexArray(0);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, previousFBO);
+	glDeleteFramebuffers(1, &FBO);
+	glDeleteVertexArrays(1, &VAO);
+	glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+	glClearColor(clearColor[0], clearColor[1], clearColor[2], clearColor[3]);
+	if (blend) glEnable(GL_BLEND);
+	if (depthTest) glEnable(GL_DEPTH_TEST);
+	if (cullFace) glEnable(GL_CULL_FACE);
+	if (Utils::instance().shader) Utils::instance().shader->use();
+
+	glBindTexture(GL_TEXTURE_2D_ARRAY, this->m_textureArray);
+	glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+void StaticBatch::free() {
+	for (const Group& group : this->m_groups) {
+		glDeleteVertexArrays(1, &group.VAO);
+		glDeleteBuffers(1, &group.VBO);
+		glDeleteBuffers(1, &group.slotVBO);
+		glDeleteBuffers(1, &group.EBO);
+	}
+	if (this->m_textureArray != 0) glDeleteTextures(1, &this->m_textureArray);
+	if (this->m_indirectBuffer != 0) glDeleteBuffers(1, &this->m_indirectBuffer);
+	this->m_textureArray = this->m_indirectBuffer = 0;
+	this->m_groups.clear();
+	this->m_parts.clear();
+	this->m_modelParts.clear();
+	this->m_TMs.clear();
+	this->m_queued.clear();
+}
+
+bool StaticBatch::contains(int model) const {
+	return model >= 0 && model < (int)this->m_modelParts.size() && !this->m_modelParts[model].empty();
+}
+
+void StaticBatch::add(int model, const Frustum& frustum, int lod) {
+	const std::vector<int>& parts = this->m_modelParts[model];
+	for (int index : parts) {
+		const Part& part = this->m_parts[index];
+		// a model of one mesh was already tested as a whole by the caller, like Model::draw(frustum)
+		if (parts.size() > 1 && !frustum.isVisible(part.bounds)) continue;
+		const int level = std::clamp(lod, 0, part.numLods - 1);
+		this->m_queued.push_back({ part.group, part.firstIndex[level], part.count[level] });
+		LodSelector::get().countTriangles(part.count[level] / 3, part.count[0] / 3);
+	}
+}
+
+bool StaticBatch::hasQueued() const {
+	return !this->m_queued.empty();
+}
+
+int StaticBatch::flush(const ShaderProgram& program) {
+	if (this->m_queued.empty()) return 0;
+
+	// in buffer order, so ranges that are next to each other in an EBO become one
+	std::sort(this->m_queued.begin(), this->m_queued.end());
+	this->m_commands.clear();
+	this->m_groupCommands.assign(this->m_groups.size(), 0);
+	int lastGroup = -1;
+	const GLuint views = (GLuint)Utils::instance().numViews; // instances, see Utils::numViews
+	for (const Range& range : this->m_queued) {
+		DrawCommand* last = this->m_commands.empty() ? nullptr : &this->m_commands.back();
+		if (last != nullptr && lastGroup == range.group && last->firstIndex + last->count == range.firstIndex) {
+			last->count += range.count;
+			continue;
+		}
+		this->m_commands.push_back({ (GLuint)range.count, views, range.firstIndex, 0, 0 });
+		this->m_groupCommands[range.group]++;
+		lastGroup = range.group;
+	}
+	this->m_queued.clear();
+
+	glUniformMatrix4fv(program.getUniformLocation("slotTM"), (GLsizei)this->m_TMs.size(), GL_FALSE, &this->m_TMs[0][0][0]);
+	glActiveTexture(GL_TEXTURE0 + TEXTURE_UNIT);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, this->m_textureArray);
+	glActiveTexture(GL_TEXTURE0);
+	glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+
+	const bool indirect = GLEW_ARB_multi_draw_indirect;
+	if (indirect) {
+		if (this->m_indirectBuffer == 0) glGenBuffers(1, &this->m_indirectBuffer);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, this->m_indirectBuffer);
+		glBufferData(GL_DRAW_INDIRECT_BUFFER, this->m_commands.size() * sizeof(DrawCommand), this->m_commands.data(), GL_STREAM_DRAW);
+	}
+
+	int draws = 0;
+	size_t first = 0;
+	for (size_t g = 0; g < this->m_groups.size(); g++) {
+		const int count = this->m_groupCommands[g];
+		if (count == 0) continue;
+		glBindVertexArray(this->m_groups[g].VAO);
+		if (indirect) {
+			glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (const void*)(first * sizeof(DrawCommand)), count, 0);
+		} else if (views > 1) {
+			// there is no instanced glMultiDrawElements
+			for (size_t c = first; c < first + count; c++) {
+				glDrawElementsInstanced(GL_TRIANGLES, (GLsizei)this->m_commands[c].count, GL_UNSIGNED_INT, (const void*)(this->m_commands[c].firstIndex * sizeof(unsigned int)), views);
+			}
+		} else {
+			this->m_counts.clear();
+			this->m_offsets.clear();
+			for (size_t c = first; c < first + count; c++) {
+				this->m_counts.push_back((GLsizei)this->m_commands[c].count);
+				this->m_offsets.push_back((const void*)(this->m_commands[c].firstIndex * sizeof(unsigned int)));
+			}
+			glMultiDrawElements(GL_TRIANGLES, this->m_counts.data(), GL_UNSIGNED_INT, this->m_offsets.data(), count);
+		}
+		first += count;
+		draws++;
+	}
+
+	if (indirect) glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	glBindVertexArray(0);
+	return draws;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <GL/glew.h>
+#include "glm/glm.hpp"
+
+#include <vector>
+
+#include "Bounds.h"
+#include "Model.h"
+#include "ShaderProgram.h"
+
+// The static world merged into one vertex and index buffer per vertex layout, drawn with one multi-draw
+// per layout instead of a draw per mesh. Every vertex carries its model's slot (the model matrix comes
+// from slotTM[] in the shader) and the layer of its diffuse texture in one texture array, so nothing is
+// bound between meshes. Uses glMultiDrawElementsIndirect where the driver has ARB_multi_draw_indirect and
+// glMultiDrawElements on plain GL 3.3, the same ranges either way.
+// Geometry and textures are copied on the GPU from the models' own buffers, the models keep theirs.
+class StaticBatch {
+
+public:
+	static constexpr int MAX_MODELS = 16; // slotTM[] in static.vert and staticDepth.vert
+	static constexpr unsigned int SLOT_LOCATION = 11; // uvec2 (model, texture layer) per vertex
+	static constexpr int LAYER_SIZE = 256; // every texture is resized to this in the array
+	static constexpr unsigned int TEXTURE_UNIT = 3; // "staticTextures", after the shadow maps
+
+	~StaticBatch();
+
+	// merges the meshes of models as they are placed now. models past MAX_MODELS or drawn as anything
+	// but GL_FILL are left out, see contains(). GL thread.
+	void build(const std::vector<Model*>& models);
+	void free();
+	// model is the index in the vector build() was given
+	bool contains(int model) const;
+
+	// queues the meshes of model the frustum touches, at level of detail lod (see Mesh::draw)
+	void add(int model, const Frustum& frustum, int lod = 0);
+	bool hasQueued() const;
+	// draws what was queued since the last flush with program, which has to be in use, and forgets it.
+	// returns the number of draw commands that took.
+	int flush(const ShaderProgram& program);
+
+private:
+	struct Part { // one mesh
+		int group;
+		int numLods;
+		GLuint firstIndex[Mesh::MAX_LODS];
+		GLsizei count[Mesh::MAX_LODS];
+		AABB bounds; // world space
+	};
+
+	struct Range {
+		int group;
+		GLuint firstIndex;
+		GLsizei count;
+		bool operator<(const Range& other) const { return group != other.group ? group < other.group : firstIndex < other.firstIndex; }
+	};
+
+	struct Group { // every mesh of one vertex layout
+		GLuint VAO = 0, VBO = 0, slotVBO = 0, EBO = 0;
+	};
+
+	// what glMultiDrawElementsIndirect reads
+	struct DrawCommand {
+		GLuint count;
+		GLuint instanceCount;
+		GLuint firstIndex;
+		GLuint baseVertex;
+		GLuint baseInstance;
+	};
+
+	// the diffuse textures, resized into layers 1.. of m_textureArray. layer 0 is white for meshes without one
+	void buildTextureArray(const std::vector<GLuint>& textures);
+
+	std::vector<Group> m_groups;
+	// by group. an EBO holds every part's full detail, then every part's level 1 and so on, so parts
+	// next to each other at the same level are next to each other in it
+	std::vector<Part> m_parts;
+	std::vector<std::vector<int>> m_modelParts; // per model, empty when it was left out
+	std::vector<glm::mat4> m_TMs;
+	GLuint m_textureArray = 0;
+	GLuint m_indirectBuffer = 0;
+
+	std::vector<Range> m_queued;
+	std::vector<DrawCommand> m_commands;
+	std::vector<int> m_groupCommands; // commands per group, in m_commands order
+	std::vector<GLsizei> m_counts;
+	std::vector<const void*> m_offsets;
+};
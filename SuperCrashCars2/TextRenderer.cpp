@@ -1,136 +1,198 @@
 #include "TextRenderer.h"
 
-TextRenderer::TextRenderer(unsigned int width, unsigned int height) : TextShader("shaders/text.vert", "shaders/text.frag") {
-    // load and configure shader
-    TextShader.use();
-    TextShader.setMat4("projection", glm::ortho(0.0f, static_cast<float>(width), static_cast<float>(height), 0.0f));
-    TextShader.setInt("text", 0);
+#include "AssetLoader.h"
+#include "Log.h"
+
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+    constexpr int ATLAS_SIZE = 2048; // R8, fits the menu and boost fonts with room to spare
+    constexpr int GLYPH_PADDING = 1; // empty texels between glyphs so linear filtering doesn't bleed
+    constexpr int FLOATS_PER_VERTEX = 7; // pos, tex, color
+
+    // GL state every TextRenderer shares: the shader, the glyph atlas and the quads queued this frame
+    struct TextBatch {
+        TextBatch() : Shader("shaders/text.vert", "shaders/text.frag")
+        {
+            Shader.use();
+            Shader.setInt("text", 0);
+
+            // start the atlas out empty, the padding around each glyph has to read as 0
+            const std::vector<unsigned char> empty((size_t)ATLAS_SIZE * ATLAS_SIZE, 0);
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+            glGenTextures(1, &Atlas);
+            glBindTexture(GL_TEXTURE_2D, Atlas);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, ATLAS_SIZE, ATLAS_SIZE, 0, GL_RED, GL_UNSIGNED_BYTE, empty.data());
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glBindTexture(GL_TEXTURE_2D, 0);
+
+            glGenVertexArrays(1, &VAO);
+            glGenBuffers(1, &VBO);
+            glBindVertexArray(VAO);
+            glBindBuffer(GL_ARRAY_BUFFER, VBO);
+            glEnableVertexAttribArray(0);
+            glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, FLOATS_PER_VERTEX * sizeof(float), 0);
+            glEnableVertexAttribArray(1);
+            glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, FLOATS_PER_VERTEX * sizeof(float), (void*)(4 * sizeof(float)));
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            glBindVertexArray(0);
+        }
+
+        // a glyph's spot in the atlas, shelf by shelf from the top left. false once it's full
+        bool Place(int width, int height, int& x, int& y)
+        {
+            if (ShelfX + width + GLYPH_PADDING > ATLAS_SIZE)
+            {
+                ShelfX = 0;
+                ShelfY += ShelfHeight + GLYPH_PADDING;
+                ShelfHeight = 0;
+            }
+            if (width + GLYPH_PADDING > ATLAS_SIZE || ShelfY + height + GLYPH_PADDING > ATLAS_SIZE) return false;
+            x = ShelfX + GLYPH_PADDING;
+            y = ShelfY + GLYPH_PADDING;
+            ShelfX += width + GLYPH_PADDING;
+            ShelfHeight = std::max(ShelfHeight, height);
+            return true;
+        }
+
+        ShaderProgram Shader;
+        unsigned int Atlas = 0, VAO = 0, VBO = 0;
+        int ShelfX = 0, ShelfY = 0, ShelfHeight = 0;
+        // fonts already in the atlas by "path|size", loading one twice reuses its glyphs
+        std::unordered_map<std::string, std::array<Character, 128>> Fonts;
+        std::vector<float> Vertices;
+    };
+
+    TextBatch& batch()
+    {
+        static TextBatch shared;
+        return shared;
+    }
+}
+
+TextRenderer::TextRenderer(unsigned int width, unsigned int height) {
+    // configure the shared shader, every renderer draws to the same screen size
+    TextBatch& shared = batch();
+    shared.Shader.use();
+    shared.Shader.setMat4("projection", glm::ortho(0.0f, static_cast<float>(width), static_cast<float>(height), 0.0f));
 
     totalW = 0;
     totalH = 0;
 
-    // configure VAO/VBO for texture quads
     glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-    glBindVertexArray(VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 6 * 4, NULL, GL_DYNAMIC_DRAW);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), 0);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
 }
 
-void TextRenderer::Load(std::string font, unsigned int fontSize)
+void TextRenderer::Load(const std::string& font, unsigned int fontSize)
 {
-    // first clear the previously loaded Characters
-    Characters.clear();
-    // then initialize and load the FreeType library
-    FT_Library ft;
-    if (FT_Init_FreeType(&ft)) // all functions return a value different than 0 whenever an error occurred
-        std::cout << "ERROR::FREETYPE: Could not init FreeType Library" << std::endl;
-    // load font as face
-    FT_Face face;
-    if (FT_New_Face(ft, font.c_str(), 0, &face))
-        std::cout << "ERROR::FREETYPE: Failed to load font" << std::endl;
-    // set size to load glyphs as
-    FT_Set_Pixel_Sizes(face, 0, fontSize);
-    // disable byte-alignment restriction
-    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-    // then for the first 128 ASCII characters, pre-load/compile their characters and store them
-    for (GLubyte c = 0; c < 128; c++) // lol see what I did there 
+    TextBatch& shared = batch();
+    const std::string key = font + "|" + std::to_string(fontSize);
+    auto packed = shared.Fonts.find(key);
+    if (packed == shared.Fonts.end())
     {
-        // load character glyph 
-        if (FT_Load_Char(face, c, FT_LOAD_RENDER))
+        // glyphs rendered with FreeType on a loader worker if the font was requested there, otherwise here
+        std::vector<GlyphBitmap> rasterized;
+        const std::vector<GlyphBitmap>* glyphs = AssetLoader::get().findFont(font, fontSize);
+        if (glyphs == nullptr)
+        {
+            rasterized = AssetLoader::rasterize(font, fontSize);
+            glyphs = &rasterized;
+        }
+        // disable byte-alignment restriction
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glBindTexture(GL_TEXTURE_2D, shared.Atlas);
+        std::array<Character, 128> characters{};
+        // then for the first 128 ASCII characters, copy their glyphs into the atlas and store them
+        for (GLubyte c = 0; c < 128; c++) // lol see what I did there 
         {
-            std::cout << "ERROR::FREETYTPE: Failed to load Glyph" << std::endl;
-            continue;
+            const GlyphBitmap& glyph = (*glyphs)[c];
+            int x = 0, y = 0;
+            glm::ivec2 size(glyph.width, glyph.rows);
+            if (!glyph.pixels.empty())
+            {
+                if (shared.Place(glyph.width, glyph.rows, x, y))
+                    glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, glyph.width, glyph.rows, GL_RED, GL_UNSIGNED_BYTE, glyph.pixels.data());
+                else
+                {
+                    Log::warning("Glyph atlas is full, '{}' of {} at {} px won't draw", (char)c, font, fontSize);
+                    size = glm::ivec2(0);
+                }
+            }
+            characters[c] = {
+                glm::vec2(x, y) / (float)ATLAS_SIZE,
+                glm::vec2(x + size.x, y + size.y) / (float)ATLAS_SIZE,
+                size,
+                glm::ivec2(glyph.left, glyph.top),
+                glyph.advance
+            };
         }
-        // generate texture
-        unsigned int texture;
-        glGenTextures(1, &texture);
-        glBindTexture(GL_TEXTURE_2D, texture);
-        glTexImage2D(
-            GL_TEXTURE_2D,
-            0,
-            GL_RED,
-            face->glyph->bitmap.width,
-            face->glyph->bitmap.rows,
-            0,
-            GL_RED,
-            GL_UNSIGNED_BYTE,
-            face->glyph->bitmap.buffer
-        );
-        // set texture options
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        // now store character for later use
-        Character character = {
-            texture,
-            glm::ivec2(face->glyph->bitmap.width, face->glyph->bitmap.rows),
-            glm::ivec2(face->glyph->bitmap_left, face->glyph->bitmap_top),
-            face->glyph->advance.x
-        };
-        Characters.insert(std::pair<char, Character>(c, character));
+        glBindTexture(GL_TEXTURE_2D, 0);
+        packed = shared.Fonts.emplace(key, characters).first;
     }
-    glBindTexture(GL_TEXTURE_2D, 0);
-    // destroy FreeType once we're finished
-    FT_Done_Face(face);
-    FT_Done_FreeType(ft);
+    Characters = packed->second;
+    CapBearing = Characters['H'].Bearing.y;
 }
 
-void TextRenderer::RenderText(std::string text, float x, float y, float scale, glm::vec3 color)
+void TextRenderer::RenderText(std::string_view text, float x, float y, float scale, glm::vec3 color)
 {
     float totalWidth = 0;
     float totalHeight = 0;
-    // activate corresponding render state	
-    TextShader.use();
-    TextShader.setVector3("textColor", color);
-    glActiveTexture(GL_TEXTURE0);
-    glBindVertexArray(VAO);
+    std::vector<float>& vertices = batch().Vertices;
+    vertices.reserve(vertices.size() + text.size() * 6 * FLOATS_PER_VERTEX);
+    auto vertex = [&](float px, float py, float u, float v) {
+        vertices.insert(vertices.end(), { px, py, u, v, color.r, color.g, color.b });
+    };
 
     // iterate through all characters
-    std::string::const_iterator c;
-    for (c = text.begin(); c != text.end(); c++)
+    for (char c : text)
     {
-        Character ch = Characters[*c];
+        if ((unsigned char)c >= Characters.size()) continue;
+        const Character& ch = Characters[(unsigned char)c];
 
         float xpos = x + ch.Bearing.x * scale;
-        float ypos = y + (Characters['H'].Bearing.y - ch.Bearing.y) * scale;
+        float ypos = y + (CapBearing - ch.Bearing.y) * scale;
 
         float w = ch.Size.x * scale;
         float h = ch.Size.y * scale;
         totalWidth += w;
         totalHeight = h;
-        // update VBO for each character
-        float vertices[6][4] = {
-            { xpos,     ypos + h,   0.0f, 1.0f },
-            { xpos + w, ypos,       1.0f, 0.0f },
-            { xpos,     ypos,       0.0f, 0.0f },
-
-            { xpos,     ypos + h,   0.0f, 1.0f },
-            { xpos + w, ypos + h,   1.0f, 1.0f },
-            { xpos + w, ypos,       1.0f, 0.0f }
-        };
-        // render glyph texture over quad
-        glBindTexture(GL_TEXTURE_2D, ch.TextureID);
-        // update content of VBO memory
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(vertices), vertices); // be sure to use glBufferSubData and not glBufferData
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-        // render quad
-        glDrawArrays(GL_TRIANGLES, 0, 6);
+        if (ch.Size.x > 0 && ch.Size.y > 0)
+        {
+            vertex(xpos,     ypos + h, ch.UvMin.x, ch.UvMax.y);
+            vertex(xpos + w, ypos,     ch.UvMax.x, ch.UvMin.y);
+            vertex(xpos,     ypos,     ch.UvMin.x, ch.UvMin.y);
+
+            vertex(xpos,     ypos + h, ch.UvMin.x, ch.UvMax.y);
+            vertex(xpos + w, ypos + h, ch.UvMax.x, ch.UvMax.y);
+            vertex(xpos + w, ypos,     ch.UvMax.x, ch.UvMin.y);
+        }
         // now advance cursors for next glyph
         x += (ch.Advance >> 6) * scale; // bitshift by 6 to get value in pixels (1/64th times 2^6 = 64)
     }
     totalW = totalWidth;
     totalH = totalHeight;
+}
+
+void TextRenderer::Flush()
+{
+    TextBatch& shared = batch();
+    if (shared.Vertices.empty()) return;
+
+    shared.Shader.use();
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, shared.Atlas);
+    glBindVertexArray(shared.VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, shared.VBO);
+    // respecifying the whole buffer orphans the last flush's storage, so the driver never waits on it
+    glBufferData(GL_ARRAY_BUFFER, shared.Vertices.size() * sizeof(float), shared.Vertices.data(), GL_STREAM_DRAW);
+    glDrawArrays(GL_TRIANGLES, 0, (GLsizei)(shared.Vertices.size() / FLOATS_PER_VERTEX));
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindVertexArray(0);
     glBindTexture(GL_TEXTURE_2D, 0);
+    shared.Vertices.clear();
 }
-
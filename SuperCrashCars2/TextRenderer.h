@@ -3,8 +3,10 @@
 #ifndef TEXT_RENDERER_H
 #define TEXT_RENDERER_H
 
-#include <map>
+#include <array>
 #include <iostream>
+#include <string>
+#include <string_view>
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 
@@ -18,7 +20,8 @@
 
 /// Holds all state information relevant to a character as loaded using FreeType
 struct Character {
-    unsigned int TextureID; // ID handle of the glyph texture
+    glm::vec2    UvMin;     // top left of the glyph in the shared atlas
+    glm::vec2    UvMax;     // bottom right of the glyph in the shared atlas
     glm::ivec2   Size;      // size of glyph
     glm::ivec2   Bearing;   // offset from baseline to left/top of glyph
     unsigned int Advance;   // horizontal offset to advance to next glyph
@@ -28,23 +31,27 @@ struct Character {
 // A renderer class for rendering text displayed by a font loaded using the 
 // FreeType library. A single font is loaded, processed into a list of Character
 // items for later rendering.
+// Every font's glyphs are packed into one atlas texture shared by all TextRenderers,
+// and RenderText only queues quads; Flush() draws everything queued in one call.
 class TextRenderer
 {
 public:
-    // holds a list of pre-compiled Characters
-    std::map<char, Character> Characters;
+    // holds a list of pre-compiled Characters, indexed by ASCII code
+    std::array<Character, 128> Characters{};
 
     // size of printed text
     float totalW, totalH;
-    // shader used for text rendering
-    ShaderProgram TextShader;
     TextRenderer(unsigned int width, unsigned int height);    
     ~TextRenderer() {};
-    void Load(std::string font, unsigned int fontSize);
-    void RenderText(std::string text, float x, float y, float scale, glm::vec3 color);
+    void Load(const std::string& font, unsigned int fontSize);
+    // queues the quads, nothing is drawn until Flush(). totalW/totalH are up to date right away
+    void RenderText(std::string_view text, float x, float y, float scale, glm::vec3 color);
+    // draws the text queued by every TextRenderer since the last flush. call before the viewport
+    // changes and before anything that has to cover the text
+    static void Flush();
 private:
-    // render state
-    unsigned int VAO, VBO;
+    // the bearing of 'H', every glyph lines up with its top
+    int CapBearing = 0;
 };
 
 #endif 
@@ -2,17 +2,25 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
+#include "AssetLoader.h"
+
 #include <iostream>
 Texture::Texture() {}
 
 Texture::Texture(std::string path, GLint interpolation)
 	: textureID(), path(path), interpolation(interpolation)
 {
-	int numComponents;
-	stbi_set_flip_vertically_on_load(true);
-	const char* pathData = path.c_str();
-	unsigned char* data = stbi_load(pathData, &width, &height, &numComponents, 0);
-	if (data != nullptr)
+	// decoded on a loader worker if it was requested there
+	DecodedImage decoded;
+	const DecodedImage* image = AssetLoader::get().findImage(path, true);
+	if (image == nullptr) {
+		decoded = AssetLoader::decode(path, true);
+		image = &decoded;
+	}
+	width = image->width;
+	height = image->height;
+	int numComponents = image->components;
+	if (image->valid())
 	{
 		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);		//Set alignment to be 1
 
@@ -39,17 +47,18 @@ Texture::Texture(std::string path, GLint interpolation)
 			break;
 		};
 		//Loads texture data into bound texture
-		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
+		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, image->pixels.data());
+		glGenerateMipmap(GL_TEXTURE_2D);
 
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, interpolation);
+		// anything drawn smaller than its image minifies from the mips
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, interpolation == GL_NEAREST ? GL_NEAREST_MIPMAP_NEAREST : GL_LINEAR_MIPMAP_LINEAR);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, interpolation);
 
 		// Clean up
 		unbind();
 		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);	//Return to default alignment
-		stbi_image_free(data);
 
 	}
 	else {
@@ -26,6 +26,7 @@ public:
 	// Although uint (i.e. uvec2) might make more sense here, went with int (i.e. ivec2) under
 	// the assumption that most students will want to work with ints, not uints, in main.cpp
 	glm::ivec2 getDimensions() const { return glm::uvec2(width, height); }
+	GLuint getID() const { return textureID; }
 
 	void bind() { glBindTexture(GL_TEXTURE_2D, textureID); }
 	void unbind() { glBindTexture(GL_TEXTURE_2D, textureID); }
@@ -0,0 +1,249 @@
+#include "TextureCache.h"
+
+#include "AssetLoader.h"
+#include "Log.h"
+
+#define STB_DXT_IMPLEMENTATION
+#include <stb_dxt.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace {
+	uint64_t hashBytes(const void* data, size_t size, uint64_t hash) {
+		const unsigned char* bytes = (const unsigned char*)data;
+		for (size_t i = 0; i < size; i++) {
+			hash ^= bytes[i];
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	bool readFile(const std::string& path, std::vector<unsigned char>& data) {
+		std::ifstream file(path, std::ios::binary | std::ios::ate);
+		if (!file) return false;
+		data.resize((size_t)file.tellg());
+		file.seekg(0);
+		file.read((char*)data.data(), data.size());
+		return (bool)file;
+	}
+
+	// any channel count to RGBA, what stb_dxt reads
+	std::vector<unsigned char> toRGBA(const DecodedImage& image) {
+		std::vector<unsigned char> rgba((size_t)image.width * image.height * 4);
+		for (size_t i = 0; i < (size_t)image.width * image.height; i++) {
+			const unsigned char* source = &image.pixels[i * image.components];
+			unsigned char* pixel = &rgba[i * 4];
+			switch (image.components) {
+			case 1: pixel[0] = pixel[1] = pixel[2] = source[0]; pixel[3] = 255; break;
+			case 2: pixel[0] = source[0]; pixel[1] = source[1]; pixel[2] = 0; pixel[3] = 255; break; // uploaded as GL_RG
+			case 3: pixel[0] = source[0]; pixel[1] = source[1]; pixel[2] = source[2]; pixel[3] = 255; break;
+			default: std::memcpy(pixel, source, 4); break;
+			}
+		}
+		return rgba;
+	}
+
+	// half the size with a 2x2 box filter, an odd last row or column is averaged with itself
+	std::vector<unsigned char> downsample(const std::vector<unsigned char>& rgba, int width, int height, int& outWidth, int& outHeight) {
+		outWidth = std::max(width / 2, 1);
+		outHeight = std::max(height / 2, 1);
+		std::vector<unsigned char> out((size_t)outWidth * outHeight * 4);
+		for (int y = 0; y < outHeight; y++) {
+			const int y0 = std::min(y * 2, height - 1), y1 = std::min(y * 2 + 1, height - 1);
+			for (int x = 0; x < outWidth; x++) {
+				const int x0 = std::min(x * 2, width - 1), x1 = std::min(x * 2 + 1, width - 1);
+				for (int c = 0; c < 4; c++) {
+					const int sum = rgba[((size_t)y0 * width + x0) * 4 + c] + rgba[((size_t)y0 * width + x1) * 4 + c]
+						+ rgba[((size_t)y1 * width + x0) * 4 + c] + rgba[((size_t)y1 * width + x1) * 4 + c];
+					out[((size_t)y * outWidth + x) * 4 + c] = (unsigned char)((sum + 2) / 4);
+				}
+			}
+		}
+		return out;
+	}
+
+	// one level into 4x4 blocks, edge pixels repeat into blocks that hang over the border
+	std::vector<unsigned char> compressLevel(const std::vector<unsigned char>& rgba, int width, int height, bool alpha) {
+		const int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+		const size_t blockBytes = alpha ? 16 : 8;
+		std::vector<unsigned char> out(blocksX * blocksY * blockBytes);
+		unsigned char block[16 * 4];
+		for (int by = 0; by < blocksY; by++) {
+			for (int bx = 0; bx < blocksX; bx++) {
+				for (int y = 0; y < 4; y++) {
+					const int sy = std::min(by * 4 + y, height - 1);
+					for (int x = 0; x < 4; x++) {
+						const int sx = std::min(bx * 4 + x, width - 1);
+						std::memcpy(&block[(y * 4 + x) * 4], &rgba[((size_t)sy * width + sx) * 4], 4);
+					}
+				}
+				stb_compress_dxt_block(&out[(by * blocksX + bx) * blockBytes], block, alpha ? 1 : 0, STB_DXT_HIGHQUAL);
+			}
+		}
+		return out;
+	}
+}
+
+size_t CompressedImage::bytes() const {
+	size_t total = 0;
+	for (const std::vector<unsigned char>& level : this->levels) total += level.size();
+	return total;
+}
+
+void TextureCache::setEnabled(bool enabled) {
+	this->m_enabled = enabled;
+}
+
+bool TextureCache::isEnabled() const {
+	return this->m_enabled;
+}
+
+CompressedImage TextureCache::load(const std::string& path, bool flip) {
+	const auto start = std::chrono::steady_clock::now();
+	CompressedImage image;
+
+	std::vector<unsigned char> file;
+	if (!readFile(path, file)) return image;
+	uint64_t hash = hashBytes(&VERSION, sizeof(VERSION), 14695981039346656037ull);
+	hash = hashBytes(&flip, sizeof(flip), hash);
+	hash = hashBytes(file.data(), file.size(), hash);
+	const std::string cachePath = this->pathFor(hash);
+
+	if (this->read(cachePath, image)) {
+		this->addTime(true, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+		return image;
+	}
+
+	const DecodedImage decoded = AssetLoader::decode(file.data(), file.size(), flip);
+	if (!decoded.valid()) return image;
+	image = compress(decoded);
+	this->write(cachePath, image);
+	this->addTime(false, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+	return image;
+}
+
+CompressedImage TextureCache::compress(const DecodedImage& image) {
+	CompressedImage compressed;
+	if (!image.valid()) return compressed;
+
+	std::vector<unsigned char> rgba = toRGBA(image);
+	bool alpha = false;
+	for (size_t i = 3; i < rgba.size() && !alpha; i += 4) alpha = rgba[i] < 255;
+
+	compressed.format = alpha ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+	compressed.width = image.width;
+	compressed.height = image.height;
+	int width = image.width, height = image.height;
+	while (true) {
+		compressed.levels.push_back(compressLevel(rgba, width, height, alpha));
+		if (width == 1 && height == 1) break;
+		rgba = downsample(rgba, width, height, width, height);
+	}
+	return compressed;
+}
+
+void TextureCache::upload(const CompressedImage& image) {
+	int width = image.width, height = image.height;
+	for (size_t level = 0; level < image.levels.size(); level++) {
+		glCompressedTexImage2D(GL_TEXTURE_2D, (GLint)level, image.format, width, height, 0, (GLsizei)image.levels[level].size(), image.levels[level].data());
+		width = std::max(width / 2, 1);
+		height = std::max(height / 2, 1);
+	}
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)image.levels.size() - 1);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+}
+
+size_t TextureCache::uncompressedBytes(const DecodedImage& image, bool mipmapped) {
+	// drivers keep 3 channel textures as 4
+	const size_t texel = image.components == 3 ? 4 : image.components;
+	size_t total = 0;
+	int width = image.width, height = image.height;
+	while (true) {
+		total += (size_t)width * height * texel;
+		if (!mipmapped || (width == 1 && height == 1)) break;
+		width = std::max(width / 2, 1);
+		height = std::max(height / 2, 1);
+	}
+	return total;
+}
+
+void TextureCache::logStats() const {
+	std::lock_guard<std::mutex> lock(this->m_mutex);
+	Log::info("Texture cache: {} textures loaded in {:.1f} ms, {} compressed in {:.1f} ms", this->m_hits, this->m_hitSeconds * 1000.0, this->m_misses, this->m_missSeconds * 1000.0);
+}
+
+std::string TextureCache::pathFor(uint64_t hash) const {
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx", (unsigned long long)hash);
+	return std::string(DIRECTORY) + "/" + name + ".bct";
+}
+
+// magic, version, format, width, height, level count, then every level's size and blocks
+bool TextureCache::read(const std::string& path, CompressedImage& image) const {
+	std::vector<unsigned char> data;
+	if (!readFile(path, data)) return false;
+
+	size_t cursor = 0;
+	auto take = [&](void* out, size_t size) {
+		if (cursor + size > data.size()) return false;
+		std::memcpy(out, &data[cursor], size);
+		cursor += size;
+		return true;
+	};
+	uint32_t header[6] = {};
+	if (!take(header, sizeof(header)) || header[0] != MAGIC || header[1] != VERSION) return false;
+	image.format = header[2];
+	image.width = (int)header[3];
+	image.height = (int)header[4];
+	image.levels.resize(header[5]);
+	for (std::vector<unsigned char>& level : image.levels) {
+		uint32_t size = 0;
+		if (!take(&size, sizeof(size)) || cursor + size > data.size()) {
+			image.levels.clear();
+			return false;
+		}
+		level.assign(data.begin() + cursor, data.begin() + cursor + size);
+		cursor += size;
+	}
+	return image.valid();
+}
+
+void TextureCache::write(const std::string& path, const CompressedImage& image) const {
+	std::error_code error;
+	std::filesystem::create_directories(DIRECTORY, error);
+	// write then rename, so a crash never leaves half a texture under the real name
+	const std::string temporary = path + ".tmp";
+	{
+		std::ofstream file(temporary, std::ios::binary);
+		const uint32_t header[6] = { MAGIC, VERSION, image.format, (uint32_t)image.width, (uint32_t)image.height, (uint32_t)image.levels.size() };
+		file.write((const char*)header, sizeof(header));
+		for (const std::vector<unsigned char>& level : image.levels) {
+			const uint32_t size = (uint32_t)level.size();
+			file.write((const char*)&size, sizeof(size));
+			file.write((const char*)level.data(), level.size());
+		}
+		if (!file) {
+			Log::warning("Could not write compressed texture {}", path);
+			return;
+		}
+	}
+	std::filesystem::rename(temporary, path, error);
+	if (error) std::filesystem::remove(temporary, error);
+}
+
+void TextureCache::addTime(bool hit, double seconds) {
+	std::lock_guard<std::mutex> lock(this->m_mutex);
+	if (hit) {
+		this->m_hits++;
+		this->m_hitSeconds += seconds;
+	} else {
+		this->m_misses++;
+		this->m_missSeconds += seconds;
+	}
+}
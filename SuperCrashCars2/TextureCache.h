@@ -0,0 +1,79 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// pixels of an image file as stb_image decodes them, flipped already if asked to
+struct DecodedImage {
+	std::vector<unsigned char> pixels;
+	int width = 0;
+	int height = 0;
+	int components = 0;
+
+	bool valid() const { return !pixels.empty(); }
+};
+
+// a block compressed texture with its whole mip chain, ready for glCompressedTexImage2D
+struct CompressedImage {
+	GLenum format = 0; // GL_COMPRESSED_RGB_S3TC_DXT1_EXT (BC1) or GL_COMPRESSED_RGBA_S3TC_DXT5_EXT (BC3)
+	int width = 0;
+	int height = 0;
+	std::vector<std::vector<unsigned char>> levels; // level 0 first, down to 1x1
+
+	bool valid() const { return !levels.empty(); }
+	size_t bytes() const;
+};
+
+// Model textures compressed to BC1 (opaque) or BC3 (with alpha) with stb_dxt, mip chain included,
+// and kept on disk under DIRECTORY so only the first launch after a texture changes pays for it.
+// A cached texture is keyed by a hash of the image file's bytes, the flip and the encoder version.
+// Off until main turns it on for a driver with S3TC; the registry then uploads these instead of
+// raw RGB(A).
+class TextureCache {
+
+public:
+	static TextureCache& get() { static TextureCache shared; return shared; }
+
+	static constexpr const char* DIRECTORY = "cache/textures";
+
+	void setEnabled(bool enabled);
+	bool isEnabled() const;
+
+	// the compressed texture of an image file, from the cache or compressed and written now.
+	// invalid if the file doesn't decode. safe on any thread.
+	CompressedImage load(const std::string& path, bool flip);
+
+	// builds the mip chain with a box filter and compresses every level
+	static CompressedImage compress(const DecodedImage& image);
+	// every level into the texture bound to GL_TEXTURE_2D, with trilinear filtering
+	static void upload(const CompressedImage& image);
+	// what the same image takes uncompressed, with or without a full mip chain
+	static size_t uncompressedBytes(const DecodedImage& image, bool mipmapped);
+
+	// cache hits, misses and the time spent on either
+	void logStats() const;
+
+private:
+	TextureCache() {}
+
+	static constexpr uint32_t MAGIC = 0x54434353; // "SCCT"
+	static constexpr uint32_t VERSION = 1; // bump when the encoder or the mip filter changes
+
+	std::string pathFor(uint64_t hash) const;
+	bool read(const std::string& path, CompressedImage& image) const;
+	void write(const std::string& path, const CompressedImage& image) const;
+	void addTime(bool hit, double seconds);
+
+	std::atomic<bool> m_enabled{ false };
+
+	mutable std::mutex m_mutex;
+	int m_hits = 0;
+	int m_misses = 0;
+	double m_hitSeconds = 0.0;
+	double m_missSeconds = 0.0;
+};
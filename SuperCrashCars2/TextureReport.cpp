@@ -0,0 +1,163 @@
+#include "TextureReport.h"
+
+#include "AssetLoader.h"
+#include "AssetRegistry.h"
+#include "Log.h"
+#include "ShaderProgram.h"
+
+#include <GL/glew.h>
+
+#include <algorithm>
+#include <chrono>
+
+namespace {
+	// offscreen, so the numbers don't depend on the window
+	constexpr int WIDTH = 1920;
+	constexpr int HEIGHT = 1080;
+	constexpr int PASSES = 50;
+	constexpr float FAR_REPEAT = 16.f; // a 1024 texture ends up ~8 texels per pixel, like the ground near the horizon
+
+	GLuint uploadRaw(const DecodedImage& image, bool mipmapped) {
+		const GLenum formats[] = { GL_RED, GL_RED, GL_RG, GL_RGB, GL_RGBA };
+		const GLenum format = formats[std::clamp(image.components, 1, 4)];
+		GLuint texture;
+		glGenTextures(1, &texture);
+		glBindTexture(GL_TEXTURE_2D, texture);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glTexImage2D(GL_TEXTURE_2D, 0, format, image.width, image.height, 0, format, GL_UNSIGNED_BYTE, image.pixels.data());
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		if (mipmapped) glGenerateMipmap(GL_TEXTURE_2D);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, mipmapped ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		return texture;
+	}
+
+	GLuint uploadCompressed(const CompressedImage& image) {
+		GLuint texture;
+		glGenTextures(1, &texture);
+		glBindTexture(GL_TEXTURE_2D, texture);
+		TextureCache::upload(image);
+		return texture;
+	}
+
+	// GPU milliseconds per fullscreen pass sampling texture, the program and target are already bound
+	double timeSampling(const ShaderProgram& shader, GLuint query, GLuint texture, float repeat) {
+		if (texture == 0) return 0.0;
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D, texture);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		shader.setFloat("repeat", repeat);
+
+		for (int i = 0; i < 3; i++) glDrawArrays(GL_TRIANGLES, 0, 3); // warm up
+		glBeginQuery(GL_TIME_ELAPSED, query);
+		for (int i = 0; i < PASSES; i++) glDrawArrays(GL_TRIANGLES, 0, 3);
+		glEndQuery(GL_TIME_ELAPSED);
+		GLuint64 nanoseconds = 0;
+		glGetQueryObjectui64v(query, GL_QUERY_RESULT, &nanoseconds);
+		return nanoseconds / 1e6 / PASSES;
+	}
+
+	const char* formatName(GLenum format) {
+		return format == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT ? "BC3" : "BC1";
+	}
+}
+
+void TextureReport::run(const std::vector<std::string>& models) {
+	// every texture file the models use, once
+	std::vector<std::string> textures;
+	for (const std::string& path : models) {
+		ParsedModel parsed;
+		if (!AssetRegistry::get().parseModel(path, parsed)) continue;
+		const std::string directory = path.substr(0, path.find_last_of('/'));
+		for (const ParsedMesh& mesh : parsed.meshes) {
+			for (const TexMesh& texture : mesh.textures) {
+				const std::string file = directory + '/' + texture.path;
+				if (std::find(textures.begin(), textures.end(), file) == textures.end()) textures.push_back(file);
+			}
+		}
+	}
+
+	const bool compression = GLEW_EXT_texture_compression_s3tc;
+	if (!compression) Log::warning("The driver has no S3TC, only the uncompressed cases run");
+
+	GLuint framebuffer, colour;
+	glGenFramebuffers(1, &framebuffer);
+	glGenRenderbuffers(1, &colour);
+	glBindRenderbuffer(GL_RENDERBUFFER, colour);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, WIDTH, HEIGHT);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colour);
+	glViewport(0, 0, WIDTH, HEIGHT);
+	glDisable(GL_DEPTH_TEST);
+	glDisable(GL_BLEND);
+
+	ShaderProgram shader("shaders/fullscreen.vert", "shaders/texture_report.frag");
+	shader.use();
+	shader.setInt("image", 0);
+	GLuint VAO, query;
+	glGenVertexArrays(1, &VAO);
+	glBindVertexArray(VAO);
+	glGenQueries(1, &query);
+
+	Log::info("Texture report: {} textures of {} models, {} fullscreen passes at {}x{} per case", textures.size(), models.size(), PASSES, WIDTH, HEIGHT);
+	Log::info("{:<40} | {:>9} | {:>6} | {:>8} | {:>8} | {:>8} | {:>9} | {:>9} | {:>9} | {:>9}",
+		"texture", "size", "format", "raw MB", "mips MB", "BC MB", "raw 1:1", "raw far", "mips far", "BC far");
+
+	size_t totalRaw = 0, totalMips = 0, totalCompressed = 0;
+	double totalRawFar = 0.0, totalMipsFar = 0.0, totalCompressedFar = 0.0, encodeSeconds = 0.0;
+	int measured = 0;
+	for (const std::string& file : textures) {
+		const DecodedImage image = AssetLoader::decode(file, false);
+		if (!image.valid()) {
+			Log::warning("{} didn't decode", file);
+			continue;
+		}
+		const auto start = std::chrono::steady_clock::now();
+		const CompressedImage compressed = compression ? TextureCache::compress(image) : CompressedImage();
+		encodeSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		const GLuint raw = uploadRaw(image, false);
+		const GLuint mipmapped = uploadRaw(image, true);
+		const GLuint bc = compressed.valid() ? uploadCompressed(compressed) : 0;
+
+		const double rawNear = timeSampling(shader, query, raw, 1.f);
+		const double rawFar = timeSampling(shader, query, raw, FAR_REPEAT);
+		const double mipsFar = timeSampling(shader, query, mipmapped, FAR_REPEAT);
+		const double compressedFar = timeSampling(shader, query, bc, FAR_REPEAT);
+
+		const size_t rawBytes = TextureCache::uncompressedBytes(image, false);
+		const size_t mipBytes = TextureCache::uncompressedBytes(image, true);
+		const std::string size = fmt::format("{}x{}", image.width, image.height);
+		Log::info("{:<40} | {:>9} | {:>6} | {:>8.2f} | {:>8.2f} | {:>8.2f} | {:>9.3f} | {:>9.3f} | {:>9.3f} | {:>9.3f}",
+			file, size, compressed.valid() ? formatName(compressed.format) : "-", rawBytes / (1024.0 * 1024.0), mipBytes / (1024.0 * 1024.0),
+			compressed.bytes() / (1024.0 * 1024.0), rawNear, rawFar, mipsFar, compressedFar);
+
+		totalRaw += rawBytes;
+		totalMips += mipBytes;
+		totalCompressed += compressed.bytes();
+		totalRawFar += rawFar;
+		totalMipsFar += mipsFar;
+		totalCompressedFar += compressedFar;
+		measured++;
+
+		const GLuint ids[] = { raw, mipmapped, bc };
+		glDeleteTextures(bc ? 3 : 2, ids);
+	}
+
+	glDeleteQueries(1, &query);
+	glDeleteVertexArrays(1, &VAO);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glDeleteFramebuffers(1, &framebuffer);
+	glDeleteRenderbuffers(1, &colour);
+
+	if (totalRaw == 0) return;
+	// samples per second of a far pass: every pixel takes one trilinear (or bilinear) sample
+	auto gigaSamples = [](double milliseconds) { return milliseconds > 0.0 ? (double)WIDTH * HEIGHT / (milliseconds * 1e6) : 0.0; };
+	Log::info("VRAM: {:.2f} MB raw, {:.2f} MB with mips, {:.2f} MB BC with mips ({:.0f}% less than raw)",
+		totalRaw / (1024.0 * 1024.0), totalMips / (1024.0 * 1024.0), totalCompressed / (1024.0 * 1024.0), 100.0 * (1.0 - (double)totalCompressed / totalRaw));
+	Log::info("Far sampling: {:.3f} ms raw, {:.3f} ms with mips, {:.3f} ms BC ({:.2f} / {:.2f} / {:.2f} Gsamples/s per texture)",
+		totalRawFar, totalMipsFar, totalCompressedFar,
+		gigaSamples(totalRawFar / measured), gigaSamples(totalMipsFar / measured), gigaSamples(totalCompressedFar / measured));
+	if (compression) Log::info("Compressing took {:.2f} s, the TextureCache keeps the result so the game pays it once", encodeSeconds);
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Loads the textures of a few models and compares them uploaded three ways: raw with no mips (how
+// textures used to go up), raw with mips, and BC1/BC3 with mips from the TextureCache. Logs the VRAM
+// of each, then the GPU time of fullscreen passes that sample them 1:1 and minified the way far away
+// ground is, which is where missing mips thrash the texture cache.
+// Needs a current GL context.
+class TextureReport {
+
+public:
+	static void run(const std::vector<std::string>& models = {
+		"models/ground/ground.obj", "models/ground/iceberg.obj", "models/icebergs/blue_iceberg.obj",
+		"models/icebergs/green_iceberg.obj", "models/icebergs/purple_iceberg.obj", "models/icebergs/red_iceberg.obj" });
+};
@@ -8,10 +8,8 @@ Time::Time() {
 	simulations = 0;
 	renders = 0;
 	
-	renderAccum = microseconds(0);
 	physicsAccum = microseconds(0);
 	
-	shouldRender = false;
 	shouldSimulate = false;
 
 	// oscillation stuff
@@ -24,19 +22,13 @@ Time::Time() {
 void Time::update() {
 	currentTime = steady_clock::now();
 	deltaTime = duration_cast<microseconds>(currentTime - lastTime);
-	renderAccum += deltaTime;
 	physicsAccum += deltaTime;
 	lastTime = currentTime;
-	// 16666.. microseconds = 16.666 ms is one frame at 60fps OR 30fps 33.333 ms for 30fps
-	if (renderAccum > microseconds(FPSArray[multiplayer])) {
-		shouldRender = true;
-		renderAccum = renderAccum % microseconds(FPSArray[multiplayer]);
-	}
-	//simulate physics at 120fps
-	if (physicsAccum > microseconds(8333)) {
-		shouldSimulate = true;
-		physicsAccum = physicsAccum % microseconds(8333);
-	}
+	//simulate physics at 120fps, keeping the remainder for the next frame.
+	//anything past MAX_SIM_STEPS is dropped so a long hitch can't snowball into longer and longer frames.
+	if (physicsAccum > SIM_STEP * MAX_SIM_STEPS) physicsAccum = SIM_STEP * MAX_SIM_STEPS;
+	simStepsThisFrame = 0;
+	shouldSimulate = physicsAccum >= SIM_STEP;
 
 }
 
@@ -52,7 +44,6 @@ void Time::endRenderTimer() {
 	renders++;
 	totalRenderTime += duration_cast<microseconds>(steady_clock::now() - renderDelta);
 	//Log::info("Frame Rendered");
-	shouldRender = false;
 	averageRenderTime = (int)totalRenderTime.count() / renders;
 }
 
@@ -60,8 +51,12 @@ void Time::endSimTimer() {
 	simulations++;
 	totalSimTime += duration_cast<microseconds>(steady_clock::now() - simulateDelta);
 	//Log::info("Physics Simulated");
-	shouldSimulate = false;
 	averageSimTime = (int)totalSimTime.count() / simulations;
+
+	// consume one step, the loop in main keeps simulating while there is a full step left.
+	physicsAccum -= SIM_STEP;
+	simStepsThisFrame++;
+	shouldSimulate = physicsAccum >= SIM_STEP && simStepsThisFrame < MAX_SIM_STEPS;
 }
 
 void Time::startRenderTimer() {
@@ -76,12 +71,15 @@ void Time::displayDeltaTime() {
 	Log::info("Update took {} microseconds", deltaTime.count());
 }
 
-void Time::resetStats() {
-	totalRenderTime = microseconds(0);
+void Time::resetSimStats() {
 	totalSimTime = microseconds(0);
-	averageRenderTime = 0;
 	averageSimTime = 0;
 	simulations = 0;
+}
+
+void Time::resetRenderStats() {
+	totalRenderTime = microseconds(0);
+	averageRenderTime = 0;
 	renders = 0;
 }
 
@@ -19,12 +19,11 @@ public:
 	int renders = 0;
 
 	microseconds deltaTime;
-	microseconds renderAccum = microseconds(0);
 	microseconds physicsAccum = microseconds(0);
 	time_point<steady_clock> renderDelta;
 	time_point<steady_clock> simulateDelta;
-	bool shouldRender = false;
 	bool shouldSimulate = false;
+	int simStepsThisFrame = 0;
 
 	bool multiplayer; // if singleplayer, 0, multiplayer 1
 
@@ -42,7 +41,9 @@ public:
 	void startRenderTimer();
 	void startSimTimer();
 	void displayDeltaTime();
-	void resetStats();
+	// the render stats belong to the render thread, the sim thread asks for a reset through the snapshot.
+	void resetSimStats();
+	void resetRenderStats();
 	time_point<steady_clock> getTime();
 
 	void toMultiplayerMode();
@@ -50,6 +51,10 @@ public:
 
 	const int FPSArray[2] = { 16666, 33332};
 
+	// fixed simulation step (120hz) and how many we are willing to run in one frame to catch up after a hitch.
+	const microseconds SIM_STEP = microseconds(8333);
+	const int MAX_SIM_STEPS = 5;
+
 private:
 	
 };
\ No newline at end of file
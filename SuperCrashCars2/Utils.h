@@ -6,6 +6,8 @@
 #include <memory>
 #include "ShaderProgram.h"
 
+class RenderQueue;
+
 class Utils {
 
 public:
@@ -13,8 +15,12 @@ public:
 
 	int SCREEN_WIDTH = 1920; // change to 1920
 	int SCREEN_HEIGHT = 1080; // change to 1000
+
+	bool headless = false; // no window or GL context: models keep their geometry but never touch GL
 	
 	std::shared_ptr<ShaderProgram> shader = nullptr;
+	RenderQueue* queue = nullptr; // set while a RenderQueue collects the mesh draws, see RenderQueue::begin
+	int numViews = 1; // every mesh draw is instanced this many times, once per viewport, see RenderManager::beginSinglePass
 
 	physx::PxVec3 glmToPxVec3(glm::vec3 vec) {
 		return physx::PxVec3(vec.x, vec.y, vec.z);
@@ -26,16 +32,21 @@ public:
 
 	template<typename T>
 	T random(T range_from, T range_to) {
-		std::random_device                  rand_dev;
-		std::mt19937                        generator(rand_dev());
 		std::uniform_int_distribution<T>    distr(range_from, range_to);
-		return distr(generator);
+		return distr(m_generator);
+	}
+
+	// fixed seed so headless runs can be replayed.
+	void seed(unsigned int value) {
+		m_generator.seed(value);
 	}
 
 
 private:
-	Utils() {};
+	Utils() : m_generator(std::random_device()()) {};
 	Utils(Utils const& other) = delete;
 	Utils(Utils&& other) = delete;
 
+	std::mt19937 m_generator;
+
 };
\ No newline at end of file
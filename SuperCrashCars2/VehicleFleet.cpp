@@ -0,0 +1,163 @@
+#include "VehicleFleet.h"
+
+#include "Log.h"
+
+#include <stdexcept>
+
+#define PX_RELEASE(x)	if(x)	{ x->release(); x = NULL;	}
+
+void VehicleBatchTask::run() {
+	this->m_fleet->updateBatch(this->m_batchId);
+}
+
+void VehicleBatchTask::release() {
+	this->m_fleet->onBatchComplete();
+}
+
+VehicleFleet::VehicleFleet() {}
+
+void VehicleFleet::init(PxScene* scene, const PxMaterial* material, PxAllocatorCallback& allocator, PxCpuDispatcher* dispatcher, PxU32 numWorkers) {
+	//Create one batched scene query per batch of vehicles for the suspension raycasts.
+	//Each batch owns its own PxBatchQuery so batches can be raycast from different threads.
+	gVehicleSceneQueryData = VehicleSceneQueryData::allocate(MAX_NUM_VEHICLES, PX_MAX_NB_WHEELS, 1, NUM_VEHICLES_IN_BATCH, WheelSceneQueryPreFilterBlocking, NULL, allocator);
+	for (PxU32 i = 0; i < MAX_NUM_BATCHES; i++) {
+		gBatchQueries[i] = VehicleSceneQueryData::setUpBatchedSceneQuery(i, *gVehicleSceneQueryData, scene);
+		this->m_batchTasks[i].m_fleet = this;
+		this->m_batchTasks[i].m_batchId = i;
+	}
+
+	//Vehicle updates running on workers write their results here, applied afterwards by PxVehiclePostUpdates.
+	gVehicleConcurrency = VehicleConcurrency::allocate(MAX_NUM_VEHICLES, PX_MAX_NB_WHEELS, allocator);
+
+	//Create the friction table for each combination of tire and surface type.
+	gFrictionPairs = createFrictionPairs(material);
+
+	this->m_dispatcher = dispatcher;
+	this->m_numWorkers = numWorkers;
+
+	this->m_vehicles.reserve(MAX_NUM_VEHICLES);
+	this->m_isVehicleInAir.reserve(MAX_NUM_VEHICLES);
+	this->m_activeVehicles.reserve(MAX_NUM_VEHICLES);
+	this->m_activeSlots.reserve(MAX_NUM_VEHICLES);
+	this->m_wheelQueryResults.resize(MAX_NUM_VEHICLES * PX_MAX_NB_WHEELS);
+	this->m_vehicleQueryResults.reserve(MAX_NUM_VEHICLES);
+}
+
+void VehicleFleet::free(PxAllocatorCallback& allocator) {
+	for (PxU32 i = 0; i < MAX_NUM_BATCHES; i++) PX_RELEASE(gBatchQueries[i]);
+	if (gVehicleConcurrency) {
+		gVehicleConcurrency->free(allocator);
+		gVehicleConcurrency = NULL;
+	}
+	if (gVehicleSceneQueryData) {
+		gVehicleSceneQueryData->free(allocator);
+		gVehicleSceneQueryData = NULL;
+	}
+	PX_RELEASE(gFrictionPairs);
+
+	this->m_vehicles.clear();
+	this->m_isVehicleInAir.clear();
+}
+
+PxU32 VehicleFleet::addVehicle(PxVehicleWheels* vehicle) {
+	// reuse a slot freed by removeVehicle() before growing.
+	for (PxU32 i = 0; i < this->m_vehicles.size(); i++) {
+		if (this->m_vehicles[i] == NULL) {
+			this->m_vehicles[i] = vehicle;
+			this->m_isVehicleInAir[i] = true;
+			return i;
+		}
+	}
+	if (this->m_vehicles.size() >= MAX_NUM_VEHICLES) {
+		Log::error("VehicleFleet is full, cannot add more than {} vehicles.", MAX_NUM_VEHICLES);
+		throw std::runtime_error("VehicleFleet is full");
+	}
+	this->m_vehicles.push_back(vehicle);
+	this->m_isVehicleInAir.push_back(true);
+	return (PxU32)this->m_vehicles.size() - 1;
+}
+
+void VehicleFleet::removeVehicle(PxU32 index) {
+	if (index >= this->m_vehicles.size()) return;
+	this->m_vehicles[index] = NULL;
+	this->m_isVehicleInAir[index] = true;
+}
+
+void VehicleFleet::update(const PxF32 timestep, const PxVec3& gravity) {
+	this->m_activeVehicles.clear();
+	this->m_activeSlots.clear();
+	this->m_vehicleQueryResults.clear();
+
+	PxU32 wheelOffset = 0;
+	for (PxU32 i = 0; i < this->m_vehicles.size(); i++) {
+		PxVehicleWheels* vehicle = this->m_vehicles[i];
+		if (!vehicle) continue;
+		const PxU32 nbWheels = vehicle->mWheelsSimData.getNbWheels();
+		this->m_activeVehicles.push_back(vehicle);
+		this->m_activeSlots.push_back(i);
+		this->m_vehicleQueryResults.push_back({ &this->m_wheelQueryResults[wheelOffset], nbWheels });
+		wheelOffset += nbWheels;
+	}
+	const PxU32 nbVehicles = (PxU32)this->m_activeVehicles.size();
+	if (nbVehicles == 0) return;
+
+	this->m_timestep = timestep;
+	this->m_gravity = gravity;
+
+	const PxU32 nbBatches = (nbVehicles + NUM_VEHICLES_IN_BATCH - 1) / NUM_VEHICLES_IN_BATCH;
+	this->m_concurrent = this->m_dispatcher && this->m_numWorkers > 1 && nbBatches > 1;
+
+	if (!this->m_concurrent) {
+		for (PxU32 i = 0; i < nbBatches; i++) this->updateBatch(i);
+	}
+	else {
+		//Hand every batch but the first to the workers, this thread does the first one itself.
+		this->m_pendingBatches = nbBatches - 1;
+		for (PxU32 i = 1; i < nbBatches; i++) this->m_dispatcher->submitTask(this->m_batchTasks[i]);
+		this->updateBatch(0);
+		{
+			std::unique_lock<std::mutex> lock(this->m_batchMutex);
+			this->m_batchDone.wait(lock, [this] { return this->m_pendingBatches == 0; });
+		}
+
+		//Apply the deferred writes to the actors now that every batch is done.
+		PxVehiclePostUpdates(gVehicleConcurrency->getVehicleConcurrentUpdateBuffer(), nbVehicles, this->m_activeVehicles.data());
+	}
+
+	//Work out if the vehicles are in the air.
+	for (PxU32 i = 0; i < nbVehicles; i++) {
+		this->m_isVehicleInAir[this->m_activeSlots[i]] = this->m_activeVehicles[i]->getRigidDynamicActor()->isSleeping() ? false : PxVehicleIsInAir(this->m_vehicleQueryResults[i]);
+	}
+}
+
+void VehicleFleet::updateBatch(PxU32 batchId) {
+	const PxU32 first = batchId * NUM_VEHICLES_IN_BATCH;
+	const PxU32 count = PxMin(NUM_VEHICLES_IN_BATCH, (PxU32)this->m_activeVehicles.size() - first);
+	PxVehicleWheels** vehicles = &this->m_activeVehicles[first];
+
+	//Raycasts.
+	PxRaycastQueryResult* raycastResults = gVehicleSceneQueryData->getRaycastQueryResultBuffer(batchId);
+	const PxU32 raycastResultsSize = gVehicleSceneQueryData->getQueryResultBufferSize();
+	PxVehicleSuspensionRaycasts(gBatchQueries[batchId], count, vehicles, raycastResultsSize, raycastResults);
+
+	//Vehicle update.
+	PxVehicleConcurrentUpdateData* concurrentUpdates = this->m_concurrent ? gVehicleConcurrency->getVehicleConcurrentUpdate(first) : NULL;
+	PxVehicleUpdates(this->m_timestep, this->m_gravity, *gFrictionPairs, count, vehicles, &this->m_vehicleQueryResults[first], concurrentUpdates);
+}
+
+void VehicleFleet::onBatchComplete() {
+	std::lock_guard<std::mutex> lock(this->m_batchMutex);
+	if (--this->m_pendingBatches == 0) this->m_batchDone.notify_one();
+}
+
+bool VehicleFleet::isVehicleInAir(PxU32 index) const {
+	return this->m_isVehicleInAir[index];
+}
+
+PxU32 VehicleFleet::getNbVehicles() const {
+	PxU32 count = 0;
+	for (PxVehicleWheels* vehicle : this->m_vehicles) if (vehicle) count++;
+	return count;
+}
+
+VehicleFleet::~VehicleFleet() {}
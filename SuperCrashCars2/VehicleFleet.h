@@ -0,0 +1,89 @@
+#pragma once
+
+#include <PxPhysicsAPI.h>
+#include "vehicle/PxVehicleUtil.h"
+
+#include "SnippetVehicleSceneQuery.h"
+#include "SnippetVehicleTireFriction.h"
+#include "SnippetVehicleConcurrency.h"
+
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+
+using namespace physx;
+using namespace snippetvehicle;
+
+class VehicleFleet;
+
+// Raycasts and updates one batch of vehicles on a PhysX dispatcher worker.
+class VehicleBatchTask : public PxBaseTask {
+
+public:
+	VehicleFleet* m_fleet = NULL;
+	PxU32 m_batchId = 0;
+
+	void run() override;
+	void release() override;
+	const char* getName() const override { return "VehicleBatchTask"; }
+};
+
+// Owns every vehicle in the scene so that suspension raycasts and vehicle updates
+// are issued per batch of cars instead of once per car. Batches are spread across
+// the dispatcher workers when there is more than one.
+class VehicleFleet {
+
+public:
+	static const PxU32 MAX_NUM_VEHICLES = 64;
+	static const PxU32 NUM_VEHICLES_IN_BATCH = 4;
+	static const PxU32 MAX_NUM_BATCHES = MAX_NUM_VEHICLES / NUM_VEHICLES_IN_BATCH;
+
+	VehicleFleet();
+	~VehicleFleet();
+
+	void init(PxScene* scene, const PxMaterial* material, PxAllocatorCallback& allocator, PxCpuDispatcher* dispatcher, PxU32 numWorkers);
+	void free(PxAllocatorCallback& allocator);
+
+	PxU32 addVehicle(PxVehicleWheels* vehicle);
+	void removeVehicle(PxU32 index);
+
+	void update(const PxF32 timestep, const PxVec3& gravity);
+
+	bool isVehicleInAir(PxU32 index) const;
+	PxU32 getNbVehicles() const;
+
+	PxVehicleDrivableSurfaceToTireFrictionPairs* gFrictionPairs = NULL;
+
+private:
+	friend class VehicleBatchTask;
+
+	VehicleSceneQueryData* gVehicleSceneQueryData = NULL;
+	PxBatchQuery* gBatchQueries[MAX_NUM_BATCHES] = {};
+	VehicleConcurrency* gVehicleConcurrency = NULL;
+
+	PxCpuDispatcher* m_dispatcher = NULL;
+	PxU32 m_numWorkers = 1;
+	VehicleBatchTask m_batchTasks[MAX_NUM_BATCHES];
+
+	// indexed by the slot handed out in addVehicle(), removed slots are left NULL.
+	std::vector<PxVehicleWheels*> m_vehicles;
+	std::vector<bool> m_isVehicleInAir;
+
+	// packed every tick from the non-empty slots above.
+	std::vector<PxVehicleWheels*> m_activeVehicles;
+	std::vector<PxU32> m_activeSlots;
+	std::vector<PxWheelQueryResult> m_wheelQueryResults;
+	std::vector<PxVehicleWheelQueryResult> m_vehicleQueryResults;
+
+	// state for the tick currently being updated.
+	PxF32 m_timestep = 0.0f;
+	PxVec3 m_gravity;
+	bool m_concurrent = false;
+
+	std::mutex m_batchMutex;
+	std::condition_variable m_batchDone;
+	PxU32 m_pendingBatches = 0;
+
+	void updateBatch(PxU32 batchId);
+	void onBatchComplete();
+};
@@ -0,0 +1,60 @@
+#include "VertexFormatReport.h"
+
+#include "AssetRegistry.h"
+#include "Log.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <vector>
+
+namespace {
+	std::string layoutName(const VertexLayout& layout) {
+		std::string name = "pos+n";
+		if (layout.texCoords) name += layout.halfTexCoords ? "+uv16" : "+uv32";
+		return name;
+	}
+}
+
+void VertexFormatReport::run(const std::string& directory) {
+	std::vector<std::string> paths;
+	for (const auto& entry : std::filesystem::recursive_directory_iterator(directory)) {
+		if (entry.is_regular_file() && entry.path().extension() == ".obj") paths.push_back(entry.path().generic_string());
+	}
+	std::sort(paths.begin(), paths.end());
+
+	Log::info("Vertex format report: {} models under {}/", paths.size(), directory);
+	Log::info("{:<45} | {:>8} | {:>10} | {:>10} | {:>6} | {}", "model", "vertices", "before KB", "after KB", "stride", "layouts");
+
+	size_t totalVertices = 0, totalBefore = 0, totalAfter = 0, totalVertexBytes = 0;
+	for (const std::string& path : paths) {
+		const std::shared_ptr<ModelAsset> asset = AssetRegistry::get().loadModel(path, false);
+
+		size_t vertices = 0, before = 0, after = 0, vertexBytes = 0;
+		std::vector<std::string> layouts;
+		for (const Mesh& mesh : asset->meshes) {
+			vertices += mesh.m_vertices.size();
+			before += mesh.getUnpackedBytes();
+			after += mesh.getGPUBytes();
+			vertexBytes += mesh.m_vertices.size() * mesh.getLayout().stride();
+			const std::string layout = layoutName(mesh.getLayout());
+			if (std::find(layouts.begin(), layouts.end(), layout) == layouts.end()) layouts.push_back(layout);
+		}
+
+		std::string layoutList;
+		for (const std::string& layout : layouts) layoutList += (layoutList.empty() ? "" : ", ") + layout;
+		const double stride = vertices > 0 ? (double)vertexBytes / vertices : 0.0;
+		Log::info("{:<45} | {:>8} | {:>10.1f} | {:>10.1f} | {:>6.1f} | {}", path, vertices, before / 1024.0, after / 1024.0, stride, layoutList);
+
+		totalVertices += vertices;
+		totalBefore += before;
+		totalAfter += after;
+		totalVertexBytes += vertexBytes;
+	}
+
+	if (totalVertices == 0) return;
+	const double stride = (double)totalVertexBytes / totalVertices;
+	Log::info("VRAM for vertex and index buffers: {:.2f} MB -> {:.2f} MB ({:.0f}% less)",
+		totalBefore / (1024.0 * 1024.0), totalAfter / (1024.0 * 1024.0), 100.0 * (1.0 - (double)totalAfter / totalBefore));
+	Log::info("Vertex fetch per vertex: {} bytes -> {:.1f} bytes on average ({:.0f}% less bandwidth)",
+		sizeof(Vertex), stride, 100.0 * (1.0 - stride / sizeof(Vertex)));
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <string>
+
+// Loads every model under a directory and logs what its vertex and index buffers take with the
+// packed per-mesh layouts (see VertexLayout) against the old 88 byte Vertex. The vertex stride is
+// also what the vertex shader fetches per vertex, so its drop is the drop in vertex fetch bandwidth.
+// Needs a current GL context since the models upload their buffers and textures.
+class VertexFormatReport {
+
+public:
+	static void run(const std::string& directory = "models");
+};
@@ -21,32 +21,165 @@
 #include "Skybox.h"
 #include "TextRenderer.h"
 #include "Texture.h"
-#include "Image.h"
+#include "SpriteBatch.h"
 
 #include "PVehicle.h"
+#include "PhysicsBenchmark.h"
+#include "ShadowBenchmark.h"
+#include "LodBenchmark.h"
+#include "SplitScreenBenchmark.h"
+#include "LodSelector.h"
+#include "VertexFormatReport.h"
+#include "TextureReport.h"
+#include "AssetBake.h"
 #include "PDynamic.h"
 #include "PStatic.h"
 #include "PowerUp.h"
+#include "Match.h"
+#include "Replay.h"
+#include "HeadlessRunner.h"
+#include "Profiler.h"
+#include "GpuTimer.h"
+#include "AssetRegistry.h"
+#include "AssetLoader.h"
+#include "TextureCache.h"
+#include "LoadingScreen.h"
+#include "CookCache.h"
 
 #include "ImguiManager.h"
 #include "AudioManager.h"
 
 #include "RenderManager.h"
 #include "MiniMap.h"
+#include "SceneSnapshot.h"
+
+#include <argh.h>
+#include <atomic>
+#include <thread>
+#include <timeapi.h> // timeBeginPeriod, after Windows.h from Time.h
 
 
 
 int main(int argc, char** argv) {
 	Log::info("Starting Game...");
+	const time_point<steady_clock> launchTime = steady_clock::now();
+
+	// Command line
+	// --physics-threads=N  PhysX worker threads (default: hardware threads - 2)
+	// --physics-benchmark  time the physics tick for 4/16/64 cars against thread count, then exit
+	// --shadow-benchmark   compare memory, GPU time and texel density of every shadow quality, then exit
+	// --lod-benchmark      triangles per frame and GPU time of a 4 player match at full detail and with levels of detail, then exit
+	// --no-lod             always draw meshes at full detail
+	// --split-benchmark    compare CPU submission and GPU time of 2 and 4 viewports drawn one by one and in a single pass, then exit
+	// --split-screen=MODE  single (default, where the driver has viewport arrays) draws every viewport in one pass, loop one by one
+	// --vertex-report      log the vertex/index buffer sizes and layouts of every model under models/, then exit
+	// --texture-report     compare VRAM and sampling time of the ground and iceberg textures raw, mipmapped and BC compressed, then exit
+	// --no-texture-compression  upload model textures as raw RGB(A) with generated mips instead of BC1/BC3 from cache/textures
+	// --bake               pack every model under models/ into models.bake, which later launches map instead of importing
+	// --shadows=QUALITY    legacy, low, medium (default) or high, also in the options menu
+	// --headless           play AI-only matches with no window, GL or audio, log the results, then exit
+	// --matches=N          how many headless matches to play (default 100)
+	// --max-ticks=N        ticks before a headless match is called a draw (default 5 minutes of game time)
+	// --seed=N             fixed seed for the AI's random choices
+	// --record=FILE        write the inputs of the next match to FILE (headless: the first match)
+	// --replay=FILE        play the match recorded in FILE instead of reading controllers or running the AI
+	// --profile            start with the profiler overlay open (F3 toggles it, F4 exports)
+	// --profile-out=NAME   where F4 and exit write NAME.json (chrome://tracing) and NAME.csv (default "profile")
+	argh::parser cmdl(argc, argv);
+	PxU32 physicsThreads = PhysicsManager::defaultNumWorkers();
+	cmdl("physics-threads", physicsThreads) >> physicsThreads;
+	unsigned int seed;
+	if (cmdl("seed") >> seed) Utils::instance().seed(seed);
+	const std::string recordPath = cmdl("record").str();
+	const std::string replayPath = cmdl("replay").str();
+	const std::string shadows = cmdl("shadows").str();
+	const std::string splitScreen = cmdl("split-screen").str();
+	if (shadows == "legacy") GameManager::get().shadowQuality = ShadowQuality::eLEGACY;
+	else if (shadows == "low") GameManager::get().shadowQuality = ShadowQuality::eLOW;
+	else if (shadows == "medium") GameManager::get().shadowQuality = ShadowQuality::eMEDIUM;
+	else if (shadows == "high") GameManager::get().shadowQuality = ShadowQuality::eHIGH;
+	const std::string profileOut = cmdl("profile-out").str();
+	const std::string profilePath = profileOut.empty() ? "profile" : profileOut;
+	const bool exportProfileOnExit = !profileOut.empty();
+	Profiler::get().showOverlay = cmdl["profile"];
+	LodSelector::get().setEnabled(!cmdl["no-lod"]);
+	Profiler::get().setThreadName("sim");
+	auto exportProfile = [&]() {
+		Profiler::get().exportChromeTrace(profilePath + ".json");
+		Profiler::get().exportCSV(profilePath + ".csv");
+	};
+
+	if (cmdl["headless"]) {
+		PxU32 numMatches = 100;
+		PxU32 maxTicks = 5 * 60 * 120;
+		cmdl("matches", numMatches) >> numMatches;
+		cmdl("max-ticks", maxTicks) >> maxTicks;
+		Utils::instance().headless = true;
+		HeadlessRunner::run(numMatches, maxTicks, physicsThreads, recordPath, replayPath);
+		if (exportProfileOnExit) exportProfile();
+		return 0;
+	}
 
 	// OpenGL
 	glfwInit();
 	//Window window(Utils::instance().SCREEN_WIDTH, Utils::instance().SCREEN_HEIGHT, "Super Crash Cars 2");
 	Window window(Utils::instance().SCREEN_WIDTH, Utils::instance().SCREEN_HEIGHT, "Super Crash Cars 2", glfwGetPrimaryMonitor(), NULL);
 
+	// needs the context to ask the driver for S3TC
+	TextureCache::get().setEnabled(!cmdl["no-texture-compression"] && GLEW_EXT_texture_compression_s3tc);
+
 	std::shared_ptr<InputManager> inputManager = std::make_shared<InputManager>(Utils::instance().SCREEN_WIDTH, Utils::instance().SCREEN_HEIGHT);
 	window.setCallbacks(inputManager);
 
+	if (cmdl["physics-benchmark"]) {
+		PhysicsBenchmark::run();
+		glfwTerminate();
+		return 0;
+	}
+
+	if (cmdl["vertex-report"]) {
+		VertexFormatReport::run();
+		glfwTerminate();
+		return 0;
+	}
+
+	if (cmdl["texture-report"]) {
+		TextureReport::run();
+		glfwTerminate();
+		return 0;
+	}
+
+	if (cmdl["bake"]) {
+		const bool baked = AssetBake::run();
+		glfwTerminate();
+		return baked ? 0 : 1;
+	}
+
+	// Loading screen, up before anything else loads
+	LoadingScreen loading(window);
+	Log::info("Loading screen up {:.0f} ms after launch", duration<double, std::milli>(steady_clock::now() - launchTime).count());
+
+	// everything startup loads, read on loader workers while the loading screen uploads what they finish.
+	// something missing from these lists still loads, only on this thread
+	AssetLoader::get().start();
+	for (const char* path : {
+		"models/ground/ground.obj", "models/ava_car_green/ava_car.obj", "models/ava_car_blue/ava_car.obj", "models/ava_car_red/ava_car.obj",
+		"models/ava_car_yellow/ava_car.obj", "models/wheel/ava_wheel.obj", "models/sphere/sphere.obj", "models/powerups/jump_star/star.obj",
+		"models/powerups/health_star/heart.obj", "models/powerups/shield/shieldman.obj", "models/tree/tree.obj", "models/grass/grass.obj",
+		"models/ground/iceberg.obj", "models/icebergs/blue_iceberg.obj", "models/icebergs/green_iceberg.obj", "models/icebergs/purple_iceberg.obj",
+		"models/icebergs/red_iceberg.obj", "models/topofmap/toruses.obj", "models/topofmap/icosahedron.obj", "models/topofmap/tealspike.obj",
+		"models/topofmap/redsmallspike.obj", "models/topofmap/bigredspike.obj", "models/topofmap/greyspike.obj" }) {
+		AssetLoader::get().requestModel(path);
+	}
+	for (const char* path : {
+		"textures/scc2.png", "textures/htp.png", "textures/controller.png", "textures/star.png", "textures/shield.png", "textures/white_heart.png",
+		"textures/green.png", "textures/blue.png", "textures/red.png", "textures/yellow.png", "textures/minimap.png" }) {
+		AssetLoader::get().requestImage(path, true);
+	}
+	for (const std::string& face : Skybox::faces()) AssetLoader::get().requestImage(face, false);
+	AssetLoader::get().requestFont("freetype/fonts/poppins.ttf", 40);
+	AssetLoader::get().requestFont("freetype/fonts/vemanem.ttf", 100);
+
 	// Camera
 	Camera p1Camera = Camera(Utils::instance().SCREEN_WIDTH, Utils::instance().SCREEN_HEIGHT);
 	Camera p2Camera = Camera(Utils::instance().SCREEN_WIDTH, Utils::instance().SCREEN_HEIGHT);
@@ -66,6 +199,11 @@ int main(int argc, char** argv) {
 	cameraList.push_back(&menuCamera);
 
 	RenderManager renderer(&window, &cameraList, &menuCamera);
+	renderer.setSplitScreenMode(splitScreen == "loop" ? SplitScreenMode::eLOOP : SplitScreenMode::eSINGLE_PASS);
+	if (renderer.getSplitScreenMode() == SplitScreenMode::eSINGLE_PASS && !RenderManager::singlePassSupported()) {
+		Log::info("Split screen: no viewport arrays with gl_ViewportIndex in the vertex shader, drawing the viewports one by one");
+	}
+	loading.update();
 
 	// OSCILATION
 	int colorVar = 0;
@@ -77,32 +215,19 @@ int main(int argc, char** argv) {
 
 	TextRenderer currentPowerup(Utils::instance().SCREEN_WIDTH, Utils::instance().SCREEN_HEIGHT);
 	currentPowerup.Load("freetype/fonts/poppins.ttf", 40);
+	loading.update();
 
 
 
-	// Image rendering
-	std::vector<Image*> imageList;
-	Image mainMenu = Image(Utils::instance().SCREEN_WIDTH, Utils::instance().SCREEN_HEIGHT);
-	Image image1 = Image(Utils::instance().SCREEN_WIDTH, Utils::instance().SCREEN_HEIGHT);
-	Image image2 = Image(Utils::instance().SCREEN_WIDTH, Utils::instance().SCREEN_HEIGHT);
-	Image image3 = Image(Utils::instance().SCREEN_WIDTH, Utils::instance().SCREEN_HEIGHT);
-	Image image4 = Image(Utils::instance().SCREEN_WIDTH, Utils::instance().SCREEN_HEIGHT);
-	Image e0 = Image(Utils::instance().SCREEN_WIDTH, Utils::instance().SCREEN_HEIGHT);
-	Image e1 = Image(Utils::instance().SCREEN_WIDTH, Utils::instance().SCREEN_HEIGHT);
-	Image e2 = Image(Utils::instance().SCREEN_WIDTH, Utils::instance().SCREEN_HEIGHT);
-	Image e3 = Image(Utils::instance().SCREEN_WIDTH, Utils::instance().SCREEN_HEIGHT);
-	Image e4 = Image(Utils::instance().SCREEN_WIDTH, Utils::instance().SCREEN_HEIGHT);
-
-	imageList.push_back(&e0);
-	imageList.push_back(&e1);
-	imageList.push_back(&e2);
-	imageList.push_back(&e3);
-	imageList.push_back(&e4);
+	// Image rendering, one batch for every menu and HUD image
+	SpriteBatch& sprites = SpriteBatch::get();
+	sprites.setScreenSize(Utils::instance().SCREEN_WIDTH, Utils::instance().SCREEN_HEIGHT);
 	Texture menu("textures/scc2.png", GL_LINEAR);
 	Texture texture("textures/htp.png", GL_LINEAR);
 	Texture con("textures/controller.png", GL_LINEAR);
 	Texture star("textures/star.png", GL_LINEAR);
 	Texture shield("textures/shield.png", GL_LINEAR);
+	loading.update();
 
 
 	// Main Menu Buttons
@@ -125,7 +250,7 @@ int main(int argc, char** argv) {
 	}
 
 	std::vector<glm::vec3> optionsButtonColors;
-	for (int i = 0; i < 4; i++) {
+	for (int i = 0; i < 5; i++) {
 		optionsButtonColors.push_back(regCol);
 	}
 
@@ -149,11 +274,13 @@ int main(int argc, char** argv) {
 	glfwWindowHint(GLFW_SAMPLES, samples);
 
 	// Physx
-	PhysicsManager pm = PhysicsManager(1.3f / 60.0f);
+	PhysicsManager pm = PhysicsManager(1.3f / 60.0f, physicsThreads);
+	loading.update();
 	PVehicle player = PVehicle(0, pm, VehicleType::eAVA_GREEN, PlayerOrAI::ePLAYER, PxVec3(0.0f, 25.f, 200.0f)); // p1 green car
 	PVehicle enemy = PVehicle(1, pm, VehicleType::eAVA_BLUE, PlayerOrAI::eAI, PxVec3(0.0f, 25.f, -200.f)); // p2 blue car
 	PVehicle enemy2 = PVehicle(2, pm, VehicleType::eAVA_RED, PlayerOrAI::eAI, PxVec3(200.0f, 25.0f, 0.0f)); // p3 red car
 	PVehicle enemy3 = PVehicle(3, pm, VehicleType::eAVA_YELLOW, PlayerOrAI::eAI, PxVec3(-200.0f, 25.0f, 0.0f)); // p4 yellow car
+	loading.update();
 
 	PowerUp powerUp1 = PowerUp(pm, Model("models/powerups/jump_star/star.obj"), PowerUpType::eJUMP, PxVec3(70.f, 20.f, 110.f));
 	PowerUp powerUp2 = PowerUp(pm, Model("models/powerups/health_star/heart.obj"), PowerUpType::eHEALTH, PxVec3(115.f, 10.f, 20.f));
@@ -165,6 +292,7 @@ int main(int argc, char** argv) {
 
 
 	PStatic sphere = PStatic(pm, Model("models/sphere/sphere.obj"), PxVec3(0.f, 80.f, 0.f));
+	loading.update();
 
 	std::vector<PVehicle*> vehicleList;
 	std::vector<PowerUp*> powerUps;
@@ -180,13 +308,16 @@ int main(int argc, char** argv) {
 	powerUps.push_back(&powerUp6);
 	powerUps.push_back(&powerUp7);
 
+	Match match(pm, vehicleList, powerUps, time.SIM_STEP);
+
 	TextRenderer boost(Utils::instance().SCREEN_WIDTH, Utils::instance().SCREEN_HEIGHT);
 	boost.Load("freetype/fonts/vemanem.ttf", 100);
 
 	// Create Grass
-	std::vector<Model> grassPatches;
-	std::vector<Model> trees;
-	//renderer.generateLandscape(trees, grassPatches, pm.m_groundModel);
+	Model grassPatches;
+	Model trees;
+	renderer.generateLandscape(trees, grassPatches, pm.m_groundModel);
+	loading.update();
 
 	// AI toggle
 	bool ai_ON = true;
@@ -204,7 +335,6 @@ int main(int argc, char** argv) {
 	GameManager::get().initMenu();
 
 	std::string printDamage;
-	std::string printNumbers;
 
 	MiniMap map1(1, player);
 	//GameManager::get().playerNumber = 2; // NUMBER OF VIEWPORTS
@@ -222,338 +352,163 @@ int main(int argc, char** argv) {
 	Model spike2 = Model("models/topofmap/redsmallspike.obj");
 	Model spike3 = Model("models/topofmap/bigredspike.obj");
 	Model spike4 = Model("models/topofmap/greyspike.obj");
+	loading.update();
+
+	// never move, so they are only drawn into the shadow map again where a car or power-up moved over them
+	renderer.setStaticShadowCasters({ &toruses, &spike1, &spike2, &spike3, &spike4 });
+	// the icebergs and the top of the map, culled per viewport
+	renderer.setStaticObjects({ &bottom, &bottom1, &bottom2, &bottom3, &bottom4, &toruses, &spike1, &spike2, &spike3, &spike4 });
+	AssetRegistry::get().logStats();
 
 	Texture white_heart("textures/white_heart.png", GL_LINEAR);
 
+	// whatever was requested but not used yet, then the loader lets go of everything
+	loading.waitForAssets();
+	AssetLoader::get().finish();
+
+	if (cmdl["shadow-benchmark"]) {
+		ShadowBenchmark::run(renderer, cameraList);
+		glfwTerminate();
+		return 0;
+	}
+
+	if (cmdl["lod-benchmark"]) {
+		LodBenchmark::run(renderer, cameraList);
+		glfwTerminate();
+		return 0;
+	}
+
+	if (cmdl["split-benchmark"]) {
+		SplitScreenBenchmark::run(renderer, cameraList);
+		glfwTerminate();
+		return 0;
+	}
+
 	float x = 0;
 	float y = 0;
 
 	float xgap = 0;
 	float ygap = 0;
 
-	time_point now = steady_clock::now();
 	// Audio
 	AudioManager::get().init(vehicleList);
 	AudioManager::get().startCarSounds();
 	AudioManager::get().setCarSoundsPause(true);
 
-	std::vector<PVehicle*> winnerList = {&enemy};
 	PVehicle* winnerCar = &enemy;
 
-
-	while (!window.shouldClose() && !GameManager::get().quitGame) {
-
-		// always update the time and poll events
-		time.update();
-		glfwPollEvents();
-		glEnable(GL_DEPTH_TEST);
-
-		if (time.shouldSimulate) {
-			time.startSimTimer();
-			AudioManager::get().update();
-			AudioManager::get().updateBGM();
-			// check controller connected; when we have more controllers we will make it into a loop
-			// should probably put this away into the controller class
-			if (glfwJoystickPresent(GLFW_JOYSTICK_1)) {
-				if (!controller1.connected) {
-					AudioManager::get().playSound(SFX_CONTROLLER_ON, 0.3f);
-					controller1 = InputController(GLFW_JOYSTICK_1);
-					controller1.connected = true;
-					Log::debug("Controller 1 Connecter in main");
-
-				}
-			}
-			else {
-				if (controller1.connected) {
-					AudioManager::get().playSound(SFX_CONTROLLER_OFF, 0.5f);
-					controller1.connected = false;
-					Log::debug("Controller 1 disconnected in main");
-
-				}
-
-			}
-
-			if (glfwJoystickPresent(GLFW_JOYSTICK_2)) {
-				if (!controller2.connected) {
-					AudioManager::get().playSound(SFX_CONTROLLER_ON, 0.3f);
-					controller2 = InputController(GLFW_JOYSTICK_2);
-
-					controller2.connected = true;
-					Log::debug("Controller 2 Connecter in main");
-				}
-			}
-			else {
-				if (controller2.connected) {
-					AudioManager::get().playSound(SFX_CONTROLLER_OFF, 0.5f);
-					controller2.connected = false;
-					Log::debug("Controller 2 connected in main");
-
-				}
-
-			}
-
-			if (glfwJoystickPresent(GLFW_JOYSTICK_3)) {
-				if (!controller3.connected) {
-					AudioManager::get().playSound(SFX_CONTROLLER_ON, 0.3f);
-					controller3 = InputController(GLFW_JOYSTICK_3);
-
-					controller3.connected = true;
-					Log::debug("Controller 3 Connecter in main");
-				}
-			}
-			else {
-				if (controller3.connected) {
-					AudioManager::get().playSound(SFX_CONTROLLER_OFF, 0.5f);
-					controller3.connected = false;
-					Log::debug("Controller 3 connected in main");
-
-				}
-
-			}
-			if (glfwJoystickPresent(GLFW_JOYSTICK_4)) {
-				if (!controller4.connected) {
-					AudioManager::get().playSound(SFX_CONTROLLER_ON, 0.3f);
-					controller4 = InputController(GLFW_JOYSTICK_4);
-
-					controller4.connected = true;
-					Log::debug("Controller 4 Connecter in main");
-				}
-			}
-			else {
-				if (controller4.connected) {
-					AudioManager::get().playSound(SFX_CONTROLLER_OFF, 0.5f);
-					controller4.connected = false;
-					Log::debug("Controller 4 connected in main");
-
-				}
-
-			}
-
-			switch (GameManager::get().screen) {
-			case Screen::eMAINMENU: {
-				if (controller1.connected) controller1.uniController(false, player);
-				if (controller2.connected) controller2.uniController(false, enemy);
-				if (controller3.connected) controller3.uniController(false, enemy2);
-				if (controller4.connected) controller4.uniController(false, enemy3);
-
-				break; }
-			case Screen::eLOADING: {
-
-				// set up init game here
-				time.resetStats();
-
-				for (PVehicle* carPtr : vehicleList) {
-					carPtr->m_state = VehicleState::ePLAYING;
-					carPtr->m_lives = 3;
-					carPtr->vehicleAttr.collisionCoefficient = 0.0f;
-					carPtr->m_shieldState = ShieldPowerUpState::eINACTIVE;
-					carPtr->m_powerUpPocket = PowerUpType::eEMPTY;
-					carPtr->reset();
-				}
-				for (PowerUp* powerUpPtr : powerUps) {
-					powerUpPtr->forceRespawn();
-				}
-				for (int i = 0; i < GameManager::get().playerNumber; i++)
-				{
-					vehicleList[i]->setCar_tpye(PlayerOrAI::ePLAYER);
-
-				}
-				for (int i = 3; i >= GameManager::get().playerNumber; i--)
-				{
-					vehicleList[i]->setCar_tpye(PlayerOrAI::eAI);
-				}
-				AudioManager::get().setCarSoundsPause(false);
-				AudioManager::get().startGame();
-				GameManager::get().screen = Screen::ePLAYING;
-
-
-				if (GameManager::get().playerNumber > 1 && !GameManager::get().multiplayer60FPS) time.toMultiplayerMode();
-				else time.toSinglePlayerMode();
-
-				break; }
-			case Screen::ePLAYING: {
-
-				if (GameManager::get().paused) { // paused, read the inputs using the menu function
-					if (controller1.connected) controller1.uniController(false, player);
-					if (controller2.connected) controller2.uniController(false, enemy);
-					if (controller3.connected) controller3.uniController(false, enemy2);
-					if (controller4.connected) controller4.uniController(false, enemy3);
-				}
-				else { // in game
-
-					if (controller1.connected) controller1.uniController(true, player);
-					if (controller2.connected && enemy.m_carType == PlayerOrAI::ePLAYER && !singlePlayerIndicator) controller2.uniController(true, enemy);
-					if (controller3.connected && enemy2.m_carType == PlayerOrAI::ePLAYER && !singlePlayerIndicator) controller3.uniController(true, enemy2);
-					if (controller4.connected && enemy3.m_carType == PlayerOrAI::ePLAYER && !singlePlayerIndicator) controller4.uniController(true, enemy3);
-
-
-					int deadCounter = 0;
-					now = steady_clock::now();
-
-					for (PVehicle* carPtr : vehicleList) {
-						if (carPtr->vehicleAttr.collided) {
-							carPtr->getRigidDynamic()->addForce((carPtr->vehicleAttr.forceToAdd), PxForceMode::eIMPULSE);
-							carPtr->getRigidDynamic()->addForce(PxVec3(0.f, 10.f + 5.f * carPtr->vehicleAttr.collisionCoefficient, 0.f), PxForceMode::eVELOCITY_CHANGE);
-							carPtr->flashWhite();
-							carPtr->vehicleAttr.collided = false;
-							AudioManager::get().playSound(SFX_CAR_HIT, Utils::instance().pxToGlmVec3(carPtr->vehicleAttr.collisionMidpoint), 0.3f);
-						}
-
-						if (carPtr->m_carType == PlayerOrAI::eAI && (carPtr->vehicleAttr.reachedTarget || duration_cast<seconds>(now - carPtr->vehicleAttr.targetTimestamp) > seconds(15)) ) {
-							carPtr->vehicleAttr.targetTimestamp = now;
-							int halfChance = Utils::instance().random(0, 2);
-							if (halfChance == 0 || halfChance == 1) {
-								int rndIndex = Utils::instance().random(0, (int)vehicleList.size() - 1);
-								if (vehicleList[rndIndex] != carPtr && vehicleList[rndIndex]->m_state == VehicleState::ePLAYING) {
-									carPtr->vehicleAttr.reachedTarget = false;
-									carPtr->driveTo(vehicleList[rndIndex]->getPosition(), vehicleList[rndIndex], nullptr);
-								}
-							}
-							else {
-								int rndIndex = Utils::instance().random(0, (int)powerUps.size() - 1);
-								if (powerUps[rndIndex]->active) {
-									carPtr->vehicleAttr.reachedTarget = false;
-									carPtr->driveTo(powerUps[rndIndex]->getPosition(), nullptr, powerUps[rndIndex]);
-								}
-								else {
-									int rndIndex = Utils::instance().random(0, (int)vehicleList.size() - 1);
-									if (vehicleList[rndIndex] != carPtr && vehicleList[rndIndex]->m_state == VehicleState::ePLAYING) {
-										carPtr->vehicleAttr.reachedTarget = false;
-										carPtr->driveTo(vehicleList[rndIndex]->getPosition(), vehicleList[rndIndex], nullptr);
-									}
-								}
-							}
-						}
-
-						carPtr->updateState(); // to check for car death
-
-						if (carPtr->m_state == VehicleState::eOUTOFLIVES) {
-							deadCounter++;
-							if (singlePlayerIndicator && player.m_state == VehicleState::eOUTOFLIVES) { // if single player died first
-								AudioManager::get().gameOver();
-								GameManager::get().screen = Screen::eGAMEOVER;
-								GameManager::get().winner = 3; // set winner to 3 but not actually 3 because we are ending the game early
-								winnerList.clear();
-								winnerList.push_back(vehicleList.at(GameManager::get().winner));
-								winnerCar = vehicleList.at(GameManager::get().winner);
-								winnerCar->vehicleAttr.collisionCoefficient = 0.0f;
-							}
-						}
-
-						cameraList.at(carPtr->carid)->m_fov = 80 + (carPtr->getRigidDynamic()->getLinearVelocity().magnitude() / 9.f);
-
-					}
-
-					if (deadCounter == (vehicleList.size() - 1)) {
-						for (PVehicle* carPtr : vehicleList) {
-							if (carPtr->m_state != VehicleState::eOUTOFLIVES) GameManager::get().winner = carPtr->carid;
-						}
-						AudioManager::get().gameOver();
-						winnerList.clear();
-						winnerList.push_back(vehicleList.at(GameManager::get().winner));
-						winnerCar = vehicleList.at(GameManager::get().winner);
-						winnerCar->vehicleAttr.collisionCoefficient = 0.0f;	
-						//vehicleList.at(GameManager::get().winner)
-						GameManager::get().screen = Screen::eGAMEOVER;
-					}
-
-
-					for (PowerUp* powerUpPtr : powerUps) {
-						if (!powerUpPtr->active) {
-							powerUpPtr->tryRespawn();
-						}
-						else if (powerUpPtr->triggered) {
-							AudioManager::get().playSound(SFX_ITEM_COLLECT, Utils::instance().pxToGlmVec3(powerUpPtr->getPosition()), 0.3f);
-							powerUpPtr->collect();
-						}
-					}
-
-
-
-					if (ai_ON) {
-						for (int i = 0; i < vehicleList.size(); i++) {
-							if (vehicleList[i]->m_carType == PlayerOrAI::ePLAYER) continue;
-							PVehicle* targetVehicle = (PVehicle*)vehicleList[i]->vehicleAttr.targetVehicle;
-							PowerUp* targetPowerUp = (PowerUp*)vehicleList[i]->vehicleAttr.targetPowerup;
-							if (targetVehicle) vehicleList[i]->driveTo(targetVehicle->getPosition(), targetVehicle, nullptr);
-							else if (targetPowerUp) vehicleList[i]->driveTo(targetPowerUp->getPosition(), nullptr, targetPowerUp);
-							else {
-								int halfChance = Utils::instance().random(0, 2);
-								if (halfChance == 0 || halfChance == 1) {
-									int rndIndex = Utils::instance().random(0, (int)vehicleList.size() - 1);
-									if (vehicleList[rndIndex] != vehicleList[i] && vehicleList[rndIndex]->m_state == VehicleState::ePLAYING) {
-										vehicleList[i]->driveTo(vehicleList[rndIndex]->getPosition(), vehicleList[rndIndex], nullptr);
-									}
-								}
-								else {
-									int rndIndex = Utils::instance().random(0, (int)powerUps.size() - 1);
-									if (powerUps[rndIndex]->active) vehicleList[i]->driveTo(powerUps[rndIndex]->getPosition(), nullptr, powerUps[rndIndex]);
-									else {
-										int rndIndex = Utils::instance().random(0, (int)vehicleList.size() - 1);
-										if (vehicleList[rndIndex] != vehicleList[i] && vehicleList[rndIndex]->m_state == VehicleState::ePLAYING) {
-											vehicleList[i]->driveTo(vehicleList[rndIndex]->getPosition(), vehicleList[rndIndex], nullptr);
-										}
-									}
-								}
-							}
-						}
-					}
-
-
-
-
-					pm.simulate();
-
-					for (PVehicle* vehicle : vehicleList) vehicle->updatePhysics();
-
-					time.endSimTimer();
-				}
-
-				break; }
-			case Screen::eGAMEOVER: {
-				if (controller1.connected) controller1.uniController(false, player);
-				if (controller2.connected) controller2.uniController(false, enemy);
-				if (controller3.connected) controller3.uniController(false, enemy2);
-				if (controller4.connected) controller4.uniController(false, enemy3);
-				break; }
-			}
-			time.endSimTimer(); // end sim timer !
+	// Replays
+	Replay replay;
+	if (!replayPath.empty() && replay.load(replayPath)) {
+		// straight into the recorded match, with the same viewports.
+		GameManager::get().playerNumber = PxMax(replay.getPlayerNumber(), 1);
+		GameManager::get().screen = Screen::eLOADING;
+	}
+	else if (!recordPath.empty()) replay.record();
+	match.setReplay(&replay);
+
+
+	// Simulation and rendering run on separate threads. The main thread keeps polling events (GLFW
+	// only allows that from the main thread) and steps the game, publishing a SceneSnapshot after each
+	// step; the render thread owns the GL context and only ever reads the latest snapshot.
+	SnapshotBuffer snapshots;
+	std::vector<InputController*> controllerList = { &controller1, &controller2, &controller3, &controller4 };
+	int statsResets = 0;
+	auto publishSnapshot = [&]() {
+		SceneSnapshot& snapshot = snapshots.back();
+		snapshot.vehicles.resize(vehicleList.size());
+		for (size_t i = 0; i < vehicleList.size(); i++) vehicleList[i]->writeSnapshot(snapshot.vehicles[i]);
+		snapshot.powerUps.resize(powerUps.size());
+		for (size_t i = 0; i < powerUps.size(); i++) powerUps[i]->writeSnapshot(snapshot.powerUps[i]);
+
+		snapshot.screen = GameManager::get().screen;
+		snapshot.mainMenuScreen = GameManager::get().mainMenuScreen;
+		snapshot.menuButton = GameManager::get().menuButton;
+		snapshot.playerSelectButton = GameManager::get().playerSelectButton;
+		snapshot.optionsButton = GameManager::get().optionsButton;
+		snapshot.pauseButton = GameManager::get().pauseButton;
+		snapshot.paused = GameManager::get().paused;
+		snapshot.playerNumber = GameManager::get().playerNumber;
+		snapshot.winner = winnerCar->carid;
+		snapshot.multiplayer = time.multiplayer;
+		snapshot.statsResets = statsResets;
+
+		snapshot.bgmLevel = AudioManager::get().getBGMLevel();
+		snapshot.sfxLevel = AudioManager::get().getSFXLevel();
+		snapshot.multiplayerFPS = GameManager::get().getMultiplayerFPS();
+		snapshot.shadowQuality = GameManager::get().shadowQuality;
+		snapshot.shadowQualityName = GameManager::get().getShadowQuality();
+
+		for (int i = 0; i < 4; i++) {
+			snapshot.controllerConnected[i] = controllerList[i]->connected;
+			snapshot.controllerStartHeld[i] = controllerList[i]->startHeld;
 		}
-
-		if (time.shouldRender) {
+		snapshots.publish();
+	};
+	publishSnapshot();
+
+	CookCache::get().logStats();
+	TextureCache::get().logStats();
+	Log::info("Startup took {:.2f} s", duration<double>(steady_clock::now() - launchTime).count());
+
+	std::atomic<bool> running(true);
+	// 1 ms sleeps for both loops, the default ~15.6 ms tick would wake the sim two steps at a time
+	timeBeginPeriod(1);
+	glfwMakeContextCurrent(NULL); // hand the context over to the render thread
+	std::thread renderThread([&]() {
+		window.makeContextCurrent();
+		time_point<steady_clock> nextFrame = steady_clock::now();
+
+		Profiler::get().setThreadName("render");
+		GpuTimer gpuTimer;
+		renderer.setGpuTimer(&gpuTimer); // per pass scopes inside the scene's queue flush
+		ImguiManager overlay; // profiler overlay, display only so it never touches GLFW from this thread
+		std::vector<PhaseStats> profileStats;
+		int profileFrame = 0;
+		fmt::memory_buffer hudText; // reused every frame for the HUD numbers, so formatting them doesn't allocate
+		time_point<steady_clock> lastFrame = steady_clock::now();
+		int lastStatsReset = 0;
+		static const char* const VIEWPORT_NAMES[4] = { "viewport 1", "viewport 2", "viewport 3", "viewport 4" };
+
+		while (running) {
+			Profiler::get().begin("frame");
+			gpuTimer.beginFrame();
+			const SceneSnapshot& snapshot = snapshots.acquire();
+			glEnable(GL_DEPTH_TEST);
+
+			if (snapshot.statsResets != lastStatsReset) {
+				time.resetRenderStats();
+				lastStatsReset = snapshot.statsResets;
+			}
 			time.startRenderTimer();
+			const float alpha = snapshot.getInterpolationAlpha(time.SIM_STEP);
+			if (snapshot.shadowQuality != renderer.getShadowQuality()) renderer.setShadowQuality(snapshot.shadowQuality);
 			renderer.startFrame();
-			switch (GameManager::get().screen) {
+			switch (snapshot.screen) {
 			case Screen::eMAINMENU: {
-				singlePlayerIndicator = true;
+				PROFILE_SCOPE("menu");
 				renderer.m_currentViewportActive = 4;
+				renderer.prepareViewports(1); // full size cascades again after a split-screen match
+				renderer.renderCascades(vehicleList, snapshot.vehicles, powerUps, snapshot.powerUps, alpha);
 				renderer.skybox.draw(menuCamera.getPerspMat(), glm::mat4(glm::mat3(menuCamera.getViewMat())));
 
 				os = (sin((float)colorVar / 20) + 1.0) / 2.0;
 				colorVar++;
+				renderer.beginQueue();
 				renderer.renderNormalObjects(trees, grassPatches); // prepare to draw NORMAL objects, doesn't actually render anything.
 				pm.drawGround();
 
-				renderer.renderTransparentObjects(vehicleList, sphere, os, time);
+				renderer.renderTransparentObjects(vehicleList, snapshot.vehicles, sphere, os, time, alpha);
 
-				bottom.draw();
-				bottom1.draw();
-				bottom2.draw();
-				bottom3.draw();
-				bottom4.draw();
-				toruses.draw();
+				renderer.flushQueue();
+				renderer.renderStaticObjects(os);
 
-				spike1.draw();
-				spike2.draw();
-				spike3.draw();
-				spike4.draw();
 
-
-				switch (GameManager::get().mainMenuScreen) {
+				switch (snapshot.mainMenuScreen) {
 				case MainMenuScreen::eMAIN_SCREEN: {
 
 					for (int i = 0; i < 6; i++) {
-						if ((int)GameManager::get().menuButton == i) buttonColors.at(i) = selCol;
+						if ((int)snapshot.menuButton == i) buttonColors.at(i) = selCol;
 						else buttonColors.at(i) = regCol;
 					}
 					menuText.RenderText("SINGLEPLAYER", 50, 283, 1.2f, buttonColors.at(0));
@@ -568,45 +523,45 @@ int main(int argc, char** argv) {
 					menuTextWidth.at(4) = menuText.totalW;
 					menuText.RenderText("QUIT", 50, 283 + 114 * 5, 1.2f, buttonColors.at(5));
 					menuTextWidth.at(5) = menuText.totalW;
-					mainMenu.draw(menu, glm::vec2(944, 635), glm::vec2(1.492f * 557.f, 1.492 * 284.f), 0, glm::vec3(1.f, 1.f, 1.f));
+					sprites.draw(menu, glm::vec2(944, 635), glm::vec2(1.492f * 557.f, 1.492 * 284.f), 0, glm::vec3(1.f, 1.f, 1.f));
 
 					
 
 					break; }
 				case MainMenuScreen::eMULTIPLAYER_SCREEN:
-					singlePlayerIndicator = false;
 					for (int i = 0; i < 2; i++) {
-						if ((int)GameManager::get().playerSelectButton == i) playerSelectButtonColors.at(i) = selCol;
+						if ((int)snapshot.playerSelectButton == i) playerSelectButtonColors.at(i) = selCol;
 						else playerSelectButtonColors.at(i) = regCol;
 					}
 
-					menuText.RenderText("Select number of players: " + std::to_string(GameManager::get().playerNumber), 94.f, 447.f, 1.0f, playerSelectButtonColors.at(0));
+					menuText.RenderText("Select number of players: " + std::to_string(snapshot.playerNumber), 94.f, 447.f, 1.0f, playerSelectButtonColors.at(0));
 					menuText.RenderText("START", 94.f, 547.f, 1.0f, playerSelectButtonColors.at(1));
 					menuText.RenderText("Hold START to check controller", 1034.f, 50.f, 1.0f, regCol);
 
 
 
-					if (controller1.connected) image1.draw(con, glm::vec2(1047.f, 598.f), glm::vec2(320.f, 160.f), 0, controllerColors.at(controller1.startHeld * 1));
-					if (controller2.connected) image1.draw(con, glm::vec2(1047.f + 440.f, 598.f), glm::vec2(320.f, 160.f), 0, controllerColors.at(controller2.startHeld * 2));
-					if (controller3.connected) image1.draw(con, glm::vec2(1047.f, 598.f + 250.f), glm::vec2(320.f, 160.f), 0, controllerColors.at(controller3.startHeld * 3));
-					if (controller4.connected) image1.draw(con, glm::vec2(1047.f + 440.f, 598.f + 250.f), glm::vec2(320.f, 160.f), 0, controllerColors.at(controller4.startHeld * 4));
+					if (snapshot.controllerConnected[0]) sprites.draw(con, glm::vec2(1047.f, 598.f), glm::vec2(320.f, 160.f), 0, controllerColors.at(snapshot.controllerStartHeld[0] * 1));
+					if (snapshot.controllerConnected[1]) sprites.draw(con, glm::vec2(1047.f + 440.f, 598.f), glm::vec2(320.f, 160.f), 0, controllerColors.at(snapshot.controllerStartHeld[1] * 2));
+					if (snapshot.controllerConnected[2]) sprites.draw(con, glm::vec2(1047.f, 598.f + 250.f), glm::vec2(320.f, 160.f), 0, controllerColors.at(snapshot.controllerStartHeld[2] * 3));
+					if (snapshot.controllerConnected[3]) sprites.draw(con, glm::vec2(1047.f + 440.f, 598.f + 250.f), glm::vec2(320.f, 160.f), 0, controllerColors.at(snapshot.controllerStartHeld[3] * 4));
 
 					break;
 				case MainMenuScreen::eHOWTOPLAY_SCREEN:
-					image1.draw(texture, glm::vec2(0.f, 0.f), glm::vec2(Utils::instance().SCREEN_WIDTH, Utils::instance().SCREEN_HEIGHT), 0, glm::vec3(1.f, 1.f, 1.f));
+					sprites.draw(texture, glm::vec2(0.f, 0.f), glm::vec2(Utils::instance().SCREEN_WIDTH, Utils::instance().SCREEN_HEIGHT), 0, glm::vec3(1.f, 1.f, 1.f));
 
 
 					break;
 				case MainMenuScreen::eOPTIONS_SCREEN:
-					for (int i = 0; i < 4; i++) {
-						if ((int)GameManager::get().optionsButton == i) optionsButtonColors.at(i) = selCol;
+					for (int i = 0; i < 5; i++) {
+						if ((int)snapshot.optionsButton == i) optionsButtonColors.at(i) = selCol;
 						else optionsButtonColors.at(i) = regCol;
 					}
 
-					menuText.RenderText("BGM: " + std::to_string(AudioManager::get().getBGMLevel()), 165, 310, 1.0f, optionsButtonColors.at(0));
-					menuText.RenderText("SFX: " + std::to_string(AudioManager::get().getSFXLevel()), 165, 310 + 105, 1.0f, optionsButtonColors.at(1));
-					menuText.RenderText("Multiplayer FPS:  " + GameManager::get().getMultiplayerFPS() ,165, 310 + 105 * 2, 1.0f, optionsButtonColors.at(2));
-					menuText.RenderText("BACK", 165, 310 + 105 * 3, 1.0f, optionsButtonColors.at(3));
+					menuText.RenderText("BGM: " + std::to_string(snapshot.bgmLevel), 165, 310, 1.0f, optionsButtonColors.at(0));
+					menuText.RenderText("SFX: " + std::to_string(snapshot.sfxLevel), 165, 310 + 105, 1.0f, optionsButtonColors.at(1));
+					menuText.RenderText("Multiplayer FPS:  " + snapshot.multiplayerFPS ,165, 310 + 105 * 2, 1.0f, optionsButtonColors.at(2));
+					menuText.RenderText("Shadows:  " + snapshot.shadowQualityName, 165, 310 + 105 * 3, 1.0f, optionsButtonColors.at(3));
+					menuText.RenderText("BACK", 165, 310 + 105 * 4, 1.0f, optionsButtonColors.at(4));
 
 
 					break;
@@ -633,55 +588,46 @@ int main(int argc, char** argv) {
 				break; }
 
 			case Screen::ePLAYING: {
-				printNumbers = "      ";
-				for (PVehicle* carPtr : vehicleList) {
-					printNumbers += fmt::format("{:.1f}", carPtr->vehicleAttr.collisionCoefficient);
-					printNumbers += " ";
-				}
-				printNumbers += "         ";
-				for (PVehicle* carPtr : vehicleList) {
-					printNumbers += std::to_string(carPtr->m_lives);
-					printNumbers += "    ";
+				{
+					// one light-space depth map shared by every viewport
+					PROFILE_SCOPE("shadows");
+					GPU_SCOPE(gpuTimer, "shadows");
+					renderer.renderShadows(vehicleList, snapshot.vehicles, powerUps, snapshot.powerUps, alpha);
 				}
-				AudioManager::get().updateCarSounds();
-				AudioManager::get().setListenerPosition(Utils::instance().pxToGlmVec3(player.getPosition()), player.getFrontVec(), player.getUpVec());
-
-				for (int currentViewport = 0; currentViewport < GameManager::get().playerNumber; currentViewport++) {
-					renderer.switchViewport(GameManager::get().playerNumber, currentViewport);
-					cameraList.at(currentViewport)->updateCameraPosition(Utils::instance().pxToGlmVec3(vehicleList.at(currentViewport)->getPosition()), vehicleList.at(currentViewport)->getFrontVec()); // only move cam once.
-					//map1.displayMap(player, &vehicleList, &imageList, currentViewport);
-
-					os = (sin((float)colorVar / 20) + 1.0) / 2.0;
-					colorVar++;
-					renderer.renderShadows(vehicleList, powerUps);
-					renderer.skybox.draw(cameraList.at(currentViewport)->getPerspMat(), glm::mat4(glm::mat3(cameraList.at(currentViewport)->getViewMat())));
-					renderer.renderCars(vehicleList);
-					renderer.renderPowerUps(powerUps, os);
+				// the 3D part of every viewport, the same draws either once per viewport or once for all of them
+				auto renderScene = [&]() {
+					Profiler::get().begin("scene");
+					// everything below only submits, the draws happen sorted in flushQueue
+					// and every pass gets its own GPU scope there
+					renderer.beginQueue();
+					renderer.setPass("cars");
+					renderer.renderCars(vehicleList, snapshot.vehicles, alpha);
+					renderer.setPass("power-ups");
+					renderer.renderPowerUps(powerUps, snapshot.powerUps, os, alpha);
+					renderer.setPass("normal objects");
 					renderer.renderNormalObjects(trees, grassPatches); // prepare to draw NORMAL objects, doesn't actually render anything.
 					pm.drawGround();
 
-					renderer.renderTransparentObjects(vehicleList, sphere, os, time);
-
-					bottom.draw();
-					bottom1.draw();
-					bottom2.draw();
-					bottom3.draw();
-					bottom4.draw();
-					toruses.draw();
-
-					spike1.draw();
-					spike2.draw();
-					spike3.draw();
-					spike4.draw();
-
-
+					renderer.setPass("transparent");
+					renderer.renderTransparentObjects(vehicleList, snapshot.vehicles, sphere, os, time, alpha);
+
+					renderer.flushQueue();
+					gpuTimer.begin("props");
+					renderer.renderStaticObjects(os); // blended like the transparent objects, so after them
+					gpuTimer.end();
+					Profiler::get().end();
+				};
+				auto renderHud = [&](int viewport) {
+					const VehicleSnapshot& viewportCar = snapshot.vehicles.at(viewport);
+					PROFILE_SCOPE("hud");
+					GPU_SCOPE(gpuTimer, "hud");
 					renderer.useDefaultShader();
-					map1.displayMap(player, &vehicleList, &imageList, currentViewport);
+					map1.displayMap(snapshot.vehicles, viewport);
 
 
-					if (GameManager::get().paused) {
+					if (snapshot.paused) {
 						for (int i = 0; i < 2; i++) {
-							if ((int)GameManager::get().pauseButton == i) pausedButtonColors.at(i) = selCol;
+							if ((int)snapshot.pauseButton == i) pausedButtonColors.at(i) = selCol;
 							else pausedButtonColors.at(i) = regCol;
 						}
 						menuText.RenderText("PAUSED",30 ,44 -20, 2,  glm::vec3(0.992f, 0.164f, 0.129f));
@@ -691,86 +637,354 @@ int main(int argc, char** argv) {
 						pauseTextWidth.at(1) = menuText.totalW;
 					}
 
-					//menuText.RenderText("Damage: P1  P2  P3  P4 Lives: P1  P2  P3  P4", 7.547f, 7.547f, 0.5f, glm::vec3(204.f / 255.f, 0.f, 102.f / 255.f));
-					//menuText.RenderText(printNumbers, 60.f, 30.f, 0.5f, glm::vec3(204.f / 255.f, 0.f, 102.f / 255.f));
-
-					for (PVehicle* carPtr : vehicleList) {
-						for (int i = 0; i < carPtr->m_lives; i++) {
-							image1.draw(white_heart, glm::vec2(635.f + (carPtr->carid * 180.f) + (i * 38), 20 + 72 - 14), glm::vec2(30, 30), 0, playerColors.at(carPtr->carid)); //x = 160 OG
-							//image1.draw(white_heart, glm::vec2(x + (carPtr->carid * xgap) + (i * ygap), y), glm::vec2(30, 30), 0, playerColors.at(carPtr->carid)); // x 15 y 141 xgap 163 ygap 38
+					for (const VehicleSnapshot& car : snapshot.vehicles) {
+						for (int i = 0; i < car.lives; i++) {
+							sprites.draw(white_heart, glm::vec2(635.f + (car.carid * 180.f) + (i * 38), 20 + 72 - 14), glm::vec2(30, 30), 0, playerColors.at(car.carid)); //x = 160 OG
 						}
-						//fmt::format("{:.1f}", carPtr->vehicleAttr.collisionCoefficient);
-						menuText.RenderText(fmt::format("{:.1f}", carPtr->vehicleAttr.collisionCoefficient * 19.f) + "%", 635.f + (carPtr->carid * 180.f), 20, 1.131, glm::vec3(0.f, 0.f, 0.f));
-						//menuText.RenderText(fmt::format("{:.1f}", carPtr->vehicleAttr.collisionCoefficient) + "%", 15 + (carPtr->carid * x), 400.f, 1.131, glm::vec3(204.f / 255.f, 0.f, 102.f / 255.f));
+						hudText.clear();
+						fmt::format_to(std::back_inserter(hudText), "{:.1f}%", car.damage * 19.f);
+						menuText.RenderText(std::string_view(hudText.data(), hudText.size()), 635.f + (car.carid * 180.f), 20, 1.131, glm::vec3(0.f, 0.f, 0.f));
 					}
 
-					//menuText.RenderText(printNumbers, x, y, xgap, glm::vec3(204.f / 255.f, 0.f, 102.f / 255.f));
-
-					boost.RenderText(std::to_string(vehicleList.at(currentViewport)->vehicleParams.boost), 15.f, Utils::instance().SCREEN_HEIGHT - 85.0f, 1.0f, glm::vec3(0.992f, 0.164f, 0.129f));
-					switch (vehicleList.at(currentViewport)->getPocket()) {
+					hudText.clear();
+					fmt::format_to(std::back_inserter(hudText), "{}", viewportCar.boost);
+					boost.RenderText(std::string_view(hudText.data(), hudText.size()), 15.f, Utils::instance().SCREEN_HEIGHT - 85.0f, 1.0f, glm::vec3(0.992f, 0.164f, 0.129f));
+					switch (viewportCar.pocket) {
 					case PowerUpType::eEMPTY:
-						//currentPowerup.RenderText("Pocket: Empty", 7.547f, 60.f, 1.0f, glm::vec3(0.478f, 0.003f, 0.f));
 						break;
 					case PowerUpType::eJUMP:
-						//currentPowerup.RenderText("Pocket: Jump", 7.547f, 60.f, 1.0f, glm::vec3(1.f, 0.050f, 0.039f));
-						image1.draw(star, glm::vec2(Utils::instance().SCREEN_WIDTH - 250.f, Utils::instance().SCREEN_HEIGHT - 250.f), glm::vec2(250.f, 250.f), 0, glm::vec3(1.f, 1.f, 0));
+						sprites.draw(star, glm::vec2(Utils::instance().SCREEN_WIDTH - 250.f, Utils::instance().SCREEN_HEIGHT - 250.f), glm::vec2(250.f, 250.f), 0, glm::vec3(1.f, 1.f, 0));
 						break;
 					case PowerUpType::eSHIELD:
-						//currentPowerup.RenderText("Pocket: Shield", 7.547f, 60.f, 1.0f, glm::vec3(1.f, 0.050f, 0.039f));
-						image1.draw(shield, glm::vec2(Utils::instance().SCREEN_WIDTH - 250.f, Utils::instance().SCREEN_HEIGHT - 250.f), glm::vec2(250.f, 250.f), 0, glm::vec3(1.0f, 0.5f, 0.31f));
+						sprites.draw(shield, glm::vec2(Utils::instance().SCREEN_WIDTH - 250.f, Utils::instance().SCREEN_HEIGHT - 250.f), glm::vec2(250.f, 250.f), 0, glm::vec3(1.0f, 0.5f, 0.31f));
 						break;
 
 					}
+					sprites.flush();
+					TextRenderer::Flush(); // this viewport's images and text, before the next one is switched to
+				};
+
+				const bool singlePass = renderer.prepareViewports(snapshot.playerNumber);
+				for (int currentViewport = 0; currentViewport < snapshot.playerNumber; currentViewport++) {
+					PROFILE_SCOPE(VIEWPORT_NAMES[currentViewport]);
+					const VehicleSnapshot& viewportCar = snapshot.vehicles.at(currentViewport);
+					renderer.switchViewport(snapshot.playerNumber, currentViewport);
+					cameraList.at(currentViewport)->m_fov = 80 + (viewportCar.speed / 9.f);
+					cameraList.at(currentViewport)->updateCameraPosition(Utils::instance().pxToGlmVec3(viewportCar.getInterpolatedPose(alpha).p), viewportCar.frontVec); // only move cam once.
+					{
+						// cascades follow this camera, nothing is shared with the other viewports
+						PROFILE_SCOPE("cascades");
+						GPU_SCOPE(gpuTimer, "cascades");
+						renderer.renderCascades(vehicleList, snapshot.vehicles, powerUps, snapshot.powerUps, alpha);
+					}
 
+					os = (sin((float)colorVar / 20) + 1.0) / 2.0;
+					colorVar++;
+					gpuTimer.begin("skybox");
+					renderer.skybox.draw(cameraList.at(currentViewport)->getPerspMat(), glm::mat4(glm::mat3(cameraList.at(currentViewport)->getViewMat())));
+					gpuTimer.end();
+					if (singlePass) continue; // scene and HUD after every camera and its cascades are ready
+
+					renderScene();
+					renderHud(currentViewport);
+				}
 
+				if (singlePass) {
+					{
+						PROFILE_SCOPE("single pass");
+						renderer.beginSinglePass();
+						renderScene();
+						renderer.endSinglePass();
+					}
+					for (int currentViewport = 0; currentViewport < snapshot.playerNumber; currentViewport++) {
+						PROFILE_SCOPE(VIEWPORT_NAMES[currentViewport]);
+						renderer.switchViewport(snapshot.playerNumber, currentViewport);
+						renderHud(currentViewport);
+					}
 				}
 
 				break; }
 			case Screen::eGAMEOVER: {	
-
+				PROFILE_SCOPE("game over");
 				renderer.m_currentViewportActive = 4;
+				renderer.prepareViewports(1); // full size cascades again after a split-screen match
+				renderer.renderCascades(vehicleList, snapshot.vehicles, powerUps, snapshot.powerUps, alpha);
 				renderer.skybox.draw(menuCamera.getPerspMat(), glm::mat4(glm::mat3(menuCamera.getViewMat())));
 
 				os = (sin((float)colorVar / 20) + 1.0) / 2.0;
 				colorVar++;
+				renderer.beginQueue();
 				renderer.renderNormalObjects(trees, grassPatches); // prepare to draw NORMAL objects, doesn't actually render anything.
 				pm.drawGround();
 
-				if (winnerList.size() > 0)
-				{
-					winnerCar->getRigidDynamic()->setGlobalPose(PxTransform(PxVec3(-242.f, 300.f, 380.f), PxQuat(PxPi, PxVec3(0.f, 0.f, 0.f))));
-					renderer.renderCars(winnerList);
-				}
+				renderer.renderCars({ vehicleList.at(snapshot.winner) }, { snapshot.vehicles.at(snapshot.winner) }, alpha);
 
-		
-				renderer.renderTransparentObjects(vehicleList, sphere, os, time);
+				renderer.renderTransparentObjects(vehicleList, snapshot.vehicles, sphere, os, time, alpha);
 
 				bottom3.draw();
 				toruses.draw();
 
 				spike3.draw();
 				spike4.draw();
+				renderer.flushQueue();
 
 				menuText.RenderText("Game Over", 123, 323,1,  glm::vec3(204.f / 255.f, 0.f, 102.f / 255.f));
-				menuText.RenderText("Player " + std::to_string(GameManager::get().winner + 1) + " wins",123, 323 + 120, 1.0f, glm::vec3(204.f / 255.f, 0.f, 102.f / 255.f));
+				menuText.RenderText("Player " + std::to_string(snapshot.winner + 1) + " wins",123, 323 + 120, 1.0f, glm::vec3(204.f / 255.f, 0.f, 102.f / 255.f));
 				menuText.RenderText("QUIT ", 123, 323 + 120 * 2, 1.0f, selCol);
 
 
 				break; }
 			}
+			sprites.flush();
+			TextRenderer::Flush(); // all of the frame's text in one draw, over everything but the overlay
+
+			if (Profiler::get().showOverlay) {
+				PROFILE_SCOPE("overlay");
+				if (profileFrame++ % 30 == 0) profileStats = Profiler::get().computeStats(); // twice a second is plenty to read
+				glViewport(0, 0, Utils::instance().SCREEN_WIDTH, Utils::instance().SCREEN_HEIGHT);
+				overlay.initOverlayFrame(duration<float>(steady_clock::now() - lastFrame).count());
+				overlay.renderProfiler(profileStats, renderer.getCameraCullStats(), renderer.getShadowCullStats(), renderer.getQueueStats(), renderer.getLodStats());
+				overlay.endFrame();
+			}
+			lastFrame = steady_clock::now();
 
-			renderer.endFrame();
+			{
+				PROFILE_SCOPE("swap");
+				renderer.endFrame();
+			}
 			glViewport(0, 0, Utils::instance().SCREEN_WIDTH, Utils::instance().SCREEN_HEIGHT); // bring the viewport back to original
 			time.endRenderTimer();
+			Profiler::get().end(); // frame
+
+			// 16666.. microseconds = 16.666 ms is one frame at 60fps OR 30fps 33.333 ms for 30fps
+			nextFrame += microseconds(time.FPSArray[snapshot.multiplayer]);
+			if (nextFrame < steady_clock::now()) nextFrame = steady_clock::now();
+			std::this_thread::sleep_until(nextFrame);
+		}
+
+		overlay.freeImgui();
+		renderer.setGpuTimer(nullptr);
+		gpuTimer.free();
+		glfwMakeContextCurrent(NULL);
+	});
+
+
+	while (!window.shouldClose() && !GameManager::get().quitGame) {
+
+		// always update the time and poll events
+		time.update();
+		glfwPollEvents();
+
+		if (inputManager->onKeyAction(GLFW_KEY_F3, GLFW_PRESS)) Profiler::get().showOverlay = !Profiler::get().showOverlay;
+		if (inputManager->onKeyAction(GLFW_KEY_F4, GLFW_PRESS)) exportProfile();
+		inputManager->refreshInput();
+
+		// run as many fixed steps as the accumulator holds (capped in Time), rendering then blends the last two.
+		while (time.shouldSimulate) {
+			Profiler::get().begin("sim step");
+			time.startSimTimer();
+			{
+				PROFILE_SCOPE("audio");
+				AudioManager::get().update();
+				AudioManager::get().updateBGM();
+			}
+			Profiler::get().begin("input");
+			// check controller connected; when we have more controllers we will make it into a loop
+			// should probably put this away into the controller class
+			if (glfwJoystickPresent(GLFW_JOYSTICK_1)) {
+				if (!controller1.connected) {
+					AudioManager::get().playSound(SFX_CONTROLLER_ON, 0.3f);
+					controller1 = InputController(GLFW_JOYSTICK_1);
+					controller1.connected = true;
+					Log::debug("Controller 1 Connecter in main");
+
+				}
+			}
+			else {
+				if (controller1.connected) {
+					AudioManager::get().playSound(SFX_CONTROLLER_OFF, 0.5f);
+					controller1.connected = false;
+					Log::debug("Controller 1 disconnected in main");
+
+				}
+
+			}
+
+			if (glfwJoystickPresent(GLFW_JOYSTICK_2)) {
+				if (!controller2.connected) {
+					AudioManager::get().playSound(SFX_CONTROLLER_ON, 0.3f);
+					controller2 = InputController(GLFW_JOYSTICK_2);
+
+					controller2.connected = true;
+					Log::debug("Controller 2 Connecter in main");
+				}
+			}
+			else {
+				if (controller2.connected) {
+					AudioManager::get().playSound(SFX_CONTROLLER_OFF, 0.5f);
+					controller2.connected = false;
+					Log::debug("Controller 2 connected in main");
+
+				}
+
+			}
+
+			if (glfwJoystickPresent(GLFW_JOYSTICK_3)) {
+				if (!controller3.connected) {
+					AudioManager::get().playSound(SFX_CONTROLLER_ON, 0.3f);
+					controller3 = InputController(GLFW_JOYSTICK_3);
+
+					controller3.connected = true;
+					Log::debug("Controller 3 Connecter in main");
+				}
+			}
+			else {
+				if (controller3.connected) {
+					AudioManager::get().playSound(SFX_CONTROLLER_OFF, 0.5f);
+					controller3.connected = false;
+					Log::debug("Controller 3 connected in main");
 
+				}
 
+			}
+			if (glfwJoystickPresent(GLFW_JOYSTICK_4)) {
+				if (!controller4.connected) {
+					AudioManager::get().playSound(SFX_CONTROLLER_ON, 0.3f);
+					controller4 = InputController(GLFW_JOYSTICK_4);
+
+					controller4.connected = true;
+					Log::debug("Controller 4 Connecter in main");
+				}
+			}
+			else {
+				if (controller4.connected) {
+					AudioManager::get().playSound(SFX_CONTROLLER_OFF, 0.5f);
+					controller4.connected = false;
+					Log::debug("Controller 4 connected in main");
+
+				}
 
+			}
+			Profiler::get().end(); // input
+
+			switch (GameManager::get().screen) {
+			case Screen::eMAINMENU: {
+				if (controller1.connected) controller1.uniController(false, player);
+				if (controller2.connected) controller2.uniController(false, enemy);
+				if (controller3.connected) controller3.uniController(false, enemy2);
+				if (controller4.connected) controller4.uniController(false, enemy3);
+
+				singlePlayerIndicator = GameManager::get().mainMenuScreen != MainMenuScreen::eMULTIPLAYER_SCREEN;
+
+				break; }
+			case Screen::eLOADING: {
+
+				// set up init game here
+				time.resetSimStats();
+				statsResets++;
+
+				match.start(singlePlayerIndicator, GameManager::get().playerNumber);
+				for (int i = 0; i < GameManager::get().playerNumber; i++)
+				{
+					vehicleList[i]->setCar_tpye(PlayerOrAI::ePLAYER);
+
+				}
+				for (int i = 3; i >= GameManager::get().playerNumber; i--)
+				{
+					vehicleList[i]->setCar_tpye(PlayerOrAI::eAI);
+				}
+				AudioManager::get().setCarSoundsPause(false);
+				AudioManager::get().startGame();
+				GameManager::get().screen = Screen::ePLAYING;
+
+
+				if (GameManager::get().playerNumber > 1 && !GameManager::get().multiplayer60FPS) time.toMultiplayerMode();
+				else time.toSinglePlayerMode();
+
+				break; }
+			case Screen::ePLAYING: {
+
+				AudioManager::get().updateCarSounds();
+				AudioManager::get().setListenerPosition(Utils::instance().pxToGlmVec3(player.getPosition()), player.getFrontVec(), player.getUpVec());
+
+				if (GameManager::get().paused) { // paused, read the inputs using the menu function
+					if (controller1.connected) controller1.uniController(false, player);
+					if (controller2.connected) controller2.uniController(false, enemy);
+					if (controller3.connected) controller3.uniController(false, enemy2);
+					if (controller4.connected) controller4.uniController(false, enemy3);
+
+					// nothing moves while paused, stop blending towards the last step.
+					for (PVehicle* carPtr : vehicleList) carPtr->snapPose();
+					for (PowerUp* powerUpPtr : powerUps) powerUpPtr->snapPose();
+				}
+				else { // in game
+
+					if (!replay.isPlaying()) { // a replay drives every car itself
+						PROFILE_SCOPE("input");
+						if (controller1.connected) controller1.uniController(true, player);
+						if (controller2.connected && enemy.m_carType == PlayerOrAI::ePLAYER && !singlePlayerIndicator) controller2.uniController(true, enemy);
+						if (controller3.connected && enemy2.m_carType == PlayerOrAI::ePLAYER && !singlePlayerIndicator) controller3.uniController(true, enemy2);
+						if (controller4.connected && enemy3.m_carType == PlayerOrAI::ePLAYER && !singlePlayerIndicator) controller4.uniController(true, enemy3);
+					}
+
+					match.step(ai_ON);
+
+					if (match.isOver()) {
+						AudioManager::get().gameOver();
+						GameManager::get().winner = match.getWinner();
+						winnerCar = vehicleList.at(match.getWinner());
+						winnerCar->vehicleAttr.collisionCoefficient = 0.0f;
+						GameManager::get().screen = Screen::eGAMEOVER;
+					}
+					else if (replay.isFinished()) { // the recording stopped before anyone won
+						AudioManager::get().gameOver();
+						AudioManager::get().backToMainMenu();
+						GameManager::get().initMenu();
+					}
+				}
+
+				break; }
+			case Screen::eGAMEOVER: {
+				if (controller1.connected) controller1.uniController(false, player);
+				if (controller2.connected) controller2.uniController(false, enemy);
+				if (controller3.connected) controller3.uniController(false, enemy2);
+				if (controller4.connected) controller4.uniController(false, enemy3);
+
+				// winner sits on the podium next to the menu camera
+				winnerCar->teleport(PxTransform(PxVec3(-242.f, 300.f, 380.f), PxQuat(PxPi, PxVec3(0.f, 0.f, 0.f))));
+				break; }
+			}
+
+			// the recorded or replayed match ends as soon as we leave it, whether it was won or quit.
+			if (GameManager::get().screen != Screen::eLOADING && GameManager::get().screen != Screen::ePLAYING) {
+				if (replay.isRecording() && replay.getNumSyncs() > 0) {
+					replay.save(recordPath);
+					replay.stop();
+				}
+				else if (replay.isPlaying()) replay.stop();
+			}
+			time.endSimTimer(); // end sim timer !
+			publishSnapshot();
+			Profiler::get().end(); // sim step
 		}
 
+		// nothing left to simulate this time round, sleep until the next step is due instead of spinning a core.
+		// counted from when the accumulator was sampled, so the steps just run don't push the deadline back
+		std::this_thread::sleep_until(time.lastTime + (time.SIM_STEP - time.physicsAccum));
 	}
 
+	if (replay.isRecording() && replay.getNumSyncs() > 0) replay.save(recordPath); // closed mid-match
+	if (exportProfileOnExit) exportProfile();
+
+	running = false;
+	renderThread.join();
+	timeEndPeriod(1);
+	window.makeContextCurrent();
+
 	player.free();
 	enemy.free();
+	trees.free();
+	grassPatches.free();
 	pm.free();
 	//imgui.freeImgui();
 
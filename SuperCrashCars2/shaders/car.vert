@@ -1,4 +1,7 @@
 #version 330 core
+// gl_ViewportIndex from the vertex shader, where the driver has it (see RenderManager::singlePassSupported)
+#extension GL_ARB_shader_viewport_layer_array : enable
+#extension GL_AMD_vertex_shader_viewport_index : enable
 
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
@@ -8,20 +11,44 @@ out vec2 TexCoords;
 out vec3 Normal;
 out vec3 FragPos;
 out vec4 FragPosLightSpace;
+flat out int ViewIndex;
 
-uniform mat4 V;
-uniform mat4 P;
 uniform mat4 TM; // model
-uniform mat4 lightSpaceMatrix;
+
+// shared by every lit shader, mirrors ViewBlock/FrameBlock in RenderManager.h (std140)
+// per viewport
+struct View {
+    mat4 V;
+    mat4 P;
+    vec3 camPos;
+    mat4 cascadeMatrices[4];
+    vec4 cascadeSplits; // far end of each cascade, view space depth
+    int numCascades; // 0 means the single shadowMap is used instead
+};
+// every viewport of a single split-screen pass, otherwise only views[0]
+layout (std140) uniform ViewBlock {
+    View views[4];
+    int numViews; // draws are instanced once per view
+};
+// per frame
+layout (std140) uniform FrameBlock {
+    mat4 lightSpaceMatrix;
+    vec3 lightPos;
+};
 
 void main() 
 {
+	// instance i of view v is instance i * numViews + v
+	ViewIndex = gl_InstanceID % numViews;
 	FragPos = vec3(TM * vec4(aPos, 1.0f));
 
 	TexCoords = aTexCoords; 
-	gl_Position = P * V * TM * vec4(aPos, 1.0f);
+	gl_Position = views[ViewIndex].P * views[ViewIndex].V * TM * vec4(aPos, 1.0f);
 	Normal = aNormal;
 
 	FragPosLightSpace = lightSpaceMatrix * vec4(FragPos, 1.0);
 
+#if defined(GL_ARB_shader_viewport_layer_array) || defined(GL_AMD_vertex_shader_viewport_index)
+	gl_ViewportIndex = ViewIndex;
+#endif
 }
\ No newline at end of file
@@ -0,0 +1,39 @@
+#version 330 core
+in vec2 uv;
+out vec4 color;
+
+uniform float time;      // seconds since the loading screen came up
+uniform float progress;  // 0 to 1
+uniform vec2 resolution; // window size in pixels
+
+const vec3 background = vec3(0.05, 0.03, 0.08);
+const vec3 accent = vec3(222.0 / 255.0, 70.0 / 255.0, 80.0 / 255.0); // the menu's selected colour
+const float PI = 3.14159265;
+
+void main()
+{
+    // pixels relative to the centre, so the shapes keep their size on any window
+    vec2 p = (uv - 0.5) * resolution;
+    float unit = resolution.y / 1080.0;
+    vec3 col = background;
+
+    // eight dots around a circle, each fading out after the head passes it
+    const int DOTS = 8;
+    for (int i = 0; i < DOTS; i++) {
+        float angle = 2.0 * PI * float(i) / float(DOTS);
+        vec2 centre = vec2(cos(angle), sin(angle)) * 60.0 * unit + vec2(0.0, 60.0 * unit);
+        float behind = fract(time * 1.2 - float(i) / float(DOTS));
+        float d = length(p - centre) - (6.0 + 6.0 * (1.0 - behind)) * unit;
+        col = mix(col, accent, (1.0 - behind) * (1.0 - smoothstep(0.0, 1.5, d)));
+    }
+
+    // progress bar under the spinner
+    vec2 halfSize = vec2(300.0, 6.0) * unit;
+    vec2 q = p - vec2(0.0, -80.0 * unit);
+    if (abs(q.x) < halfSize.x && abs(q.y) < halfSize.y) {
+        float filled = step(q.x, -halfSize.x + 2.0 * halfSize.x * progress);
+        col = mix(vec3(0.2, 0.15, 0.25), accent, filled);
+    }
+
+    color = vec4(col, 1.0);
+}
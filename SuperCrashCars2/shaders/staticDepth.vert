@@ -0,0 +1,11 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 11) in uvec2 aSlot; // model, texture layer (see StaticBatch)
+
+uniform mat4 lightSpaceMatrix;
+uniform mat4 slotTM[16]; // per model, StaticBatch::MAX_MODELS
+
+void main()
+{
+    gl_Position = lightSpaceMatrix * slotTM[aSlot.x] * vec4(aPos, 1.0);
+}
@@ -0,0 +1,11 @@
+#version 330 core
+in vec2 uv;
+out vec4 color;
+
+uniform sampler2D image;
+uniform float repeat; // how many times the texture tiles across the screen, higher minifies more
+
+void main()
+{
+    color = texture(image, uv * repeat);
+}
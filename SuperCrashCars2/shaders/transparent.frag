@@ -6,18 +6,61 @@ in vec3 FragPos;
 in vec3 Normal;
 in vec2 TexCoords;
 in vec4 FragPosLightSpace;
+flat in int ViewIndex;
 
 uniform sampler2D texture_diffuse1;
 uniform sampler2D shadowMap;
+uniform sampler2DArray shadowCascades; // cascaded shadows
+// shared by every lit shader, mirrors ViewBlock/FrameBlock in RenderManager.h (std140)
+// per viewport
+struct View {
+    mat4 V;
+    mat4 P;
+    vec3 camPos;
+    mat4 cascadeMatrices[4];
+    vec4 cascadeSplits; // far end of each cascade, view space depth
+    int numCascades; // 0 means the single shadowMap is used instead
+};
+// every viewport of a single split-screen pass, otherwise only views[0]
+layout (std140) uniform ViewBlock {
+    View views[4];
+    int numViews; // draws are instanced once per view
+};
+// per frame
+layout (std140) uniform FrameBlock {
+    mat4 lightSpaceMatrix;
+    vec3 lightPos;
+};
 
-uniform vec3 lightColor;
-uniform vec3 lightPos;
-uniform vec3 camPos;
 uniform float opacity;
 
 
+float CascadeShadowCalculation(float bias)
+{
+    // pick the first cascade that reaches this far from the camera
+    float viewDepth = -(views[ViewIndex].V * vec4(FragPos, 1.0)).z;
+    int layer = views[ViewIndex].numCascades - 1;
+    for (int i = 0; i < views[ViewIndex].numCascades; i++) {
+        if (viewDepth < views[ViewIndex].cascadeSplits[i]) {
+            layer = i;
+            break;
+        }
+    }
+
+    vec4 fragPosLightSpace = views[ViewIndex].cascadeMatrices[layer] * vec4(FragPos, 1.0);
+    vec3 projCoords = fragPosLightSpace.xyz / fragPosLightSpace.w;
+    projCoords = projCoords * 0.5 + 0.5;
+    if (projCoords.z > 1.0) return 0.0; // past the far plane of the cascade
+
+    // every view has its own cascades, one after another
+    float closestDepth = texture(shadowCascades, vec3(projCoords.xy, ViewIndex * views[ViewIndex].numCascades + layer)).r;
+    return projCoords.z - bias > closestDepth ? 1.0 : 0.0;
+}
+
 float ShadowCalculation(vec4 fragPosLightSpace)
 {
+    if (views[ViewIndex].numCascades > 0) return CascadeShadowCalculation(0.0001f);
+
     // perform perspective divide
     vec3 projCoords = fragPosLightSpace.xyz / fragPosLightSpace.w;
     // transform to [0,1] range
@@ -59,7 +102,7 @@ void main()
     vec3 diffuse = diff * lightColor;
     
     // specular
-    vec3 viewDirection = normalize(camPos - FragPos);
+    vec3 viewDirection = normalize(views[ViewIndex].camPos - FragPos);
     float spec = 0.0;
     vec3 halfwayDir = normalize(lightDirection + viewDirection);  
     spec = pow(max(dot(normal, halfwayDir), 0.0f), 128.0f);